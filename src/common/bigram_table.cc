@@ -0,0 +1,174 @@
+//
+// The MIT License (MIT)
+//
+// Copyright 2013-2014 The MilkCat Project Developers
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// bigram_table.cc --- Created at 2015-01-15
+//
+
+#include "common/bigram_table.h"
+
+#include <stdint.h>
+#include <algorithm>
+#include <utility>
+#include "common/bundle.h"
+#include "common/compressed_bigram_table.h"
+#include "common/elias_fano_bigram_table.h"
+#include "utils/readable_file.h"
+#include "utils/status.h"
+
+namespace milkcat {
+
+namespace {
+
+typedef std::pair<int64_t, float> Bigram;
+
+bool BigramKeyLess(const Bigram &b1, const Bigram &b2) {
+  return b1.first < b2.first;
+}
+
+}  // namespace
+
+const float BigramTable::kNoCost = -1.0f;
+
+const BigramTable *BigramTable::New(const char *file_path,
+                                    Status *status,
+                                    const Bundle *bundle) {
+  int32_t magic_number = 0;
+  ReadableFile *fd = Bundle::OpenFile(bundle, file_path, status);
+  if (status->ok()) fd->ReadValue(&magic_number, status);
+  delete fd;
+
+  if (!status->ok()) return NULL;
+  if (magic_number == CompressedBigramTable::kMagicNumber) {
+    return CompressedBigramTable::New(file_path, status, bundle);
+  } else if (magic_number == EliasFanoBigramTable::kMagicNumber) {
+    return EliasFanoBigramTable::New(file_path, status, bundle);
+  } else {
+    return HashBigramTable::New(file_path, status, bundle);
+  }
+}
+
+void BigramTable::SortBigrams(const int64_t *keys,
+                              const float *costs,
+                              int size,
+                              std::vector<int64_t> *sorted_keys,
+                              std::vector<float> *sorted_costs) {
+  std::vector<Bigram> bigrams;
+  for (int i = 0; i < size; ++i) {
+    bigrams.push_back(std::make_pair(keys[i], costs[i]));
+  }
+  std::stable_sort(bigrams.begin(), bigrams.end(), BigramKeyLess);
+
+  sorted_keys->clear();
+  sorted_costs->clear();
+  for (int i = 0; i < size; ++i) {
+    if (!sorted_keys->empty() && sorted_keys->back() == bigrams[i].first) {
+      sorted_costs->back() = bigrams[i].second;
+    } else {
+      sorted_keys->push_back(bigrams[i].first);
+      sorted_costs->push_back(bigrams[i].second);
+    }
+  }
+}
+
+void BigramTable::SortIds(const int *ids, int size, int *order) {
+  for (int j = 0; j < size; ++j) {
+    int k = j;
+    while (k > 0 && ids[order[k - 1]] > ids[j]) {
+      order[k] = order[k - 1];
+      --k;
+    }
+    order[k] = j;
+  }
+}
+
+void BigramTable::QuantizeCosts(const std::vector<float> &costs,
+                                std::vector<uint8_t> *levels,
+                                float *base,
+                                float *step) {
+  float min_cost = 0.0f, max_cost = 0.0f;
+  for (int i = 0; i < static_cast<int>(costs.size()); ++i) {
+    if (i == 0 || costs[i] < min_cost) min_cost = costs[i];
+    if (i == 0 || costs[i] > max_cost) max_cost = costs[i];
+  }
+  *base = min_cost;
+  *step = (max_cost - min_cost) / 255;
+
+  levels->clear();
+  for (int i = 0; i < static_cast<int>(costs.size()); ++i) {
+    int level = 0;
+    if (*step > 0) {
+      level = static_cast<int>((costs[i] - min_cost) / *step + 0.5f);
+      level = std::min(std::max(level, 0), 255);
+    }
+    levels->push_back(static_cast<uint8_t>(level));
+  }
+}
+
+HashBigramTable::HashBigramTable(): table_(NULL) {
+}
+
+HashBigramTable::~HashBigramTable() {
+  delete table_;
+  table_ = NULL;
+}
+
+HashBigramTable *HashBigramTable::New(const char *file_path,
+                                      Status *status,
+                                      const Bundle *bundle) {
+  HashBigramTable *self = new HashBigramTable();
+  self->table_ = StaticHashTable<int64_t, float>::New(file_path,
+                                                      status,
+                                                      bundle);
+  if (status->ok()) {
+    return self;
+  } else {
+    delete self;
+    return NULL;
+  }
+}
+
+void HashBigramTable::FindPairs(const int *left_ids,
+                                int left_number,
+                                const int *right_ids,
+                                int right_number,
+                                float *costs) const {
+  int64_t keys[kBatchSize];
+  const float *values[kBatchSize];
+
+  // The pairs are looked up in the order of costs
+  int size = left_number * right_number;
+  for (int begin = 0; begin < size; begin += kBatchSize) {
+    int end = begin + kBatchSize < size? begin + kBatchSize: size;
+    for (int i = begin; i < end; ++i) {
+      int64_t left_id = left_ids[i % left_number];
+      keys[i - begin] = (left_id << 32) + right_ids[i / left_number];
+    }
+
+    table_->FindBatch(keys, end - begin, values);
+    for (int i = begin; i < end; ++i) {
+      const float *value = values[i - begin];
+      costs[i] = value != NULL? *value: kNoCost;
+    }
+  }
+}
+
+}  // namespace milkcat
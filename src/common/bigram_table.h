@@ -0,0 +1,120 @@
+//
+// The MIT License (MIT)
+//
+// Copyright 2013-2014 The MilkCat Project Developers
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// bigram_table.h --- Created at 2015-01-15
+//
+
+#ifndef SRC_COMMON_BIGRAM_TABLE_H_
+#define SRC_COMMON_BIGRAM_TABLE_H_
+
+#include <stdint.h>
+#include <vector>
+#include "common/static_hashtable.h"
+#include "utils/utils.h"
+
+namespace milkcat {
+
+class Bundle;
+class Status;
+
+// BigramTable stores the costs -log(p(left, right)) of word bigrams, where
+// `left` and `right` are the term-ids in system dictionary. The bigrams are
+// looked up by the cross product of some left words and some right words,
+// which are the nodes and the words starting from a position in the bigram
+// segmenter
+class BigramTable {
+ public:
+  // The cost stored by FindPairs for the pairs not in the table
+  static const float kNoCost;
+
+  // Opens the bigram file `file_path`, the implementation is decided by the
+  // magic number of the file. If `bundle` is not NULL, loads its section
+  // named `file_path`
+  static const BigramTable *New(const char *file_path,
+                                Status *status,
+                                const Bundle *bundle = NULL);
+
+  virtual ~BigramTable() {}
+
+  // Finds the costs of the pairs (left_ids[i], right_ids[j]) and stores them
+  // into costs[j * left_number + i]
+  virtual void FindPairs(const int *left_ids,
+                         int left_number,
+                         const int *right_ids,
+                         int right_number,
+                         float *costs) const = 0;
+
+  // Number of bigrams in the table
+  virtual int size() const = 0;
+
+ protected:
+  // Sorts the bigrams of `keys` and `costs` by key into `sorted_keys` and
+  // `sorted_costs`. Only the last one of the bigrams with the same key is kept
+  static void SortBigrams(const int64_t *keys,
+                          const float *costs,
+                          int size,
+                          std::vector<int64_t> *sorted_keys,
+                          std::vector<float> *sorted_costs);
+
+  // Sorts `size` ids by insertion, stores the index of the k-th smallest id
+  // into order[k]. It is for the small batches of right ids in FindPairs
+  static void SortIds(const int *ids, int size, int *order);
+
+  // Quantizes `costs` linearly into 256 levels, the cost of level k is
+  // `*base + k * *step`
+  static void QuantizeCosts(const std::vector<float> &costs,
+                            std::vector<uint8_t> *levels,
+                            float *base,
+                            float *step);
+};
+
+// The bigram table of a StaticHashTable whose keys are (left << 32) + right
+class HashBigramTable: public BigramTable {
+ public:
+  // Loads the hash table from `file_path`, see StaticHashTable::New
+  static HashBigramTable *New(const char *file_path,
+                              Status *status,
+                              const Bundle *bundle = NULL);
+  ~HashBigramTable();
+
+  void FindPairs(const int *left_ids,
+                 int left_number,
+                 const int *right_ids,
+                 int right_number,
+                 float *costs) const;
+
+  int size() const { return table_->size(); }
+
+ private:
+  // Number of pairs looked up by one StaticHashTable::FindBatch
+  enum { kBatchSize = 64 };
+
+  const StaticHashTable<int64_t, float> *table_;
+
+  HashBigramTable();
+
+  DISALLOW_COPY_AND_ASSIGN(HashBigramTable);
+};
+
+}  // namespace milkcat
+
+#endif  // SRC_COMMON_BIGRAM_TABLE_H_
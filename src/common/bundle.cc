@@ -0,0 +1,320 @@
+//
+// The MIT License (MIT)
+//
+// Copyright 2013-2014 The MilkCat Project Developers
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// bundle.cc --- Created at 2015-01-08
+//
+
+#include "common/bundle.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "utils/mapped_file.h"
+#include "utils/readable_file.h"
+#include "utils/status.h"
+#include "utils/utils.h"
+#include "utils/writable_file.h"
+
+namespace milkcat {
+
+namespace {
+
+const char kBundleMagic[8] = {'M', 'C', 'B', 'U', 'N', 'D', 'L', 'E'};
+
+// Size of the buffer to copy a model file into bundle
+const int kCopyBufferSize = 1024 * 1024;
+
+int64_t AlignOffset(int64_t offset, int64_t alignment) {
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+// Gets the size of file `file_path`
+int64_t FileSize(const char *file_path, Status *status) {
+  ReadableFile *fd = ReadableFile::New(file_path, status);
+  int64_t size = status->ok()? fd->Size(): 0;
+  delete fd;
+  return size;
+}
+
+// Copies the `size` bytes of data in `file_path` into `output` and gets its
+// checksum
+void CopyFile(const char *file_path,
+              int64_t size,
+              WritableFile *output,
+              uint32_t *checksum,
+              Status *status) {
+  std::vector<char> buffer(kCopyBufferSize);
+  ReadableFile *fd = ReadableFile::New(file_path, status);
+
+  // The file should not be changed after its section was placed
+  if (status->ok() && fd->Size() != size) {
+    std::string msg = std::string("file changed while bundling: ") +
+                      file_path;
+    *status = Status::RuntimeError(msg.c_str());
+  }
+
+  *checksum = 0;
+  int64_t remained = size;
+  while (status->ok() && remained > 0) {
+    int read_size = remained < kCopyBufferSize? remained: kCopyBufferSize;
+    fd->Read(buffer.data(), read_size, status);
+    if (status->ok()) {
+      *checksum = Crc32(buffer.data(), read_size, *checksum);
+      output->Write(buffer.data(), read_size, status);
+    }
+    remained -= read_size;
+  }
+
+  delete fd;
+}
+
+}  // namespace
+
+const char *Bundle::kDefaultFilename = "milkcat.bundle";
+
+Bundle::Bundle(): mapped_file_(NULL) {}
+
+Bundle::~Bundle() {
+  delete mapped_file_;
+  mapped_file_ = NULL;
+}
+
+bool Bundle::IsBundle(const char *path) {
+  char magic[sizeof(kBundleMagic)];
+  FILE *fd = fopen(path, "rb");
+  if (fd == NULL) return false;
+
+  bool is_bundle = fread(magic, sizeof(magic), 1, fd) == 1 &&
+                   memcmp(magic, kBundleMagic, sizeof(magic)) == 0;
+  fclose(fd);
+  return is_bundle;
+}
+
+Bundle *Bundle::Open(const char *path, Status *status) {
+  Bundle *self = new Bundle();
+  self->mapped_file_ = MappedFile::New(path,
+                                       MappedFile::kDefaultModelFlags,
+                                       status);
+
+  const char *data = NULL;
+  const Header *header = NULL;
+  int64_t file_size = 0;
+  if (status->ok()) {
+    data = static_cast<const char *>(self->mapped_file_->data());
+    file_size = self->mapped_file_->size();
+    if (file_size < static_cast<int64_t>(sizeof(Header))) {
+      *status = Status::Corruption(path);
+    } else {
+      header = reinterpret_cast<const Header *>(data);
+    }
+  }
+
+  if (status->ok()) {
+    if (memcmp(header->magic, kBundleMagic, sizeof(kBundleMagic)) != 0 ||
+        header->version != kVersion ||
+        header->section_number < 0 ||
+        static_cast<int64_t>(sizeof(Header)) +
+            header->section_number *
+            static_cast<int64_t>(sizeof(SectionEntry)) > file_size) {
+      *status = Status::Corruption(path);
+    }
+  }
+
+  const SectionEntry *directory = NULL;
+  int64_t directory_size = 0;
+  if (status->ok()) {
+    directory = reinterpret_cast<const SectionEntry *>(data + sizeof(Header));
+    directory_size = header->section_number * sizeof(SectionEntry);
+    if (Crc32(directory, directory_size) != header->directory_checksum) {
+      *status = Status::Corruption(path);
+    }
+  }
+
+  for (int i = 0; status->ok() && i < header->section_number; ++i) {
+    SectionEntry section = directory[i];
+    section.name[kSectionNameMax - 1] = '\0';
+    if (section.offset < 0 || section.size < 0 ||
+        section.offset + section.size > file_size) {
+      *status = Status::Corruption(path);
+    } else {
+      self->section_index_[section.name] = self->sections_.size();
+      self->sections_.push_back(section);
+    }
+  }
+
+  if (status->ok()) {
+    return self;
+  } else {
+    delete self;
+    return NULL;
+  }
+}
+
+void Bundle::Create(const char *path,
+                    const std::vector<std::string> &section_names,
+                    const std::vector<std::string> &file_paths,
+                    Status *status) {
+  assert(section_names.size() == file_paths.size());
+
+  // Places the sections by the size of each file, their checksums are
+  // filled while copying them
+  std::vector<SectionEntry> directory(file_paths.size());
+  int section_number = static_cast<int>(directory.size());
+  int64_t offset = sizeof(Header) + sizeof(SectionEntry) * directory.size();
+  for (int i = 0; status->ok() && i < section_number; ++i) {
+    SectionEntry *section = &directory[i];
+    memset(section, 0, sizeof(SectionEntry));
+    if (section_names[i].size() >= kSectionNameMax) {
+      std::string msg = "section name too long: " + section_names[i];
+      *status = Status::RuntimeError(msg.c_str());
+      break;
+    }
+    strlcpy(section->name, section_names[i].c_str(), kSectionNameMax);
+    section->size = FileSize(file_paths[i].c_str(), status);
+    section->offset = AlignOffset(offset, kSectionAlignment);
+    offset = section->offset + section->size;
+  }
+
+  Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kBundleMagic, sizeof(kBundleMagic));
+  header.version = kVersion;
+  header.section_number = section_number;
+
+  // The header and directory are written again after the checksums are
+  // known
+  WritableFile *fd = NULL;
+  if (status->ok()) fd = WritableFile::New(path, status);
+  if (status->ok()) fd->Write(&header, sizeof(header), status);
+  if (status->ok() && section_number > 0) {
+    fd->Write(directory.data(),
+              sizeof(SectionEntry) * directory.size(),
+              status);
+  }
+
+  // Writes the sections with the zero paddings for alignment
+  std::vector<char> padding(kSectionAlignment);
+  offset = sizeof(Header) + sizeof(SectionEntry) * directory.size();
+  for (int i = 0; status->ok() && i < section_number; ++i) {
+    int padding_size = directory[i].offset - offset;
+    if (padding_size > 0) fd->Write(padding.data(), padding_size, status);
+    if (status->ok()) {
+      CopyFile(file_paths[i].c_str(),
+               directory[i].size,
+               fd,
+               &directory[i].checksum,
+               status);
+    }
+    offset = directory[i].offset + directory[i].size;
+  }
+
+  header.directory_checksum = Crc32(directory.data(),
+                                    sizeof(SectionEntry) * directory.size());
+  if (status->ok()) fd->Seek(0, status);
+  if (status->ok()) fd->Write(&header, sizeof(header), status);
+  if (status->ok() && section_number > 0) {
+    fd->Write(directory.data(),
+              sizeof(SectionEntry) * directory.size(),
+              status);
+  }
+
+  delete fd;
+}
+
+MappedFile *Bundle::MapFile(const Bundle *bundle,
+                           const char *path,
+                           int flags,
+                           Status *status) {
+  if (bundle == NULL) {
+    return MappedFile::New(path, flags, status);
+  } else {
+    return bundle->MapSection(path, status);
+  }
+}
+
+ReadableFile *Bundle::OpenFile(const Bundle *bundle,
+                               const char *path,
+                               Status *status) {
+  if (bundle == NULL) {
+    return ReadableFile::New(path, status);
+  } else {
+    return bundle->OpenSection(path, status);
+  }
+}
+
+bool Bundle::Has(const char *name) const {
+  return section_index_.find(name) != section_index_.end();
+}
+
+const void *Bundle::Section(const char *name,
+                            int64_t *size,
+                            Status *status) const {
+  std::map<std::string, int>::const_iterator it = section_index_.find(name);
+  if (it == section_index_.end()) {
+    std::string msg("section not found in bundle: ");
+    msg += name;
+    *status = Status::IOError(msg.c_str());
+    return NULL;
+  }
+
+  const SectionEntry &section = sections_[it->second];
+  *size = section.size;
+  return static_cast<const char *>(mapped_file_->data()) + section.offset;
+}
+
+ReadableFile *Bundle::OpenSection(const char *name, Status *status) const {
+  int64_t size = 0;
+  const void *data = Section(name, &size, status);
+  if (status->ok()) {
+    return ReadableFile::NewFromMemory(name, data, size, status);
+  } else {
+    return NULL;
+  }
+}
+
+MappedFile *Bundle::MapSection(const char *name, Status *status) const {
+  int64_t size = 0;
+  const void *data = Section(name, &size, status);
+  if (status->ok()) {
+    return MappedFile::NewView(name, data, size);
+  } else {
+    return NULL;
+  }
+}
+
+void Bundle::Verify(Status *status) const {
+  const char *data = static_cast<const char *>(mapped_file_->data());
+  for (std::vector<SectionEntry>::const_iterator
+       it = sections_.begin(); it != sections_.end(); ++it) {
+    if (Crc32(data + it->offset, it->size) != it->checksum) {
+      std::string msg("checksum mismatch of section ");
+      msg += it->name;
+      *status = Status::Corruption(msg.c_str());
+      return;
+    }
+  }
+}
+
+}  // namespace milkcat
@@ -0,0 +1,135 @@
+//
+// The MIT License (MIT)
+//
+// Copyright 2013-2014 The MilkCat Project Developers
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// bundle.h --- Created at 2015-01-08
+//
+
+#ifndef SRC_COMMON_BUNDLE_H_
+#define SRC_COMMON_BUNDLE_H_
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "utils/status.h"
+#include "utils/utils.h"
+
+namespace milkcat {
+
+class MappedFile;
+class ReadableFile;
+
+// Bundle is a single file container of all the model files. It is mapped into
+// memory as a whole, and each model file is a section of it. The layout is:
+//
+//   Header     magic, version, section number and checksum of directory
+//   Directory  name, offset, size and checksum of each section
+//   Sections   data of model files, each one aligned to kSectionAlignment
+//
+// The model loaders read a section just like reading the model file with the
+// same name
+class Bundle {
+ public:
+  // Default file name of the bundle in a model directory
+  static const char *kDefaultFilename;
+
+  // Opens the bundle file `path`. Only the header and directory are checked,
+  // use `Verify` to check the data of all sections
+  static Bundle *Open(const char *path, Status *status);
+
+  // Returns true if `path` is a bundle file
+  static bool IsBundle(const char *path);
+
+  // Builds the bundle file `path` from the model files. The section
+  // `section_names[i]` is the data of file `file_paths[i]`
+  static void Create(const char *path,
+                     const std::vector<std::string> &section_names,
+                     const std::vector<std::string> &file_paths,
+                     Status *status);
+
+  // Helpers for the model loaders. Maps or opens the model file `path`, or the
+  // section named `path` of `bundle` if `bundle` is not NULL
+  static MappedFile *MapFile(const Bundle *bundle,
+                             const char *path,
+                             int flags,
+                             Status *status);
+  static ReadableFile *OpenFile(const Bundle *bundle,
+                                const char *path,
+                                Status *status);
+
+  ~Bundle();
+
+  // Returns true if the bundle contains a section named `name`
+  bool Has(const char *name) const;
+
+  // Gets the data of section `name` and stores its size into `size`. On
+  // failed, returns NULL and sets `status`
+  const void *Section(const char *name, int64_t *size, Status *status) const;
+
+  // Opens section `name` as a readable file
+  ReadableFile *OpenSection(const char *name, Status *status) const;
+
+  // Gets section `name` as a view of the mapped bundle. It should not be used
+  // after the bundle is deleted
+  MappedFile *MapSection(const char *name, Status *status) const;
+
+  // Checks the data of each section with its checksum
+  void Verify(Status *status) const;
+
+  int section_number() const { return sections_.size(); }
+  const char *section_name(int idx) const { return sections_[idx].name; }
+  int64_t section_size(int idx) const { return sections_[idx].size; }
+
+ private:
+  static const int kVersion = 1;
+  static const int kSectionNameMax = 64;
+  static const int kSectionAlignment = 4096;
+
+  struct Header {
+    char magic[8];
+    int32_t version;
+    int32_t section_number;
+    uint32_t directory_checksum;
+    int32_t reserved;
+  };
+
+  struct SectionEntry {
+    char name[kSectionNameMax];
+    int64_t offset;
+    int64_t size;
+    uint32_t checksum;
+    int32_t reserved;
+  };
+
+  MappedFile *mapped_file_;
+  std::vector<SectionEntry> sections_;
+  std::map<std::string, int> section_index_;
+
+  Bundle();
+
+  DISALLOW_COPY_AND_ASSIGN(Bundle);
+};
+
+}  // namespace milkcat
+
+#endif  // SRC_COMMON_BUNDLE_H_
@@ -0,0 +1,356 @@
+//
+// The MIT License (MIT)
+//
+// Copyright 2013-2014 The MilkCat Project Developers
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// compressed_bigram_table.cc --- Created at 2015-01-15
+//
+
+#include "common/compressed_bigram_table.h"
+
+#include <string.h>
+#include <algorithm>
+#include "common/bundle.h"
+#include "utils/mapped_file.h"
+#include "utils/status.h"
+#include "utils/writable_file.h"
+
+namespace milkcat {
+
+namespace {
+
+// A varint of an uint32_t value has at most 5 bytes
+const int kMaxVarintBytes = 5;
+
+void WriteVarint(uint32_t value, std::vector<uint8_t> *data) {
+  while (value >= 0x80) {
+    data->push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  data->push_back(static_cast<uint8_t>(value));
+}
+
+inline uint32_t ReadVarint(const uint8_t **data) {
+  const uint8_t *p = *data;
+  uint32_t value = *p & 0x7f;
+  int shift = 7;
+  while (*p++ & 0x80) {
+    value |= static_cast<uint32_t>(*p & 0x7f) << shift;
+    shift += 7;
+  }
+  *data = p;
+  return value;
+}
+
+inline void SkipVarint(const uint8_t **data) {
+  const uint8_t *p = *data;
+  while (*p++ & 0x80) {}
+  *data = p;
+}
+
+}  // namespace
+
+CompressedBigramTable::CompressedBigramTable(): left_number_(0),
+                                                pair_number_(0),
+                                                block_number_(0),
+                                                data_bytes_(0),
+                                                cost_base_(0.0f),
+                                                cost_step_(0.0f),
+                                                row_offsets_(NULL),
+                                                block_offsets_(NULL),
+                                                costs_(NULL),
+                                                deltas_(NULL),
+                                                mapped_file_(NULL) {
+}
+
+CompressedBigramTable::~CompressedBigramTable() {
+  delete mapped_file_;
+  mapped_file_ = NULL;
+}
+
+CompressedBigramTable *CompressedBigramTable::Build(const int64_t *keys,
+                                                    const float *costs,
+                                                    int size) {
+  CompressedBigramTable *self = new CompressedBigramTable();
+
+  std::vector<int64_t> sorted_keys;
+  std::vector<float> sorted_costs;
+  SortBigrams(keys, costs, size, &sorted_keys, &sorted_costs);
+  QuantizeCosts(sorted_costs,
+                &self->cost_data_,
+                &self->cost_base_,
+                &self->cost_step_);
+
+  size = static_cast<int>(sorted_keys.size());
+  self->pair_number_ = size;
+  self->left_number_ = size == 0? 0: (sorted_keys.back() >> 32) + 1;
+  self->row_offset_data_.assign(self->left_number_ + 1, 0);
+  int previous_left_id = -1;
+  uint32_t previous_right_id = 0;
+  for (int i = 0; i < size; ++i) {
+    int left_id = static_cast<int>(sorted_keys[i] >> 32);
+    uint32_t right_id = static_cast<uint32_t>(sorted_keys[i] & 0xffffffff);
+    self->row_offset_data_[left_id + 1]++;
+
+    // The right id is stored as is at the start of a row or a block
+    uint32_t base = previous_right_id;
+    if (i % kBlockSize == 0) {
+      self->block_offset_data_.push_back(self->delta_data_.size());
+      base = 0;
+    }
+    if (left_id != previous_left_id) base = 0;
+    WriteVarint(right_id - base, &self->delta_data_);
+    previous_left_id = left_id;
+    previous_right_id = right_id;
+  }
+  for (int i = 0; i < self->left_number_; ++i) {
+    self->row_offset_data_[i + 1] += self->row_offset_data_[i];
+  }
+
+  self->block_number_ = static_cast<int>(self->block_offset_data_.size());
+  self->data_bytes_ = static_cast<int>(self->delta_data_.size());
+  self->UseBuiltData();
+  return self;
+}
+
+void CompressedBigramTable::UseBuiltData() {
+  row_offsets_ = row_offset_data_.data();
+  block_offsets_ = block_offset_data_.data();
+  costs_ = cost_data_.data();
+  deltas_ = delta_data_.data();
+}
+
+CompressedBigramTable *CompressedBigramTable::New(const char *file_path,
+                                                  Status *status,
+                                                  const Bundle *bundle) {
+  CompressedBigramTable *self = new CompressedBigramTable();
+  self->mapped_file_ = Bundle::MapFile(bundle, file_path, 0, status);
+
+  const Header *header = NULL;
+  if (status->ok()) {
+    if (self->mapped_file_->size() < static_cast<int64_t>(sizeof(Header))) {
+      *status = Status::Corruption(file_path);
+    } else {
+      header = static_cast<const Header *>(self->mapped_file_->data());
+    }
+  }
+
+  if (status->ok()) {
+    if (header->magic_number != kMagicNumber ||
+        header->left_number < 0 ||
+        header->pair_number < 0 ||
+        header->block_number !=
+            (header->pair_number + kBlockSize - 1) / kBlockSize ||
+        header->data_bytes < 0) {
+      *status = Status::Corruption(file_path);
+    }
+  }
+
+  if (status->ok()) {
+    int64_t expected_size = sizeof(Header) +
+                            sizeof(uint32_t) * (header->left_number + 1) +
+                            sizeof(uint32_t) *
+                            static_cast<int64_t>(header->block_number) +
+                            header->pair_number +
+                            header->data_bytes;
+    if (self->mapped_file_->size() != expected_size) {
+      *status = Status::Corruption(file_path);
+    }
+  }
+
+  if (status->ok()) {
+    self->left_number_ = header->left_number;
+    self->pair_number_ = header->pair_number;
+    self->block_number_ = header->block_number;
+    self->data_bytes_ = header->data_bytes;
+    self->cost_base_ = header->cost_base;
+    self->cost_step_ = header->cost_step;
+
+    const char *data = reinterpret_cast<const char *>(header + 1);
+    self->row_offsets_ = reinterpret_cast<const uint32_t *>(data);
+    data += sizeof(uint32_t) * (self->left_number_ + 1);
+    self->block_offsets_ = reinterpret_cast<const uint32_t *>(data);
+    data += sizeof(uint32_t) * self->block_number_;
+    self->costs_ = reinterpret_cast<const uint8_t *>(data);
+    data += self->pair_number_;
+    self->deltas_ = reinterpret_cast<const uint8_t *>(data);
+
+    // `FindRow` trusts the offsets, so they are checked here once
+    if (!self->CheckOffsets()) *status = Status::Corruption(file_path);
+  }
+
+  if (status->ok()) {
+    return self;
+  } else {
+    delete self;
+    return NULL;
+  }
+}
+
+bool CompressedBigramTable::CheckOffsets() const {
+  if (row_offsets_[0] != 0 ||
+      row_offsets_[left_number_] != static_cast<uint32_t>(pair_number_)) {
+    return false;
+  }
+  for (int i = 0; i < left_number_; ++i) {
+    if (row_offsets_[i] > row_offsets_[i + 1]) return false;
+  }
+
+  // Walks the varints of all bigrams. The bigram `k * kBlockSize` should
+  // start at block_offsets_[k], and the last varint should end at the end of
+  // `deltas_`
+  uint32_t position = 0;
+  for (int i = 0; i < pair_number_; ++i) {
+    if (i % kBlockSize == 0 && block_offsets_[i / kBlockSize] != position) {
+      return false;
+    }
+
+    int bytes = 0;
+    do {
+      if (position >= static_cast<uint32_t>(data_bytes_) ||
+          bytes == kMaxVarintBytes) {
+        return false;
+      }
+      ++bytes;
+    } while (deltas_[position++] & 0x80);
+  }
+  return position == static_cast<uint32_t>(data_bytes_);
+}
+
+void CompressedBigramTable::Save(const char *file_path, Status *status) const {
+  WritableFile *fd = WritableFile::New(file_path, status);
+
+  Header header;
+  memset(&header, 0, sizeof(header));
+  header.magic_number = kMagicNumber;
+  header.left_number = left_number_;
+  header.pair_number = pair_number_;
+  header.block_number = block_number_;
+  header.data_bytes = data_bytes_;
+  header.cost_base = cost_base_;
+  header.cost_step = cost_step_;
+  if (status->ok()) fd->Write(&header, sizeof(header), status);
+  if (status->ok()) {
+    fd->Write(row_offsets_, sizeof(uint32_t) * (left_number_ + 1), status);
+  }
+  if (status->ok()) {
+    fd->Write(block_offsets_, sizeof(uint32_t) * block_number_, status);
+  }
+  if (status->ok()) fd->Write(costs_, pair_number_, status);
+  if (status->ok()) fd->Write(deltas_, data_bytes_, status);
+
+  delete fd;
+}
+
+inline uint32_t CompressedBigramTable::BlockFirstId(int block) const {
+  const uint8_t *p = deltas_ + block_offsets_[block];
+  return ReadVarint(&p);
+}
+
+void CompressedBigramTable::FindRow(int left_id,
+                                    const int *right_ids,
+                                    const int *order,
+                                    int right_number,
+                                    float *costs,
+                                    int stride) const {
+  int j = 0;
+  int entry = 0, end = 0;
+  if (left_id >= 0 && left_id < left_number_) {
+    entry = row_offsets_[left_id];
+    end = row_offsets_[left_id + 1];
+  }
+
+  if (entry < end) {
+    // Decodes the first bigram of the row, the bigrams before it in the
+    // block belong to other rows
+    int block = entry / kBlockSize;
+    const uint8_t *p = deltas_ + block_offsets_[block];
+    for (int i = block * kBlockSize; i < entry; ++i) SkipVarint(&p);
+    uint32_t id = ReadVarint(&p);
+    int last_block = (end - 1) / kBlockSize;
+
+    for (; j < right_number; ++j) {
+      uint32_t right_id = static_cast<uint32_t>(right_ids[order[j]]);
+      if (id < right_id) {
+        // Jumps to the last block of the row whose first id is not greater
+        // than `right_id`
+        int low = entry / kBlockSize + 1, high = last_block;
+        if (low <= high && BlockFirstId(low) <= right_id) {
+          while (low < high) {
+            int middle = (low + high + 1) / 2;
+            if (BlockFirstId(middle) <= right_id) {
+              low = middle;
+            } else {
+              high = middle - 1;
+            }
+          }
+          entry = low * kBlockSize;
+          p = deltas_ + block_offsets_[low];
+          id = ReadVarint(&p);
+        }
+
+        while (id < right_id && entry + 1 < end) {
+          ++entry;
+          uint32_t delta = ReadVarint(&p);
+          id = entry % kBlockSize == 0? delta: id + delta;
+        }
+      }
+
+      if (id == right_id) {
+        costs[order[j] * stride] = cost_base_ + costs_[entry] * cost_step_;
+      } else {
+        costs[order[j] * stride] = kNoCost;
+
+        // All the right ids of the row are less than `right_id`
+        if (id < right_id) {
+          ++j;
+          break;
+        }
+      }
+    }
+  }
+
+  for (; j < right_number; ++j) costs[order[j] * stride] = kNoCost;
+}
+
+void CompressedBigramTable::FindPairs(const int *left_ids,
+                                      int left_number,
+                                      const int *right_ids,
+                                      int right_number,
+                                      float *costs) const {
+  int order[kMaxBatchSize];
+  for (int begin = 0; begin < right_number; begin += kMaxBatchSize) {
+    int size = std::min(static_cast<int>(kMaxBatchSize),
+                        right_number - begin);
+    const int *batch_right_ids = right_ids + begin;
+    SortIds(batch_right_ids, size, order);
+
+    for (int i = 0; i < left_number; ++i) {
+      FindRow(left_ids[i],
+              batch_right_ids,
+              order,
+              size,
+              costs + begin * left_number + i,
+              left_number);
+    }
+  }
+}
+
+}  // namespace milkcat
@@ -0,0 +1,151 @@
+//
+// The MIT License (MIT)
+//
+// Copyright 2013-2014 The MilkCat Project Developers
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// compressed_bigram_table.h --- Created at 2015-01-15
+//
+
+#ifndef SRC_COMMON_COMPRESSED_BIGRAM_TABLE_H_
+#define SRC_COMMON_COMPRESSED_BIGRAM_TABLE_H_
+
+#include <stdint.h>
+#include <vector>
+#include "common/bigram_table.h"
+#include "utils/utils.h"
+
+namespace milkcat {
+
+class Bundle;
+class MappedFile;
+class Status;
+
+// CompressedBigramTable stores the bigrams as a compressed adjacency list
+// (CSR): the right ids of each left id are sorted and delta-encoded as
+// varints, and their costs are quantized into 8 bits. Every kBlockSize
+// bigrams start a block whose first right id is stored as is, so a lookup
+// binary searches the blocks of the row and decodes at most one block. The
+// right ids of a position are sorted and intersected with each row once.
+// It is a size/speed trade-off: the file is about 1/10 of StaticHashTable,
+// but decoding the varints makes the segmenter slower than hashed lookups
+class CompressedBigramTable: public BigramTable {
+ public:
+  static const int32_t kMagicNumber = 0x3330;
+
+  // Builds the table from `size` bigrams, the key of a bigram is
+  // (left_id << 32) + right_id and both ids are not negative
+  static CompressedBigramTable *Build(const int64_t *keys,
+                                      const float *costs,
+                                      int size);
+
+  // Maps the table file `file_path` into memory. If `bundle` is not NULL,
+  // maps its section named `file_path`
+  static CompressedBigramTable *New(const char *file_path,
+                                    Status *status,
+                                    const Bundle *bundle = NULL);
+
+  ~CompressedBigramTable();
+
+  // Saves the table into `file_path`
+  void Save(const char *file_path, Status *status) const;
+
+  void FindPairs(const int *left_ids,
+                 int left_number,
+                 const int *right_ids,
+                 int right_number,
+                 float *costs) const;
+
+  int size() const { return pair_number_; }
+
+ private:
+  // File header, followed by `left_number + 1` row offsets, `block_number`
+  // block offsets, `pair_number` quantized costs and `data_bytes` bytes of
+  // delta-encoded right ids
+  struct Header {
+    int32_t magic_number;
+    int32_t left_number;
+    int32_t pair_number;
+    int32_t block_number;
+    int32_t data_bytes;
+    float cost_base;
+    float cost_step;
+    int32_t reserved;
+  };
+
+  enum {
+    // Number of bigrams in a block
+    kBlockSize = 32,
+
+    // Number of right ids sorted and intersected with the rows together
+    kMaxBatchSize = 64
+  };
+
+  int left_number_;
+  int pair_number_;
+  int block_number_;
+  int data_bytes_;
+  float cost_base_;
+  float cost_step_;
+
+  // The bigrams of left id `i` are [row_offsets_[i], row_offsets_[i + 1]).
+  // The right id of the bigrams from block_offsets_[k] bytes of `deltas_` are
+  // encoded, the first bigram of the block `k` is `k * kBlockSize`
+  const uint32_t *row_offsets_;
+  const uint32_t *block_offsets_;
+  const uint8_t *costs_;
+  const uint8_t *deltas_;
+
+  // The arrays of a table built in memory, and the mapped file of a table
+  // loaded from file
+  std::vector<uint32_t> row_offset_data_;
+  std::vector<uint32_t> block_offset_data_;
+  std::vector<uint8_t> cost_data_;
+  std::vector<uint8_t> delta_data_;
+  MappedFile *mapped_file_;
+
+  CompressedBigramTable();
+
+  // Points the arrays to the data built in memory
+  void UseBuiltData();
+
+  // Checks that the row offsets are ascending, and each block offset points
+  // to the varint of its first bigram in `deltas_`. Returns false if the
+  // data could not come from `Build`
+  bool CheckOffsets() const;
+
+  // Finds the costs of left id `left_id` with the right ids
+  // right_ids[order[0]], right_ids[order[1]], ... in ascending order. Stores
+  // the cost of right_ids[order[j]] into costs[order[j] * stride]
+  void FindRow(int left_id,
+               const int *right_ids,
+               const int *order,
+               int right_number,
+               float *costs,
+               int stride) const;
+
+  // Gets the first right id of block `block`
+  uint32_t BlockFirstId(int block) const;
+
+  DISALLOW_COPY_AND_ASSIGN(CompressedBigramTable);
+};
+
+}  // namespace milkcat
+
+#endif  // SRC_COMMON_COMPRESSED_BIGRAM_TABLE_H_
@@ -0,0 +1,629 @@
+//
+// The MIT License (MIT)
+//
+// Copyright 2013-2014 The MilkCat Project Developers
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// elias_fano_bigram_table.cc --- Created at 2015-01-15
+//
+
+#include "common/elias_fano_bigram_table.h"
+
+#include <string.h>
+#include <algorithm>
+#include "common/bundle.h"
+#include "utils/mapped_file.h"
+#include "utils/status.h"
+#include "utils/writable_file.h"
+
+namespace milkcat {
+
+namespace {
+
+const uint64_t kOnesStep4 = 0x1111111111111111ULL;
+const uint64_t kOnesStep8 = 0x0101010101010101ULL;
+const uint64_t kMsbsStep8 = 0x8080808080808080ULL;
+
+// Gets the number of set bits in each byte of `word`
+inline uint64_t ByteCounts(uint64_t word) {
+  word = word - ((word & 0xa * kOnesStep4) >> 1);
+  word = (word & 3 * kOnesStep4) + ((word >> 2) & 3 * kOnesStep4);
+  return (word + (word >> 4)) & 0x0f * kOnesStep8;
+}
+
+// Gets the prefix sums of the set bits in the bytes of `word`: byte k of the
+// result is the number of set bits in bytes 0 to k, and the last byte is the
+// number of set bits in `word`
+inline uint64_t BytePrefixSums(uint64_t word) {
+  return ByteCounts(word) * kOnesStep8;
+}
+
+// The position of the set bit `rank` in each byte
+class SelectInByteTable {
+ public:
+  SelectInByteTable() {
+    memset(table_, 0, sizeof(table_));
+    for (int byte = 0; byte < 256; ++byte) {
+      int rank = 0;
+      for (int bit = 0; bit < 8; ++bit) {
+        if ((byte >> bit) & 1) table_[rank++][byte] = bit;
+      }
+    }
+  }
+
+  int operator()(int byte, int rank) const { return table_[rank][byte]; }
+
+ private:
+  uint8_t table_[8][256];
+};
+
+static const SelectInByteTable select_in_byte;
+
+// Gets the position of the set bit `rank` in `word` whose prefix sums are
+// `byte_sums`, without branches: the byte is found by comparing the prefix
+// sums with `rank` in parallel, then the bit in the byte from a table
+inline int SelectInWord(uint64_t word, uint64_t byte_sums, int rank) {
+  uint64_t rank_step8 = rank * kOnesStep8;
+  int position = static_cast<int>(
+      ((((rank_step8 | kMsbsStep8) - byte_sums) & kMsbsStep8) >> 7) *
+      kOnesStep8 >> 53 & ~0x7);
+  rank -= static_cast<int>(((byte_sums << 8) >> position) & 0xff);
+  return position + select_in_byte((word >> position) & 0xff, rank);
+}
+
+// Reads 64 bits from bit `position` of `words`, the word after the one of
+// `position` should be readable
+inline uint64_t ReadWord(const uint64_t *words, uint64_t position) {
+  int offset = position % 64;
+  return (words[position / 64] >> offset) |
+         ((words[position / 64 + 1] << 1) << (63 - offset));
+}
+
+// Writes the `bits` low bits of `value` into bit `position` of `words`
+void WriteBits(uint64_t value,
+               uint64_t position,
+               int bits,
+               std::vector<uint64_t> *words) {
+  if (bits == 0) return;
+  value &= (static_cast<uint64_t>(1) << bits) - 1;
+  int offset = position % 64;
+  (*words)[position / 64] |= value << offset;
+  if (offset + bits > 64) (*words)[position / 64 + 1] |= value >> (64 - offset);
+}
+
+}  // namespace
+
+EliasFanoBigramTable::EliasFanoBigramTable(): left_number_(0),
+                                              pair_number_(0),
+                                              right_universe_(0),
+                                              high_words_(0),
+                                              low_words_(0),
+                                              sample_number_(0),
+                                              cost_base_(0.0f),
+                                              cost_step_(0.0f),
+                                              high_bits_(NULL),
+                                              low_bits_(NULL),
+                                              rows_(NULL),
+                                              zero_samples_(NULL),
+                                              costs_(NULL),
+                                              mapped_file_(NULL) {
+}
+
+EliasFanoBigramTable::~EliasFanoBigramTable() {
+  delete mapped_file_;
+  mapped_file_ = NULL;
+}
+
+EliasFanoBigramTable *EliasFanoBigramTable::Build(const int64_t *keys,
+                                                  const float *costs,
+                                                  int size) {
+  EliasFanoBigramTable *self = new EliasFanoBigramTable();
+
+  std::vector<int64_t> sorted_keys;
+  std::vector<float> sorted_costs;
+  SortBigrams(keys, costs, size, &sorted_keys, &sorted_costs);
+  QuantizeCosts(sorted_costs,
+                &self->cost_data_,
+                &self->cost_base_,
+                &self->cost_step_);
+
+  size = static_cast<int>(sorted_keys.size());
+  self->pair_number_ = size;
+  self->left_number_ = size == 0? 0: (sorted_keys.back() >> 32) + 1;
+  uint32_t max_right_id = 0;
+  std::vector<uint32_t> row_sizes(self->left_number_, 0);
+  for (int i = 0; i < size; ++i) {
+    int left_id = static_cast<int>(sorted_keys[i] >> 32);
+    uint32_t right_id = static_cast<uint32_t>(sorted_keys[i] & 0xffffffff);
+    if (right_id > max_right_id) max_right_id = right_id;
+    row_sizes[left_id]++;
+  }
+  self->right_universe_ = max_right_id + 1;
+
+  // A row of n right ids has floor(log2(right_universe / n)) low bits, then
+  // its high bits take at most 3n bits. An empty row takes no bits
+  uint32_t universe = self->right_universe_;
+  Row row = {0, 0, 0, 0, 0};
+  for (int left_id = 0; left_id < self->left_number_; ++left_id) {
+    uint32_t row_size = row_sizes[left_id];
+    int low_bits = 0;
+    while (row_size > 0 && (universe / row_size) >> (low_bits + 1)) {
+      ++low_bits;
+    }
+    row.low_bits = low_bits;
+    self->row_data_.push_back(row);
+
+    if (row_size > 0) {
+      row.offset += row_size;
+      row.high_offset += row_size + ((universe - 1) >> low_bits) + 1;
+      row.low_offset += row_size * low_bits;
+    }
+  }
+  row.low_bits = 0;
+  self->row_data_.push_back(row);
+  uint64_t high_bit_number = row.high_offset;
+  uint64_t low_bit_number = row.low_offset;
+
+  // One more word of high bits and low bits, so that 64 bits from any bit
+  // could be read by ReadWord. The low bits of a row with zero-width low
+  // bits are read at the end of them
+  self->high_bit_data_.assign((high_bit_number + 63) / 64 + 1, 0);
+  self->low_bit_data_.assign(low_bit_number / 64 + 2, 0);
+  for (int i = 0; i < size; ++i) {
+    int left_id = static_cast<int>(sorted_keys[i] >> 32);
+    uint32_t right_id = static_cast<uint32_t>(sorted_keys[i] & 0xffffffff);
+    const Row &left_row = self->row_data_[left_id];
+    uint32_t index = i - left_row.offset;
+    int low_bits = left_row.low_bits;
+
+    uint64_t position = left_row.high_offset + (right_id >> low_bits) + index;
+    self->high_bit_data_[position / 64] |= static_cast<uint64_t>(1) <<
+                                           (position % 64);
+    WriteBits(right_id,
+              left_row.low_offset + static_cast<uint64_t>(index) * low_bits,
+              low_bits,
+              &self->low_bit_data_);
+  }
+
+  // The rows starting at the end of high bits are empty
+  for (int left_id = 0; left_id <= self->left_number_; ++left_id) {
+    Row *left_row = &self->row_data_[left_id];
+    if (left_row->high_offset < high_bit_number) {
+      left_row->high_window = ReadWord(self->high_bit_data_.data(),
+                                       left_row->high_offset);
+    }
+  }
+
+  int zero_number = 0;
+  for (uint64_t position = 0; position < high_bit_number; ++position) {
+    uint64_t word = self->high_bit_data_[position / 64];
+    if ((word >> (position % 64)) & 1) continue;
+    if (zero_number % kSampleRate == 0) {
+      self->zero_sample_data_.push_back(static_cast<uint32_t>(position));
+    }
+    ++zero_number;
+  }
+
+  self->high_words_ = static_cast<int>(self->high_bit_data_.size());
+  self->low_words_ = static_cast<int>(self->low_bit_data_.size());
+  self->sample_number_ = static_cast<int>(self->zero_sample_data_.size());
+  self->UseBuiltData();
+  return self;
+}
+
+void EliasFanoBigramTable::UseBuiltData() {
+  high_bits_ = high_bit_data_.data();
+  low_bits_ = low_bit_data_.data();
+  rows_ = row_data_.data();
+  zero_samples_ = zero_sample_data_.data();
+  costs_ = cost_data_.data();
+}
+
+EliasFanoBigramTable *EliasFanoBigramTable::New(const char *file_path,
+                                                Status *status,
+                                                const Bundle *bundle) {
+  EliasFanoBigramTable *self = new EliasFanoBigramTable();
+  self->mapped_file_ = Bundle::MapFile(bundle, file_path, 0, status);
+
+  const Header *header = NULL;
+  if (status->ok()) {
+    if (self->mapped_file_->size() < static_cast<int64_t>(sizeof(Header))) {
+      *status = Status::Corruption(file_path);
+    } else {
+      header = static_cast<const Header *>(self->mapped_file_->data());
+    }
+  }
+
+  if (status->ok()) {
+    if (header->magic_number != kMagicNumber ||
+        header->left_number < 0 ||
+        header->pair_number < 0 ||
+        header->right_universe <= 0 ||
+        header->high_words <= 0 ||
+        header->low_words <= 0 ||
+        header->sample_number < 0) {
+      *status = Status::Corruption(file_path);
+    }
+  }
+
+  if (status->ok()) {
+    int64_t left_number = header->left_number;
+    int64_t expected_size = sizeof(Header) +
+                            sizeof(uint64_t) *
+                            static_cast<int64_t>(header->high_words) +
+                            sizeof(uint64_t) *
+                            static_cast<int64_t>(header->low_words) +
+                            sizeof(Row) * (left_number + 1) +
+                            sizeof(uint32_t) *
+                            static_cast<int64_t>(header->sample_number) +
+                            header->pair_number;
+    if (self->mapped_file_->size() != expected_size) {
+      *status = Status::Corruption(file_path);
+    }
+  }
+
+  if (status->ok()) {
+    self->left_number_ = header->left_number;
+    self->pair_number_ = header->pair_number;
+    self->right_universe_ = header->right_universe;
+    self->high_words_ = header->high_words;
+    self->low_words_ = header->low_words;
+    self->sample_number_ = header->sample_number;
+    self->cost_base_ = header->cost_base;
+    self->cost_step_ = header->cost_step;
+
+    const char *data = reinterpret_cast<const char *>(header + 1);
+    self->high_bits_ = reinterpret_cast<const uint64_t *>(data);
+    data += sizeof(uint64_t) * self->high_words_;
+    self->low_bits_ = reinterpret_cast<const uint64_t *>(data);
+    data += sizeof(uint64_t) * self->low_words_;
+    self->rows_ = reinterpret_cast<const Row *>(data);
+    data += sizeof(Row) * (self->left_number_ + 1);
+    self->zero_samples_ = reinterpret_cast<const uint32_t *>(data);
+    data += sizeof(uint32_t) * self->sample_number_;
+    self->costs_ = reinterpret_cast<const uint8_t *>(data);
+
+    // The bit vectors and the samples should match the offsets of the last
+    // row
+    const Row &last_row = self->rows_[self->left_number_];
+    int64_t high_bit_number = last_row.high_offset;
+    int64_t low_bit_number = last_row.low_offset;
+    int64_t zero_number = high_bit_number - self->pair_number_;
+    if (last_row.offset !=
+            static_cast<uint32_t>(self->pair_number_) ||
+        self->high_words_ != (high_bit_number + 63) / 64 + 1 ||
+        self->low_words_ != low_bit_number / 64 + 2 ||
+        self->sample_number_ !=
+            (zero_number + kSampleRate - 1) / kSampleRate) {
+      *status = Status::Corruption(file_path);
+    }
+  }
+
+  // The lookups trust the rows and samples, so they are checked here once
+  if (status->ok() && !self->CheckRows()) {
+    *status = Status::Corruption(file_path);
+  }
+
+  if (status->ok()) {
+    return self;
+  } else {
+    delete self;
+    return NULL;
+  }
+}
+
+uint64_t EliasFanoBigramTable::CountHighOnes(uint64_t position,
+                                             uint64_t size) const {
+  uint64_t count = 0;
+  for (uint64_t offset = 0; offset < size; offset += 64) {
+    uint64_t word = ReadWord(high_bits_, position + offset);
+    if (size - offset < 64) {
+      word &= (static_cast<uint64_t>(1) << (size - offset)) - 1;
+    }
+    count += BytePrefixSums(word) >> 56;
+  }
+  return count;
+}
+
+bool EliasFanoBigramTable::CheckRows() const {
+  const Row &first_row = rows_[0];
+  if (first_row.offset != 0 ||
+      first_row.high_offset != 0 ||
+      first_row.low_offset != 0) {
+    return false;
+  }
+
+  // A non-empty row of n right ids has n set bits and a zero for each
+  // bucket in its high bits, and n * low_bits low bits
+  uint64_t high_bit_number = rows_[left_number_].high_offset;
+  for (int left_id = 0; left_id <= left_number_; ++left_id) {
+    const Row &row = rows_[left_id];
+    if (left_id < left_number_) {
+      const Row &next_row = rows_[left_id + 1];
+      if (next_row.offset < row.offset || row.low_bits >= 32) return false;
+
+      uint64_t row_size = next_row.offset - row.offset;
+      uint64_t high_size = 0;
+      if (row_size > 0) {
+        high_size = row_size + ((right_universe_ - 1) >> row.low_bits) + 1;
+      }
+      if (next_row.high_offset != row.high_offset + high_size ||
+          next_row.low_offset != row.low_offset + row_size * row.low_bits ||
+          CountHighOnes(row.high_offset, high_size) != row_size) {
+        return false;
+      }
+    }
+
+    uint64_t high_window = 0;
+    if (row.high_offset < high_bit_number) {
+      high_window = ReadWord(high_bits_, row.high_offset);
+    }
+    if (row.high_window != high_window) return false;
+  }
+
+  // Finds the sampled zeros word by word
+  uint64_t zero_rank = 0;
+  int sample = 0;
+  for (uint64_t position = 0; position < high_bit_number; position += 64) {
+    uint64_t zeros = ~high_bits_[position / 64];
+    if (high_bit_number - position < 64) {
+      zeros &= (static_cast<uint64_t>(1) << (high_bit_number - position)) - 1;
+    }
+    uint64_t zero_sums = BytePrefixSums(zeros);
+    uint64_t zero_count = zero_sums >> 56;
+    uint64_t next_zero_rank = zero_rank + zero_count;
+    while (sample < sample_number_ &&
+           static_cast<uint64_t>(sample) * kSampleRate < next_zero_rank) {
+      int rank = static_cast<int>(sample * kSampleRate - zero_rank);
+      if (zero_samples_[sample] !=
+          position + SelectInWord(zeros, zero_sums, rank)) {
+        return false;
+      }
+      ++sample;
+    }
+    zero_rank = next_zero_rank;
+  }
+  return sample == sample_number_;
+}
+
+void EliasFanoBigramTable::Save(const char *file_path, Status *status) const {
+  WritableFile *fd = WritableFile::New(file_path, status);
+
+  Header header;
+  memset(&header, 0, sizeof(header));
+  header.magic_number = kMagicNumber;
+  header.left_number = left_number_;
+  header.pair_number = pair_number_;
+  header.right_universe = right_universe_;
+  header.high_words = high_words_;
+  header.low_words = low_words_;
+  header.sample_number = sample_number_;
+  header.cost_base = cost_base_;
+  header.cost_step = cost_step_;
+  if (status->ok()) fd->Write(&header, sizeof(header), status);
+  if (status->ok()) {
+    fd->Write(high_bits_, sizeof(uint64_t) * high_words_, status);
+  }
+  if (status->ok()) {
+    fd->Write(low_bits_, sizeof(uint64_t) * low_words_, status);
+  }
+  if (status->ok()) {
+    fd->Write(rows_, sizeof(Row) * (left_number_ + 1), status);
+  }
+  if (status->ok()) {
+    fd->Write(zero_samples_, sizeof(uint32_t) * sample_number_, status);
+  }
+  if (status->ok()) fd->Write(costs_, pair_number_, status);
+
+  delete fd;
+}
+
+inline uint64_t EliasFanoBigramTable::SelectZeroFrom(uint64_t position,
+                                                     int rank) const {
+  // Starting from a sampled zero, the zero is nearly always in the first two
+  // words, so they are chosen without branches
+  uint64_t word_index = position / 64;
+  uint64_t mask = ~static_cast<uint64_t>(0) << (position % 64);
+  uint64_t word = ~high_bits_[word_index] & mask;
+  uint64_t next_word = ~high_bits_[word_index + 1];
+  uint64_t byte_sums = BytePrefixSums(word);
+  uint64_t next_byte_sums = BytePrefixSums(next_word);
+  int count = static_cast<int>(byte_sums >> 56);
+  uint64_t in_next_word = static_cast<uint64_t>(
+      static_cast<int64_t>(count - rank - 1) >> 63);
+  word = (word & ~in_next_word) | (next_word & in_next_word);
+  byte_sums = (byte_sums & ~in_next_word) | (next_byte_sums & in_next_word);
+  word_index += in_next_word & 1;
+  rank -= count & static_cast<int>(in_next_word);
+
+  count = static_cast<int>(byte_sums >> 56);
+  while (rank >= count) {
+    rank -= count;
+    word = ~high_bits_[++word_index];
+    byte_sums = BytePrefixSums(word);
+    count = static_cast<int>(byte_sums >> 56);
+  }
+  return word_index * 64 + SelectInWord(word, byte_sums, rank);
+}
+
+inline void EliasFanoBigramTable::FindShortRow(const Row &row,
+                                               const int *right_ids,
+                                               int right_number,
+                                               float *costs,
+                                               int stride) const {
+  // The high bits of the row are in its high window. With a zero put before
+  // them, the bucket of high bits `h` starts after the zero `h` of `zeros`,
+  // and the zero ending the bucket is still in the window
+  uint64_t high_window = row.high_window;
+  uint64_t zeros = ~(high_window << 1);
+  uint64_t zero_sums = BytePrefixSums(zeros);
+  int low_bits = row.low_bits;
+  uint64_t low_mask = (static_cast<uint64_t>(1) << low_bits) - 1;
+
+  for (int j = 0; j < right_number; ++j) {
+    int right_id = right_ids[j];
+    float cost = kNoCost;
+    if (right_id >= 0 && right_id < right_universe_) {
+      int right_high = right_id >> low_bits;
+      uint64_t low = right_id & low_mask;
+      int position = SelectInWord(zeros, zero_sums, right_high);
+      int index = position - right_high;
+
+      // Most buckets have at most two right ids, they are compared without
+      // branches, since whether a right id is in the table is unpredictable.
+      // The low bits of two right ids are in one word
+      uint64_t bucket = high_window >> position;
+      uint64_t lows = ReadWord(low_bits_,
+                               row.low_offset +
+                               static_cast<uint64_t>(index) * low_bits);
+      uint64_t first_low = lows & low_mask;
+      uint64_t second_low = (lows >> low_bits) & low_mask;
+      int first_hit = static_cast<int>(bucket & 1) & (first_low == low);
+      int second_hit = ((bucket & 3) == 3) & (second_low == low);
+      int hit = first_hit | second_hit;
+      index += second_hit;
+
+      // The bucket has more right ids less than `right_id`, which is rare
+      int more = ((bucket & 7) == 7) & !hit & (second_low < low);
+      if (more) {
+        for (int k = 2; (bucket >> k) & 1; ++k) {
+          uint64_t value_low = ReadWord(low_bits_,
+                                        row.low_offset +
+                                        static_cast<uint64_t>(index + k) *
+                                        low_bits) & low_mask;
+          if (value_low >= low) {
+            hit = value_low == low;
+            index += k;
+            break;
+          }
+        }
+      }
+
+      int cost_index = hit? row.offset + index: 0;
+      float found_cost = cost_base_ + costs_[cost_index] * cost_step_;
+      cost = hit? found_cost: kNoCost;
+    }
+    costs[j * stride] = cost;
+  }
+}
+
+void EliasFanoBigramTable::FindRow(const Row &row,
+                                   const int *right_ids,
+                                   const int *order,
+                                   int right_number,
+                                   float *costs,
+                                   int stride) const {
+  uint64_t zeros_before = row.high_offset - row.offset;
+  uint64_t low_mask = (static_cast<uint64_t>(1) << row.low_bits) - 1;
+
+  // The cursor `position` is in the bucket `high` of the row, the right ids
+  // before it are less than the right id looked up. Each bit before it is a
+  // right id or the end of a bucket, so the set bit at it is the right id
+  // `position - zeros_before - high`
+  uint64_t position = row.high_offset;
+  uint64_t high = 0;
+  int j = 0;
+  for (; j < right_number; ++j) {
+    int right_id = right_ids[order[j]];
+    if (right_id >= right_universe_) break;
+
+    float cost = kNoCost;
+    if (right_id >= 0) {
+      // The bucket starts after the zero `right_high - 1` of the row. It is
+      // selected from the cursor, or from the sampled zero before it if the
+      // sample is after the cursor
+      uint64_t right_high = right_id >> row.low_bits;
+      if (right_high > high) {
+        uint64_t rank = zeros_before + right_high - 1;
+        uint64_t sample = zero_samples_[rank / kSampleRate];
+        if (sample > position) {
+          position = SelectZeroFrom(sample, rank % kSampleRate) + 1;
+        } else {
+          position = SelectZeroFrom(
+              position, static_cast<int>(right_high - high - 1)) + 1;
+        }
+        high = right_high;
+      }
+
+      // Each right id in the bucket is a set bit from `position`, stops at
+      // the first one not less than `right_id`
+      uint64_t low = right_id & low_mask;
+      uint64_t index = position - zeros_before - high;
+      uint64_t low_position = row.low_offset +
+                              (index - row.offset) * row.low_bits;
+      while ((high_bits_[position / 64] >> (position % 64)) & 1) {
+        uint64_t value_low = ReadWord(low_bits_, low_position) & low_mask;
+        if (value_low == low) {
+          cost = cost_base_ + costs_[index] * cost_step_;
+          break;
+        } else if (value_low > low) {
+          break;
+        }
+        ++position;
+        ++index;
+        low_position += row.low_bits;
+      }
+    }
+    costs[order[j] * stride] = cost;
+  }
+
+  // The rest of right ids are out of the row
+  for (; j < right_number; ++j) costs[order[j] * stride] = kNoCost;
+}
+
+void EliasFanoBigramTable::FindPairs(const int *left_ids,
+                                     int left_number,
+                                     const int *right_ids,
+                                     int right_number,
+                                     float *costs) const {
+  int order[kMaxBatchSize];
+  for (int begin = 0; begin < right_number; begin += kMaxBatchSize) {
+    int size = std::min(static_cast<int>(kMaxBatchSize),
+                        right_number - begin);
+    const int *batch_right_ids = right_ids + begin;
+    bool sorted = false;
+
+    for (int i = 0; i < left_number; ++i) {
+      int left_id = left_ids[i];
+      float *row_costs = costs + begin * left_number + i;
+      if (left_id < 0 || left_id >= left_number_ ||
+          rows_[left_id].offset == rows_[left_id + 1].offset) {
+        for (int j = 0; j < size; ++j) row_costs[j * left_number] = kNoCost;
+        continue;
+      }
+
+      // The right ids are only sorted for the long rows
+      const Row &row = rows_[left_id];
+      const Row &next_row = rows_[left_id + 1];
+      if (next_row.high_offset - row.high_offset < 64) {
+        FindShortRow(row,
+                     batch_right_ids,
+                     size,
+                     row_costs,
+                     left_number);
+      } else {
+        if (!sorted) SortIds(batch_right_ids, size, order);
+        sorted = true;
+        FindRow(row, batch_right_ids, order, size, row_costs, left_number);
+      }
+    }
+  }
+}
+
+}  // namespace milkcat
@@ -0,0 +1,185 @@
+//
+// The MIT License (MIT)
+//
+// Copyright 2013-2014 The MilkCat Project Developers
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// elias_fano_bigram_table.h --- Created at 2015-01-15
+//
+
+#ifndef SRC_COMMON_ELIAS_FANO_BIGRAM_TABLE_H_
+#define SRC_COMMON_ELIAS_FANO_BIGRAM_TABLE_H_
+
+#include <stdint.h>
+#include <vector>
+#include "common/bigram_table.h"
+#include "utils/utils.h"
+
+namespace milkcat {
+
+class Bundle;
+class MappedFile;
+class Status;
+
+// EliasFanoBigramTable is the succinct bigram table for low-memory
+// deployments. The right ids of each left id form a row, which is Elias-Fano
+// coded with its own number of low bits: the low bits of each right id are
+// packed as is, and the high bits are stored in unary, as a set bit for each
+// right id and a zero ending each bucket of the same high bits. The high bits
+// of all the rows are in one bit vector with sampled positions of zeros, so
+// a lookup selects its bucket and then compares the low bits in it. The costs
+// are quantized into 8 bits
+class EliasFanoBigramTable: public BigramTable {
+ public:
+  static const int32_t kMagicNumber = 0x3331;
+
+  // Builds the table from `size` bigrams, the key of a bigram is
+  // (left_id << 32) + right_id and both ids are not negative
+  static EliasFanoBigramTable *Build(const int64_t *keys,
+                                     const float *costs,
+                                     int size);
+
+  // Maps the table file `file_path` into memory. If `bundle` is not NULL,
+  // maps its section named `file_path`
+  static EliasFanoBigramTable *New(const char *file_path,
+                                   Status *status,
+                                   const Bundle *bundle = NULL);
+
+  ~EliasFanoBigramTable();
+
+  // Saves the table into `file_path`
+  void Save(const char *file_path, Status *status) const;
+
+  void FindPairs(const int *left_ids,
+                 int left_number,
+                 const int *right_ids,
+                 int right_number,
+                 float *costs) const;
+
+  int size() const { return pair_number_; }
+
+ private:
+  // File header, followed by `high_words` words of high bits, `low_words`
+  // words of low bits, `left_number + 1` rows, `sample_number` positions of
+  // zeros and `pair_number` quantized costs
+  struct Header {
+    int32_t magic_number;
+    int32_t left_number;
+    int32_t pair_number;
+    int32_t right_universe;
+    int32_t high_words;
+    int32_t low_words;
+    int32_t sample_number;
+    float cost_base;
+    float cost_step;
+    int32_t reserved;
+  };
+
+  // The right ids of left id `i` are [rows_[i].offset, rows_[i + 1].offset),
+  // their high bits start from bit rows_[i].high_offset of `high_bits_` and
+  // their low bits, each takes rows_[i].low_bits bits, start from bit
+  // rows_[i].low_offset of `low_bits_`. The last row only ends the others.
+  // rows_[i].high_window is a copy of the first 64 high bits, so a short row
+  // is looked up without reading `high_bits_`
+  struct Row {
+    uint32_t offset;
+    uint32_t high_offset;
+    uint32_t low_offset;
+    uint32_t low_bits;
+    uint64_t high_window;
+  };
+
+  enum {
+    // The position of every kSampleRate-th zero in the high bits is sampled
+    kSampleRate = 32,
+
+    // Number of right ids sorted and intersected with the rows together
+    kMaxBatchSize = 64
+  };
+
+  int left_number_;
+  int pair_number_;
+  int right_universe_;
+  int high_words_;
+  int low_words_;
+  int sample_number_;
+  float cost_base_;
+  float cost_step_;
+
+  // The position of the zero `k * kSampleRate` in `high_bits_` is
+  // zero_samples_[k]
+  const uint64_t *high_bits_;
+  const uint64_t *low_bits_;
+  const Row *rows_;
+  const uint32_t *zero_samples_;
+  const uint8_t *costs_;
+
+  // The arrays of a table built in memory, and the mapped file of a table
+  // loaded from file
+  std::vector<uint64_t> high_bit_data_;
+  std::vector<uint64_t> low_bit_data_;
+  std::vector<Row> row_data_;
+  std::vector<uint32_t> zero_sample_data_;
+  std::vector<uint8_t> cost_data_;
+  MappedFile *mapped_file_;
+
+  EliasFanoBigramTable();
+
+  // Points the arrays to the data built in memory
+  void UseBuiltData();
+
+  // Checks that each row has the offsets, high bits and high window written
+  // by `Build`, and the samples are the positions of zeros. Returns false if
+  // the data could not come from `Build`
+  bool CheckRows() const;
+
+  // Gets the number of set bits in `size` bits from bit `position` of the
+  // high bits
+  uint64_t CountHighOnes(uint64_t position, uint64_t size) const;
+
+  // Gets the position of the zero `rank` in the high bits, counting from the
+  // zero at bit `position`
+  uint64_t SelectZeroFrom(uint64_t position, int rank) const;
+
+  // Finds the costs of the non-empty row `row`, whose high bits are less than
+  // 64 bits, with `right_ids` in any order. Stores the cost of right_ids[j]
+  // into costs[j * stride]
+  void FindShortRow(const Row &row,
+                    const int *right_ids,
+                    int right_number,
+                    float *costs,
+                    int stride) const;
+
+  // Finds the costs of the non-empty row `row` with the right ids
+  // right_ids[order[0]], right_ids[order[1]], ... in ascending order. Stores
+  // the cost of right_ids[order[j]] into costs[order[j] * stride]. The bucket
+  // of each right id is selected forward from the previous one
+  void FindRow(const Row &row,
+               const int *right_ids,
+               const int *order,
+               int right_number,
+               float *costs,
+               int stride) const;
+
+  DISALLOW_COPY_AND_ASSIGN(EliasFanoBigramTable);
+};
+
+}  // namespace milkcat
+
+#endif  // SRC_COMMON_ELIAS_FANO_BIGRAM_TABLE_H_
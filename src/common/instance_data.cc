@@ -27,51 +27,58 @@
 
 #include "common/instance_data.h"
 
+#include <string>
+
 namespace milkcat {
 
 InstanceData::InstanceData(int string_number,
                            int integer_number,
-                           int capability): string_data_(NULL),
-                                            integer_data_(NULL),
-                                            size_(0) {
-  if (string_number != 0) {
-    string_data_ = new char **[string_number];
-    for (int i = 0; i < string_number; ++i) {
-      string_data_[i] = new char *[capability];
-      for (size_t j = 0; j < capability; ++j) {
-        string_data_[i][j] = new char[kFeatureLengthMax];
-      }
-    }
-  }
-
-  if (integer_number != 0) {
-    integer_data_ = new int *[integer_number];
-    for (int i = 0; i < integer_number; ++i) {
-      integer_data_[i] = new int[capability];
-    }
-  }
-
-  string_number_ = string_number;
-  integer_number_ = integer_number;
-  capability_ = capability;
+                           int capacity): integer_data_(integer_number),
+                                          string_slots_(string_number),
+                                          string_number_(string_number),
+                                          integer_number_(integer_number),
+                                          size_(0),
+                                          capacity_(0) {
+  // The empty string for the positions never set
+  string_pool_.push_back('\0');
+  if (capacity > 0) Grow(capacity);
 }
 
 InstanceData::~InstanceData() {
-  if (string_data_ != NULL) {
-    for (int i = 0; i < string_number_; ++i) {
-      for (size_t j = 0; j < capability_; ++j) {
-        delete[] string_data_[i][j];
-      }
-      delete[] string_data_[i];
-    }
-    delete[] string_data_;
+}
+
+void InstanceData::Grow(int capacity) {
+  if (capacity < capacity_ * 2) capacity = capacity_ * 2;
+
+  StringSlot empty_slot;
+  empty_slot.offset = 0;
+  empty_slot.capacity = 0;
+  for (int i = 0; i < string_number_; ++i) {
+    string_slots_[i].resize(capacity, empty_slot);
+  }
+  for (int i = 0; i < integer_number_; ++i) {
+    integer_data_[i].resize(capacity);
   }
+  capacity_ = capacity;
+}
+
+void InstanceData::set_string_at(int position,
+                                 int string_id,
+                                 const char *string_val) {
+  assert(string_id < string_number_);
+  if (position >= capacity_) Grow(position + 1);
 
-  if (integer_data_ != NULL) {
-    for (int i = 0; i < integer_number_; ++i) {
-      delete[] integer_data_[i];
-    }
-    delete[] integer_data_;
+  StringSlot *slot = &string_slots_[string_id][position];
+  int size = strlen(string_val) + 1;
+  if (size > slot->capacity) {
+    // `string_val` may be in the string pool, which is moved by resize
+    std::string value(string_val);
+    slot->offset = string_pool_.size();
+    slot->capacity = size;
+    string_pool_.resize(string_pool_.size() + size);
+    memcpy(&string_pool_[slot->offset], value.c_str(), size);
+  } else {
+    memmove(&string_pool_[slot->offset], string_val, size);
   }
 }
 
@@ -30,27 +30,30 @@
 
 #include <assert.h>
 #include <string.h>
+#include <vector>
 #include "common/milkcat_config.h"
 #include "utils/utils.h"
 
 namespace milkcat {
 
+// The data of an instance, which has `string_number` strings and
+// `integer_number` integers at each position. The integers are stored in one
+// array for each integer_id, and the strings are stored in one string pool.
+// It grows when a value is set at a position beyond its capacity, so it is
+// sized by the longest instance ever stored
 class InstanceData {
  public:
-  InstanceData(int string_number, int integer_number, int capability);
+  InstanceData(int string_number, int integer_number, int capacity = 0);
   ~InstanceData();
 
   // Get the string of string_id at the position of this instance
   const char *string_at(int position, int string_id) const {
     assert(position < size_ && string_id < string_number_);
-    return string_data_[string_id][position];
+    return &string_pool_[string_slots_[string_id][position].offset];
   }
 
   // Set the string of string_id at the position of this instance
-  void set_string_at(int position, int string_id, const char *string_val) {
-    assert(string_id < string_number_);
-    strlcpy(string_data_[string_id][position], string_val, kFeatureLengthMax);
-  }
+  void set_string_at(int position, int string_id, const char *string_val);
 
   // Get the integer of integer_id at the position of this instance
   const int integer_at(int position, int integer_id) const {
@@ -61,6 +64,7 @@ class InstanceData {
   // Set the integer of integer_id at the position of this instance
   void set_integer_at(int position, int integer_id, int integer_val) {
     assert(integer_id < integer_number_);
+    if (position >= capacity_) Grow(position + 1);
     integer_data_[integer_id][position] = integer_val;
   }
 
@@ -68,15 +72,29 @@ class InstanceData {
   int size() const { return size_; }
 
   // Set the size of this instance
-  void set_size(int size) { size_ = size; }
+  void set_size(int size) {
+    if (size > capacity_) Grow(size);
+    size_ = size;
+  }
 
  private:
-  char ***string_data_;
-  int **integer_data_;
+  // The place of a string in string_pool_. If a new string is longer than
+  // `capacity`, it is put into a new slot at the end of string_pool_
+  struct StringSlot {
+    int offset;
+    int capacity;
+  };
+
+  std::vector<std::vector<int> > integer_data_;
+  std::vector<std::vector<StringSlot> > string_slots_;
+  std::vector<char> string_pool_;
   int string_number_;
   int integer_number_;
   int size_;
-  int capability_;
+  int capacity_;
+
+  // Grows the capacity to at least `capacity` positions
+  void Grow(int capacity);
 
   DISALLOW_COPY_AND_ASSIGN(InstanceData);
 };
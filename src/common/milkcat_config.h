@@ -33,8 +33,9 @@
 namespace milkcat {
 
 enum {
-  kSequenceMax = 4096,
-  kTokenMax = kSequenceMax,
+  kDecodeWindow = 256,
+  kDecodeWindowMax = 2 * kDecodeWindow,
+  kDecodeBufferCap = 4 * kDecodeWindow,
   kFeatureLengthMax = 100,
   kTermLengthMax = kFeatureLengthMax,
   kPOSTagLengthMax = 10,
@@ -28,12 +28,17 @@
 #include "common/model_impl.h"
 
 #include "ml/perceptron_model.h"
+#include "common/bundle.h"
 #include "common/milkcat_config.h"
 #include "common/trie_tree.h"
+#include "common/user_dictionary.h"
 #include "common/static_array.h"
-#include "common/static_hashtable.h"
+#include "common/bigram_table.h"
 #include "ml/crf_model.h"
 #include "ml/hmm_model.h"
+#include "utils/atomic.h"
+#include "utils/thread.h"
+#include "utils/mapped_file.h"
 
 namespace milkcat {
 
@@ -51,12 +56,67 @@ const char *kDependenctTemplateFile = "depparse.tmpl";
 
 // ---------- Model::Impl ----------
 
-Model::Impl::Impl(const char *model_dir_path):
+// Merges the first layers of a user dictionary snapshot in background, then
+// replaces them in the current user dictionary with the merged one
+class Model::Impl::UserDictionaryCompactor: public Thread {
+ public:
+  // If `system_index` is not NULL, the compacted layer is combined with it
+  UserDictionaryCompactor(Model::Impl *model_impl,
+                          UserDictionary *snapshot,
+                          int layer_number,
+                          const DoubleArrayTrieTree *system_index,
+                          const StaticArray<float> *system_cost):
+      model_impl_(model_impl),
+      snapshot_(snapshot),
+      layer_number_(layer_number),
+      system_index_(system_index),
+      system_cost_(system_cost) {
+    snapshot_->AddRef();
+  }
+
+  ~UserDictionaryCompactor() {
+    snapshot_->Release();
+    snapshot_ = NULL;
+  }
+
+ protected:
+  void Run() {
+    UserDictionary::Layer *compacted = snapshot_->Compact(layer_number_,
+                                                          system_index_,
+                                                          system_cost_);
+
+    model_impl_->user_dictionary_update_mutex_.Lock();
+    UserDictionary *user_dictionary = model_impl_->user_dictionary_->Replace(
+        snapshot_,
+        compacted,
+        layer_number_,
+        model_impl_->user_dictionary_version_ + 1);
+
+    // The user dictionary is replaced by SetUserDictionary if NULL
+    if (user_dictionary != NULL) {
+      model_impl_->UpdateUserDictionary(user_dictionary);
+    }
+    model_impl_->compacting_layers_ = 0;
+    model_impl_->user_dictionary_update_mutex_.Unlock();
+  }
+
+ private:
+  Model::Impl *model_impl_;
+  UserDictionary *snapshot_;
+  int layer_number_;
+  const DoubleArrayTrieTree *system_index_;
+  const StaticArray<float> *system_cost_;
+};
+
+Model::Impl::Impl(const char *model_dir_path, Bundle *bundle):
     model_dir_path_(model_dir_path),
+    bundle_(bundle),
+    user_dictionary_(NULL),
+    user_dictionary_version_(0),
+    compacting_layers_(0),
+    compactor_(NULL),
     unigram_index_(NULL),
-    user_index_(NULL),
     unigram_cost_(NULL),
-    user_cost_(NULL),
     bigram_cost_(NULL),
     seg_model_(NULL),
     crf_pos_model_(NULL),
@@ -68,8 +128,12 @@ Model::Impl::Impl(const char *model_dir_path):
 }
 
 Model::Impl::~Impl() {
-  delete user_index_;
-  user_index_ = NULL;
+  if (compactor_ != NULL) compactor_->Join();
+  delete compactor_;
+  compactor_ = NULL;
+
+  if (user_dictionary_ != NULL) user_dictionary_->Release();
+  user_dictionary_ = NULL;
 
   delete unigram_index_;
   unigram_index_ = NULL;
@@ -77,9 +141,6 @@ Model::Impl::~Impl() {
   delete unigram_cost_;
   unigram_cost_ = NULL;
 
-  delete user_cost_;
-  user_cost_ = NULL;
-
   delete bigram_cost_;
   bigram_cost_ = NULL;
 
@@ -103,25 +164,62 @@ Model::Impl::~Impl() {
 
   delete dependency_feature_;
   dependency_feature_ = NULL;
+
+  // Models may point into the mapping of bundle, so delete it at last
+  delete bundle_;
+  bundle_ = NULL;
 }
 
-const TrieTree *Model::Impl::Index(Status *status) {
-  mutex.Lock();
+Model::Impl *Model::Impl::New(const char *model_path, Status *status) {
+  std::string model_dir_path = model_path;
+  std::string bundle_path;
+  if (Bundle::IsBundle(model_path)) {
+    bundle_path = model_path;
+  } else {
+    if (model_dir_path.size() > 0 &&
+        model_dir_path[model_dir_path.size() - 1] != '/') {
+      model_dir_path.push_back('/');
+    }
+    std::string default_bundle = model_dir_path + Bundle::kDefaultFilename;
+    if (Bundle::IsBundle(default_bundle.c_str())) bundle_path = default_bundle;
+  }
+
+  if (bundle_path.empty()) return new Impl(model_dir_path.c_str());
+
+  Bundle *bundle = Bundle::Open(bundle_path.c_str(), status);
+  if (status->ok()) {
+    return new Impl("", bundle);
+  } else {
+    return NULL;
+  }
+}
+
+const DoubleArrayTrieTree *Model::Impl::Index(Status *status) {
+  const DoubleArrayTrieTree *component = AcquireLoad(&unigram_index_);
+  if (component != NULL) return component;
+
+  component_mutex_[kUnigramIndex].Lock();
   if (unigram_index_ == NULL) {
     std::string model_path = model_dir_path_ + kUnigramIndexFile;
-    unigram_index_ = DoubleArrayTrieTree::New(model_path.c_str(), status);
+    component = DoubleArrayTrieTree::New(model_path.c_str(),
+                                         status,
+                                         MappedFile::kDefaultModelFlags,
+                                         bundle_);
+    ReleaseStore(&unigram_index_, component);
   }
-  mutex.Unlock();
-  return unigram_index_;
+  component = unigram_index_;
+  component_mutex_[kUnigramIndex].Unlock();
+  return component;
 }
 
-void Model::Impl::LoadUserDictionary(const char *path, Status *status) {
+void Model::Impl::LoadUserDictionary(const char *path,
+                                     bool combined,
+                                     Status *status) {
   char line[1024], word[1024];
   std::string errmsg;
   ReadableFile *fd;
   float default_cost = kDefaultCost, cost;
-  std::vector<float> user_costs;
-  std::map<std::string, int> term_ids;
+  std::map<std::string, float> words;
 
   if (status->ok()) fd = ReadableFile::New(path, status);
   while (status->ok() && !fd->Eof()) {
@@ -140,39 +238,88 @@ void Model::Impl::LoadUserDictionary(const char *path, Status *status) {
         trim(word);
         cost = default_cost;
       }
-      term_ids.insert(std::pair<std::string, int>(
-          word, 
-          kUserTermIdStart + term_ids.size()));
-      user_costs.push_back(cost);
+
+      // The first entry of a word is used
+      words.insert(std::make_pair(word, cost));
     }
   }
 
-  if (status->ok() && term_ids.size() == 0) {
+  if (status->ok() && words.size() == 0) {
     errmsg = std::string("User dictionary ") + path + " is empty.";
     *status = Status::Corruption(errmsg.c_str());
   }
 
-
-  // Build the index and the cost array from user dictionary
-  if (status->ok()) {
-    delete user_index_;
-    user_index_ = DoubleArrayTrieTree::NewFromMap(term_ids);
+  // The system dictionary to combine with
+  const DoubleArrayTrieTree *system_index = NULL;
+  const StaticArray<float> *system_cost = NULL;
+  if (status->ok() && combined) {
+    Index(status);
+    if (status->ok()) system_cost = UnigramCost(status);
+    if (status->ok()) system_index = unigram_index_;
   }
+
   if (status->ok()) {
-    delete user_cost_;
-    user_cost_ = StaticArray<float>::NewFromArray(user_costs.data(),
-                                                  user_costs.size());
+    user_dictionary_update_mutex_.Lock();
+    UpdateUserDictionary(UserDictionary::New(words,
+                                             user_dictionary_version_ + 1,
+                                             system_index,
+                                             system_cost));
+    user_dictionary_update_mutex_.Unlock();
   }
 
   delete fd;
 }
 
-bool Model::Impl::SetUserDictionary(const char *path) {
-  Status status;
+void Model::Impl::UpdateUserDictionary(UserDictionary *user_dictionary) {
+  mutex.Lock();
+  UserDictionary *previous = user_dictionary_;
+  user_dictionary_ = user_dictionary;
+  ReleaseStore(&user_dictionary_version_, user_dictionary->version());
+  mutex.Unlock();
+
+  // The previous snapshot is deleted after the last segmenter releases it
+  if (previous != NULL) previous->Release();
+}
+
+void Model::Impl::CompactUserDictionary() {
+  if (compacting_layers_ != 0) return;
+  if (!user_dictionary_->NeedsCompaction()) return;
+
+  // The previous compactor has finished its work since compacting_layers_ is
+  // 0, so it will not wait for the lock
+  if (compactor_ != NULL) compactor_->Join();
+  delete compactor_;
+
+  compacting_layers_ = user_dictionary_->layer_number();
+  bool combined = user_dictionary_->combined_index() != NULL;
+  compactor_ = new UserDictionaryCompactor(
+      this,
+      user_dictionary_,
+      compacting_layers_,
+      combined? AcquireLoad(&unigram_index_): NULL,
+      combined? AcquireLoad(&unigram_cost_): NULL);
+
+  // Compacts again on the next update if the thread could not be created
+  if (!compactor_->Start()) {
+    delete compactor_;
+    compactor_ = NULL;
+    compacting_layers_ = 0;
+  }
+}
+
+UserDictionary *Model::Impl::AcquireUserDictionary() {
   mutex.Lock();
-  LoadUserDictionary(path, &status);
+  UserDictionary *user_dictionary = user_dictionary_;
+  if (user_dictionary != NULL) user_dictionary->AddRef();
   mutex.Unlock();
 
+  return user_dictionary;
+}
+
+bool Model::Impl::SetUserDictionary(const char *path, bool combined) {
+  Status status;
+  LoadUserDictionary(path, combined, &status);
+
   if (status.ok()) {
     return true;
   } else {
@@ -182,137 +329,347 @@ bool Model::Impl::SetUserDictionary(const char *path) {
 
 void Model::Impl::SetUserDictionary(
     const unordered_map<std::string, float> &words) {
-  std::map<std::string, int> term_ids;
-  std::vector<float> costs;
-
-  mutex.Lock();
-  for (unordered_map<std::string, float>::const_iterator
-       it = words.begin(); it != words.end(); ++it) {
-    term_ids.insert(std::make_pair(
-        it->first, 
-        kUserTermIdStart + term_ids.size()));
-    costs.push_back(it->second);
-  }
+  std::map<std::string, float> sorted_words(words.begin(), words.end());
 
-  delete user_index_;
-  user_index_ = DoubleArrayTrieTree::NewFromMap(term_ids);
-
-  delete user_cost_;
-  user_cost_ = StaticArray<float>::NewFromArray(costs.data(), costs.size());
-  mutex.Unlock();  
+  user_dictionary_update_mutex_.Lock();
+  UpdateUserDictionary(UserDictionary::New(sorted_words,
+                                           user_dictionary_version_ + 1));
+  user_dictionary_update_mutex_.Unlock();
 }
 
-const TrieTree *Model::Impl::UserIndex(Status *status) {
-  if (user_index_) {
-    return user_index_;
+void Model::Impl::AddUserWords(const std::map<std::string, float> &words) {
+  user_dictionary_update_mutex_.Lock();
+  int64_t version = user_dictionary_version_ + 1;
+  if (user_dictionary_ == NULL) {
+    UpdateUserDictionary(UserDictionary::New(words, version));
   } else {
-    *status = Status::RuntimeError("No user dictionary");
-    return NULL;
+    UpdateUserDictionary(user_dictionary_->Add(words,
+                                               compacting_layers_,
+                                               version));
+    CompactUserDictionary();
   }
+  user_dictionary_update_mutex_.Unlock();
 }
 
-const StaticArray<float> *Model::Impl::UserCost(Status *status) {
-  if (user_cost_) {
-    return user_cost_;
-  } else {
-    *status = Status::RuntimeError("No user dictionary");
-    return NULL;
+void Model::Impl::RemoveUserWords(const std::vector<std::string> &words) {
+  user_dictionary_update_mutex_.Lock();
+  if (user_dictionary_ != NULL) {
+    UpdateUserDictionary(user_dictionary_->Remove(
+        words,
+        compacting_layers_,
+        user_dictionary_version_ + 1));
+    CompactUserDictionary();
   }
+  user_dictionary_update_mutex_.Unlock();
 }
 
 const StaticArray<float> *Model::Impl::UnigramCost(Status *status) {
-  mutex.Lock();
+  const StaticArray<float> *component = AcquireLoad(&unigram_cost_);
+  if (component != NULL) return component;
+
+  component_mutex_[kUnigramCost].Lock();
   if (unigram_cost_ == NULL) {
     std::string model_path = model_dir_path_ + kUnigramDataFile;
-    unigram_cost_ = StaticArray<float>::New(model_path.c_str(), status);
+    component = StaticArray<float>::Mmap(model_path.c_str(), status, bundle_);
+    ReleaseStore(&unigram_cost_, component);
   }
-  mutex.Unlock();
-  return unigram_cost_;
+  component = unigram_cost_;
+  component_mutex_[kUnigramCost].Unlock();
+  return component;
 }
 
-const StaticHashTable<int64_t, float> *Model::Impl::BigramCost(
-    Status *status) {
-  mutex.Lock();
+const BigramTable *Model::Impl::BigramCost(Status *status) {
+  const BigramTable *component = AcquireLoad(&bigram_cost_);
+  if (component != NULL) return component;
+
+  component_mutex_[kBigramCost].Lock();
   if (bigram_cost_ == NULL) {
     std::string model_path = model_dir_path_ + kBigramDataFile;
-    bigram_cost_ = StaticHashTable<int64_t, float>::New(model_path.c_str(),
-                                                        status);
+    component = BigramTable::New(model_path.c_str(), status, bundle_);
+    ReleaseStore(&bigram_cost_, component);
   }
-  mutex.Unlock();
-  return bigram_cost_;
+  component = bigram_cost_;
+  component_mutex_[kBigramCost].Unlock();
+  return component;
 }
 
 const CRFModel *Model::Impl::CRFSegModel(Status *status) {
-  mutex.Lock();
+  const CRFModel *component = AcquireLoad(&seg_model_);
+  if (component != NULL) return component;
+
+  component_mutex_[kCRFSegModel].Lock();
   if (seg_model_ == NULL) {
     std::string model_path = model_dir_path_ + kCrfSegModelFile;
-    seg_model_ = CRFModel::New(model_path.c_str(), status);
+    CRFModel *model = CRFModel::New(model_path.c_str(), status, bundle_);
+
+    // The segmenter model has only the character feature, so builds the
+    // dense table of the character scores for it
+    if (model != NULL) model->BuildCharacterTable();
+    component = model;
+    ReleaseStore(&seg_model_, component);
   }
-  mutex.Unlock();
-  return seg_model_;
+  component = seg_model_;
+  component_mutex_[kCRFSegModel].Unlock();
+  return component;
 }
 
 const CRFModel *Model::Impl::CRFPosModel(Status *status) {
-  mutex.Lock();
+  const CRFModel *component = AcquireLoad(&crf_pos_model_);
+  if (component != NULL) return component;
+
+  component_mutex_[kCRFPosModel].Lock();
   if (crf_pos_model_ == NULL) {
     std::string model_path = model_dir_path_ + kCrfPosModelFile;
-    crf_pos_model_ = CRFModel::New(model_path.c_str(), status);
+    component = CRFModel::New(model_path.c_str(), status, bundle_);
+    ReleaseStore(&crf_pos_model_, component);
   }
-  mutex.Unlock();
-  return crf_pos_model_;
+  component = crf_pos_model_;
+  component_mutex_[kCRFPosModel].Unlock();
+  return component;
 }
 
 const HMMModel *Model::Impl::HMMPosModel(Status *status) {
-  mutex.Lock();
+  const HMMModel *component = AcquireLoad(&hmm_pos_model_);
+  if (component != NULL) return component;
+
+  component_mutex_[kHMMPosModel].Lock();
   if (hmm_pos_model_ == NULL) {
     std::string model_path = model_dir_path_ + kHmmPosModelFile;
-    hmm_pos_model_ = HMMModel::New(model_path.c_str(), status);
+    component = HMMModel::New(model_path.c_str(), status, bundle_);
+    ReleaseStore(&hmm_pos_model_, component);
   }
-  mutex.Unlock();
-  return hmm_pos_model_;
+  component = hmm_pos_model_;
+  component_mutex_[kHMMPosModel].Unlock();
+  return component;
 }
 
 const TrieTree *Model::Impl::OOVProperty(Status *status) {
-  mutex.Lock();
+  const TrieTree *component = AcquireLoad(&oov_property_);
+  if (component != NULL) return component;
+
+  component_mutex_[kOOVProperty].Lock();
   if (oov_property_ == NULL) {
     std::string model_path = model_dir_path_ + kOovPropertyFile;
-    oov_property_ = DoubleArrayTrieTree::New(model_path.c_str(), status);
+    component = DoubleArrayTrieTree::New(model_path.c_str(),
+                                         status,
+                                         MappedFile::kDefaultModelFlags,
+                                         bundle_);
+    ReleaseStore(&oov_property_, component);
   }
-  mutex.Unlock();
-  return oov_property_;
+  component = oov_property_;
+  component_mutex_[kOOVProperty].Unlock();
+  return component;
 }
 
 const TrieTree *Model::Impl::Stopword(Status *status) {
-  mutex.Lock();
+  const TrieTree *component = AcquireLoad(&stopword_);
+  if (component != NULL) return component;
+
+  component_mutex_[kStopword].Lock();
   if (stopword_ == NULL) {
     std::string model_path = model_dir_path_ + kStopwordFile;
-    stopword_ = DoubleArrayTrieTree::New(model_path.c_str(), status);
+    component = DoubleArrayTrieTree::New(model_path.c_str(),
+                                         status,
+                                         MappedFile::kDefaultModelFlags,
+                                         bundle_);
+    ReleaseStore(&stopword_, component);
   }
-  mutex.Unlock();
-  return stopword_;
+  component = stopword_;
+  component_mutex_[kStopword].Unlock();
+  return component;
 }
 
 PerceptronModel *Model::Impl::DependencyModel(Status *status) {
-  mutex.Lock();
+  PerceptronModel *component = AcquireLoad(&dependency_);
+  if (component != NULL) return component;
+
+  component_mutex_[kDependencyModel].Lock();
   if (dependency_ == NULL) {
     std::string prefix = model_dir_path_ + kDepengencyFilePrefix;
-    dependency_ = PerceptronModel::Open(prefix.c_str(), status);
+    component = PerceptronModel::Open(prefix.c_str(), status, bundle_);
+    ReleaseStore(&dependency_, component);
   }
-  mutex.Unlock();
-  return dependency_;  
+  component = dependency_;
+  component_mutex_[kDependencyModel].Unlock();
+  return component;
 }
 
 DependencyParser::FeatureTemplate *
 Model::Impl::DependencyTemplate(Status *status) {
-  mutex.Lock();
+  DependencyParser::FeatureTemplate *
+  component = AcquireLoad(&dependency_feature_);
+  if (component != NULL) return component;
+
+  component_mutex_[kDependencyTemplate].Lock();
   if (dependency_feature_ == NULL) {
     std::string prefix = model_dir_path_ + kDependenctTemplateFile;
-    dependency_feature_ = DependencyParser::FeatureTemplate::Open(
+    component = DependencyParser::FeatureTemplate::Open(
         prefix.c_str(),
-        status);
+        status,
+        bundle_);
+    ReleaseStore(&dependency_feature_, component);
   }
-  mutex.Unlock();
-  return dependency_feature_;  
+  component = dependency_feature_;
+  component_mutex_[kDependencyTemplate].Unlock();
+  return component;
+}
+
+const char *Model::Impl::ComponentName(Component component) {
+  switch (component) {
+    case kUnigramIndex: return kUnigramIndexFile;
+    case kUnigramCost: return kUnigramDataFile;
+    case kBigramCost: return kBigramDataFile;
+    case kCRFSegModel: return kCrfSegModelFile;
+    case kCRFPosModel: return kCrfPosModelFile;
+    case kHMMPosModel: return kHmmPosModelFile;
+    case kOOVProperty: return kOovPropertyFile;
+    case kStopword: return kStopwordFile;
+    case kDependencyModel: return kDepengencyFilePrefix;
+    case kDependencyTemplate: return kDependenctTemplateFile;
+    default: return "";
+  }
+}
+
+void Model::Impl::LoadComponent(Component component, Status *status) {
+  switch (component) {
+    case kUnigramIndex: Index(status); break;
+    case kUnigramCost: UnigramCost(status); break;
+    case kBigramCost: BigramCost(status); break;
+    case kCRFSegModel: CRFSegModel(status); break;
+    case kCRFPosModel: CRFPosModel(status); break;
+    case kHMMPosModel: HMMPosModel(status); break;
+    case kOOVProperty: OOVProperty(status); break;
+    case kStopword: Stopword(status); break;
+    case kDependencyModel: DependencyModel(status); break;
+    case kDependencyTemplate: DependencyTemplate(status); break;
+    default: *status = Status::RuntimeError("Invalid model component");
+  }
+}
+
+namespace {
+
+// Worker thread of Preload. Takes the next component from the shared task list
+// and loads it until all components are taken
+class PreloadThread: public Thread {
+ public:
+  struct Task {
+    Model::Impl::Component component;
+    double load_time;
+    Status status;
+  };
+
+  PreloadThread(Model::Impl *model_impl,
+                std::vector<Task> *tasks,
+                int *next_task,
+                Mutex *mutex): model_impl_(model_impl),
+                               tasks_(tasks),
+                               next_task_(next_task),
+                               mutex_(mutex) {
+  }
+
+  // Takes the tasks in the calling thread
+  void RunInCurrentThread() { Run(); }
+
+ protected:
+  void Run() {
+    for (; ; ) {
+      mutex_->Lock();
+      int task_idx = (*next_task_)++;
+      mutex_->Unlock();
+      if (task_idx >= static_cast<int>(tasks_->size())) break;
+
+      Task *task = &(*tasks_)[task_idx];
+      double start_time = Now();
+      model_impl_->LoadComponent(task->component, &task->status);
+      task->load_time = Now() - start_time;
+    }
+  }
+
+ private:
+  Model::Impl *model_impl_;
+  std::vector<Task> *tasks_;
+  int *next_task_;
+  Mutex *mutex_;
+};
+
+}  // namespace
+
+void Model::Impl::Preload(const std::vector<Component> &components,
+                          int threads,
+                          Status *status) {
+  int task_number = static_cast<int>(components.size());
+  std::vector<PreloadThread::Task> tasks(task_number);
+  for (int i = 0; i < task_number; ++i) {
+    tasks[i].component = components[i];
+    tasks[i].load_time = 0.0;
+  }
+
+  if (threads <= 0) threads = HardwareConcurrency();
+  if (threads > task_number) threads = task_number;
+  if (threads < 1) threads = 1;
+
+  // The calling thread takes the remaining tasks if a worker could not be
+  // started
+  int next_task = 0;
+  Mutex task_mutex;
+  std::vector<PreloadThread *> workers;
+  for (int i = 0; i < threads; ++i) {
+    PreloadThread *worker = new PreloadThread(this,
+                                              &tasks,
+                                              &next_task,
+                                              &task_mutex);
+    if (worker->Start()) {
+      workers.push_back(worker);
+    } else {
+      worker->RunInCurrentThread();
+      delete worker;
+      break;
+    }
+  }
+  for (int i = 0; i < static_cast<int>(workers.size()); ++i) {
+    workers[i]->Join();
+    delete workers[i];
+  }
+
+  preload_mutex_.Lock();
+  preload_components_.clear();
+  preload_times_.clear();
+  for (int i = 0; i < task_number; ++i) {
+    preload_components_.push_back(tasks[i].component);
+    preload_times_.push_back(tasks[i].load_time);
+    if (status->ok() && !tasks[i].status.ok()) *status = tasks[i].status;
+  }
+  preload_mutex_.Unlock();
+}
+
+int Model::Impl::preload_number() const {
+  preload_mutex_.Lock();
+  int preload_number = static_cast<int>(preload_components_.size());
+  preload_mutex_.Unlock();
+
+  return preload_number;
+}
+
+Model::Impl::Component Model::Impl::preload_component(int idx) const {
+  Component component = kComponentNumber;
+  preload_mutex_.Lock();
+  if (idx >= 0 && idx < static_cast<int>(preload_components_.size())) {
+    component = preload_components_[idx];
+  }
+  preload_mutex_.Unlock();
+
+  return component;
+}
+
+double Model::Impl::preload_time(int idx) const {
+  double preload_time = 0.0;
+  preload_mutex_.Lock();
+  if (idx >= 0 && idx < static_cast<int>(preload_times_.size())) {
+    preload_time = preload_times_[idx];
+  }
+  preload_mutex_.Unlock();
+
+  return preload_time;
 }
 
-}  // namespace milkcat
\ No newline at end of file
+}  // namespace milkcat
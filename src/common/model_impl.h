@@ -28,9 +28,11 @@
 //
 #include "include/milkcat.h"
 
+#include <map>
 #include <string>
 #include <vector>
 #include "parser/feature_template.h"
+#include "utils/atomic.h"
 #include "utils/mutex.h"
 #include "utils/utils.h"
 
@@ -39,36 +41,77 @@
 
 namespace milkcat {
 
+class BigramTable;
+class Bundle;
+class UserDictionary;
 class PerceptronModel;
 class TrieTree;
+class DoubleArrayTrieTree;
 template <class T> class StaticArray;
-template <class K, class V> class StaticHashTable;
 class CRFModel;
 class HMMModel;
 
 // A factory class that can obtain any model data class needed by MilkCat
-// in singleton mode. All the GetXX fucnctions are thread safe
+// in singleton mode. All the GetXX fucnctions are thread safe. Each component
+// is loaded once under its own mutex, after that it is got without locking
 class Model::Impl {
  public:
-  explicit Impl(const char *model_dir_path);
+  // Components loaded on demand, each one has its own mutex to serialize its
+  // loading
+  enum Component {
+    kUnigramIndex = 0,
+    kUnigramCost,
+    kBigramCost,
+    kCRFSegModel,
+    kCRFPosModel,
+    kHMMPosModel,
+    kOOVProperty,
+    kStopword,
+    kDependencyModel,
+    kDependencyTemplate,
+    kComponentNumber
+  };
+
+  // Model files are read from `model_dir_path`. If `bundle` is not NULL, they
+  // are read from the sections of `bundle` instead and the Impl takes the
+  // ownership of it
+  explicit Impl(const char *model_dir_path, Bundle *bundle = NULL);
   ~Impl();
 
+  // Creates the Impl from `model_path`, which is a model directory or a bundle
+  // file. A directory containing Bundle::kDefaultFilename is loaded from the
+  // bundle. On failed, returns NULL and sets `status`
+  static Impl *New(const char *model_path, Status *status);
+
   // Get the index for word which were used in unigram cost, bigram cost
   // hmm pos model and oov property
-  const TrieTree *Index(Status *status);
+  const DoubleArrayTrieTree *Index(Status *status);
 
-  // Sets the user dictionary for the segmenter
-  bool SetUserDictionary(const char *path);
+  // Sets the user dictionary for the segmenter. It is safe to call them while
+  // the segmenters are running, they pick up the new user dictionary before
+  // segmenting the next sentence. If `combined` is true, the user dictionary
+  // is combined with the system dictionary into one index
+  bool SetUserDictionary(const char *path, bool combined = false);
   void SetUserDictionary(const unordered_map<std::string, float> &words);
 
-  // If the model has loaded the user dictionary
-  bool HasUserDictionary() const { return user_index_ != NULL; }
+  // Adds or removes some words of the user dictionary. Unlike
+  // SetUserDictionary, the time is proportional to the number of words
+  // changed rather than the size of the user dictionary
+  void AddUserWords(const std::map<std::string, float> &words);
+  void RemoveUserWords(const std::vector<std::string> &words);
+
+  // Gets the current user dictionary and increases its reference count. The
+  // caller should `Release` it after use. Returns NULL if no user dictionary
+  UserDictionary *AcquireUserDictionary();
 
-  const TrieTree *UserIndex(Status *status);
-  const StaticArray<float> *UserCost(Status *status);
+  // Version of current user dictionary, 0 if no user dictionary. Segmenters
+  // check it to find out if the user dictionary is updated
+  int64_t user_dictionary_version() const {
+    return AcquireLoad(&user_dictionary_version_);
+  }
 
   const StaticArray<float> *UnigramCost(Status *status);
-  const StaticHashTable<int64_t, float> *BigramCost(Status *status);
+  const BigramTable *BigramCost(Status *status);
 
   // Get the CRF word segmenter model
   const CRFModel *CRFSegModel(Status *status);
@@ -91,15 +134,49 @@ class Model::Impl {
   // Get the feature template for dependency parsing
   DependencyParser::FeatureTemplate *DependencyTemplate(Status *status);
 
+  // Loads `component` by calling its getter
+  void LoadComponent(Component component, Status *status);
+
+  // Loads `components` with `threads` threads in parallel, and records the
+  // time to load each of them. If any component failed, sets `status` to the
+  // error of it
+  void Preload(const std::vector<Component> &components,
+               int threads,
+               Status *status);
+
+  // Gets the components loaded by last Preload and the time used. They could
+  // be called during another Preload. An out of range `idx` gets
+  // kComponentNumber and 0.0
+  int preload_number() const;
+  Component preload_component(int idx) const;
+  double preload_time(int idx) const;
+
+  // Name of `component`
+  static const char *ComponentName(Component component);
+
  private:
   std::string model_dir_path_;
+  Bundle *bundle_;
+
+  class UserDictionaryCompactor;
+
+  // Guards the user dictionary
   Mutex mutex;
+  UserDictionary *user_dictionary_;
+  int64_t user_dictionary_version_;
+
+  // Serializes the updates of user dictionary, including the installation of
+  // compacted snapshot. The first `compacting_layers_` layers of the user
+  // dictionary are being merged by `compactor_` if it is not 0
+  Mutex user_dictionary_update_mutex_;
+  int compacting_layers_;
+  UserDictionaryCompactor *compactor_;
+
+  Mutex component_mutex_[kComponentNumber];
 
-  const TrieTree *unigram_index_;
-  const TrieTree *user_index_;
+  const DoubleArrayTrieTree *unigram_index_;
   const StaticArray<float> *unigram_cost_;
-  const StaticArray<float> *user_cost_;
-  const StaticHashTable<int64_t, float> *bigram_cost_;
+  const BigramTable *bigram_cost_;
   const CRFModel *seg_model_;
   const CRFModel *crf_pos_model_;
   const HMMModel *hmm_pos_model_;
@@ -108,8 +185,23 @@ class Model::Impl {
   PerceptronModel *dependency_;
   DependencyParser::FeatureTemplate *dependency_feature_;
 
+  // Guards the results of last Preload
+  mutable Mutex preload_mutex_;
+  std::vector<Component> preload_components_;
+  std::vector<double> preload_times_;
+
   // Load and set the user dictionary data specified by path
-  void LoadUserDictionary(const char *userdict_path, Status *status);
+  void LoadUserDictionary(const char *userdict_path,
+                          bool combined,
+                          Status *status);
+
+  // Replaces the current user dictionary with `user_dictionary`. It should be
+  // called with user_dictionary_update_mutex_ locked
+  void UpdateUserDictionary(UserDictionary *user_dictionary);
+
+  // Starts compacting the user dictionary in background if it has too many
+  // layers. It should be called with user_dictionary_update_mutex_ locked
+  void CompactUserDictionary();
 };
 
 }  // namespace milkcat
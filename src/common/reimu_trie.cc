@@ -31,6 +31,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <vector>
+#include "common/bundle.h"
+#include "utils/mapped_file.h"
+#include "utils/status.h"
 
 #define _assert(x) assert(x)
 #define XOR(a, b) ((a) ^ (b))
@@ -48,7 +51,7 @@ class ReimuTrie::Impl {
   ~Impl();
 
   // These functions are same to functions in ReimuTrie::
-  static Impl *Open(const char *filename);
+  static Impl *Open(const char *filename, int flags, const Bundle *bundle);
   int32 Get(const char *key, int32 default_value);
   void Put(const char *key, int32 value);
   bool Save(const char *filename);
@@ -58,6 +61,10 @@ class ReimuTrie::Impl {
   void *array() const { return reinterpret_cast<void *>(array_); }
   bool Traverse(
       int *from, const char *key, int32 *value, int32 default_value) const;
+  void CommonPrefixSearch(const char *const *tokens,
+                          const int *lengths,
+                          int token_number,
+                          std::vector<std::pair<int, int32> > *matches) const;
  private:
   class Node;
   class Block;
@@ -125,6 +132,9 @@ class ReimuTrie::Impl {
   int closed_block_head_;
   int full_block_head_;
   bool use_external_array_;
+
+  // Not NULL when array_ points into the mapping of the file
+  MappedFile *mapped_file_;
 };
 
 // Stores block data. A block is a sequence of 256 nodes
@@ -195,8 +205,10 @@ ReimuTrie::int32 ReimuTrie::Get(const char *key, int32 default_value) {
   return impl_->Get(key, default_value);
 }
 void ReimuTrie::Put(const char *key, int32 value) { impl_->Put(key, value); }
-ReimuTrie *ReimuTrie::Open(const char *filename) {
-  Impl *impl = Impl::Open(filename);
+ReimuTrie *ReimuTrie::Open(const char *filename,
+                           int flags,
+                           const Bundle *bundle) {
+  Impl *impl = Impl::Open(filename, flags, bundle);
   if (impl != NULL) {
     ReimuTrie *self = new ReimuTrie();
     self->impl_ = impl;
@@ -213,6 +225,13 @@ bool ReimuTrie::Traverse(
       int *from, const char *key, int32 *value, int32 default_value) const {
   return impl_->Traverse(from, key, value, default_value);
 }
+void ReimuTrie::CommonPrefixSearch(
+    const char *const *tokens,
+    const int *lengths,
+    int token_number,
+    std::vector<std::pair<int, int32> > *matches) const {
+  impl_->CommonPrefixSearch(tokens, lengths, token_number, matches);
+}
 void *ReimuTrie::array() const { return impl_->array(); }
 
 ReimuTrie::Impl::Block::Block(): previous_(0),
@@ -228,7 +247,8 @@ ReimuTrie::Impl::Impl(): array_(NULL),
                          open_block_head_(kBlockLinkListEnd),
                          closed_block_head_(kBlockLinkListEnd),
                          full_block_head_(kBlockLinkListEnd),
-                         use_external_array_(false) {
+                         use_external_array_(false),
+                         mapped_file_(NULL) {
 }
 ReimuTrie::Impl::~Impl() {
   if (use_external_array_ == false) free(array_);
@@ -236,6 +256,9 @@ ReimuTrie::Impl::~Impl() {
 
   free(block_);
   block_ = NULL;
+
+  delete mapped_file_;
+  mapped_file_ = NULL;
 }
 
 int ReimuTrie::Impl::size() const {
@@ -306,7 +329,26 @@ bool ReimuTrie::Impl::Save(const char *filename) {
   }
 }
 
-ReimuTrie::Impl *ReimuTrie::Impl::Open(const char *filename) {
+ReimuTrie::Impl *ReimuTrie::Impl::Open(const char *filename,
+                                       int flags,
+                                       const Bundle *bundle) {
+  if (bundle != NULL || (flags & MappedFile::kMmap)) {
+    Status status;
+    MappedFile *mapped_file = Bundle::MapFile(bundle, filename, flags, &status);
+    if (status.ok() && mapped_file->size() % sizeof(Node) == 0 &&
+        mapped_file->size() > 0) {
+      Impl *impl = new Impl();
+      impl->SetArray(const_cast<void *>(mapped_file->data()));
+      impl->size_ = mapped_file->size() / sizeof(Node);
+      impl->capacity_ = impl->size_;
+      impl->mapped_file_ = mapped_file;
+      return impl;
+    } else {
+      delete mapped_file;
+      return NULL;
+    }
+  }
+
   FILE *fd = fopen(filename, "rb");
   if (fd == NULL) return NULL;
 
@@ -350,6 +392,30 @@ bool ReimuTrie::Impl::Traverse(
   return true;  
 }
 
+void ReimuTrie::Impl::CommonPrefixSearch(
+    const char *const *tokens,
+    const int *lengths,
+    int token_number,
+    std::vector<std::pair<int, int32> > *matches) const {
+  matches->clear();
+  if (array_ == NULL) return;
+
+  int from = 0, to;
+  for (int i = 0; i < token_number; ++i) {
+    const uint8 *p = reinterpret_cast<const uint8 *>(tokens[i]);
+    const uint8 *end = p + lengths[i];
+    for (; p < end; ++p) {
+      to = XOR(array_[from].base(), *p);
+      if (array_[to].check() != from) return;
+      from = to;
+    }
+    to = XOR(array_[from].base(), 0);
+    if (array_[to].check() == from) {
+      matches->push_back(std::make_pair(i, array_[to].value()));
+    }
+  }
+}
+
 ReimuTrie::int32 ReimuTrie::Impl::Get(const char *key, int32 default_value) {
   int from = 0;
   int32 value;
@@ -727,10 +793,10 @@ bool ReimuTrie::Impl::Check() {
 }
 
 void ReimuTrie::Impl::SetArray(void *array) {
-  delete array_;
+  if (use_external_array_ == false) free(array_);
   array_ = reinterpret_cast<Node *>(array);
 
-  delete block_;
+  free(block_);
   block_ = NULL;
 
   size_ = 0;
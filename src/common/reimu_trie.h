@@ -28,8 +28,14 @@
 #ifndef REIMU_TRIE_H_
 #define REIMU_TRIE_H_
 
+#include <stddef.h>
+#include <utility>
+#include <vector>
+
 namespace milkcat {
 
+class Bundle;
+
 // RemmuTrie is a reimplementation of the double-array trie algorithm of
 // cedar (http://www.tkl.iis.u-tokyo.ac.jp/~ynaga/cedar/)
 class ReimuTrie {
@@ -46,8 +52,13 @@ class ReimuTrie {
   ~ReimuTrie();
 
   // Open a ReimuTrie saved file. On success, returns an instance of ReimuTrie.
-  // On failed, returns NULL
-  static ReimuTrie *Open(const char *filename);
+  // On failed, returns NULL. If `flags` has MappedFile::kMmap, the file is
+  // mapped into memory and used as a READ ONLY external array, other
+  // MappedFile flags are applied as hints to the mapping. If `bundle` is not
+  // NULL, its section named `filename` is always used as an external array
+  static ReimuTrie *Open(const char *filename,
+                         int flags = 0,
+                         const Bundle *bundle = NULL);
 
   // Gets the corresponded value for `key`, if `key` does not exist, returns
   // `default_value`
@@ -61,6 +72,14 @@ class ReimuTrie {
   bool Traverse(
       int *from, const char *key, int32 *value, int32 default_value) const;
 
+  // Finds the keys formed by the first tokens of `tokens`, the i-th token is
+  // `lengths[i]` bytes at `tokens[i]`. Stores a (i, value) pair into
+  // `matches` for each key of i + 1 tokens, in the order of i
+  void CommonPrefixSearch(const char *const *tokens,
+                          const int *lengths,
+                          int token_number,
+                          std::vector<std::pair<int, int32> > *matches) const;
+
   // Put `key` and `value` pair into trie.
   void Put(const char *key, int32 value);
 
@@ -29,7 +29,9 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include "common/bundle.h"
 #include "utils/utils.h"
+#include "utils/mapped_file.h"
 #include "utils/readable_file.h"
 #include "utils/writable_file.h"
 
@@ -63,9 +65,39 @@ class StaticArray {
     }
   }
 
+  // Maps the file into memory read-only instead of copying it into the heap.
+  // The data is shared with the page cache, so several processes loading the
+  // same model share one physical copy of it. If `bundle` is not NULL, uses
+  // its section named `file_path` instead
+  static StaticArray *Mmap(const char *file_path,
+                           Status *status,
+                           const Bundle *bundle = NULL) {
+    int type_size = sizeof(T);
+    StaticArray *self = new StaticArray();
+    self->mapped_file_ = Bundle::MapFile(bundle, file_path, 0, status);
+
+    if (status->ok()) {
+      if (self->mapped_file_->size() % type_size != 0)
+        *status = Status::Corruption(file_path);
+    }
+
+    if (status->ok()) {
+      self->data_ = static_cast<T *>(
+          const_cast<void *>(self->mapped_file_->data()));
+      self->size_ = self->mapped_file_->size() / type_size;
+    }
+
+    if (status->ok()) {
+      return self;
+    } else {
+      delete self;
+      return NULL;
+    }
+  }
+
   // Create a StaticArray<T> from an array specified by ptr, this function
   // will copy the data of ptr into this->data_
-  static StaticArray *NewFromArray(T *ptr, int size) {
+  static StaticArray *NewFromArray(const T *ptr, int size) {
     StaticArray *self = new StaticArray();
     self->size_ = size;
     self->data_ = new T[size];
@@ -74,11 +106,14 @@ class StaticArray {
     return self;
   }
 
-  StaticArray(): data_(NULL), size_(0) {}
+  StaticArray(): data_(NULL), size_(0), mapped_file_(NULL) {}
 
   ~StaticArray() {
-    delete[] data_;
+    if (mapped_file_ == NULL) delete[] data_;
     data_ = NULL;
+
+    delete mapped_file_;
+    mapped_file_ = NULL;
   }
 
   T get(int position) const {
@@ -103,6 +138,9 @@ class StaticArray {
   T *data_;
   int size_;
 
+  // Not NULL when data_ points into a read-only mapping of the file
+  MappedFile *mapped_file_;
+
   DISALLOW_COPY_AND_ASSIGN(StaticArray);
 };
 
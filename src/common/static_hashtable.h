@@ -25,108 +25,76 @@
 //
 
 
+
 #ifndef SRC_COMMON_STATIC_HASHTABLE_H_
 #define SRC_COMMON_STATIC_HASHTABLE_H_
 
 #include <assert.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <string>
+#include <vector>
+#include "common/bundle.h"
 #include "utils/utils.h"
+#include "utils/mapped_file.h"
 #include "utils/readable_file.h"
 #include "utils/writable_file.h"
 #include "utils/status.h"
 
 namespace milkcat {
 
+// A read-only hash table for integral keys. It uses open addressing with
+// linear probing over a power-of-two capacity. Keys and values are stored in
+// two separate arrays and empty slots are marked by a sentinel key, so a probe
+// sequence only touches the (densely packed) key array
 template <class K, class V>
 class StaticHashTable {
  public:
+  // The hash functions used to place keys into buckets. It is stored in the
+  // header of the file since the bucket array is saved as is
+  enum {
+    kJSHashFunction = 1,
+    kMixHashFunction = 2
+  };
+
   static const StaticHashTable *Build(const K *keys,
                                       const V *values,
                                       int size,
                                       double load_factor = 0.5) {
     StaticHashTable *self = new StaticHashTable();
-
-    self->bucket_size_ = static_cast<int>(size / load_factor);
-    self->buckets_ = new Bucket[self->bucket_size_];
-    for (int i = 0; i < self->bucket_size_; ++i) {
-      self->buckets_[i].empty = true;
-    }
-
-    int position;
-    for (int i = 0; i < size; ++i) {
-      position = self->FindPosition(keys[i]);
-      self->buckets_[position].key = keys[i];
-      self->buckets_[position].value = values[i];
-      self->buckets_[position].empty = false;
-    }
-
-    self->data_size_ = size;
+    self->Initialize(keys, values, size, load_factor);
     return self;
   }
 
-  // Load hash table from file
-  static const StaticHashTable *New(const char *file_path, Status *status) {
+  // Load hash table from file. The current format is mapped into memory and
+  // used as is, the old format (version 1) is still readable but needs a full
+  // pass to rebuild the table. Use `mctools gram --convert` to upgrade it. If
+  // `bundle` is not NULL, loads its section named `file_path`
+  static const StaticHashTable *New(const char *file_path,
+                                    Status *status,
+                                    const Bundle *bundle = NULL) {
     StaticHashTable *self = new StaticHashTable();
-    char *buffer = NULL;
+    MappedFile *mapped_file = Bundle::MapFile(bundle, file_path, 0, status);
 
-    ReadableFile *fd = ReadableFile::New(file_path, status);
-
-    int32_t magic_number;
-    if (status->ok()) fd->ReadValue(&magic_number, status);
+    const Header *header = NULL;
     if (status->ok()) {
-      if (magic_number != 0x3321) *status = Status::Corruption(file_path);
-    }
-
-    int32_t bucket_size;
-    if (status->ok()) fd->ReadValue(&bucket_size, status);
-
-    int32_t data_size;
-    if (status->ok()) fd->ReadValue(&data_size, status);
-
-    int32_t serialize_size;
-    if (status->ok()) fd->ReadValue(&serialize_size, status);
-
-    if (status->ok()) {
-      if (kSerializeBukcetSize != serialize_size)
+      if (mapped_file->size() < static_cast<int64_t>(sizeof(int32_t))) {
         *status = Status::Corruption(file_path);
-    }
-
-    if (status->ok()) {
-      buffer = new char[kSerializeBukcetSize * data_size];
-      fd->Read(buffer, kSerializeBukcetSize * data_size, status);
-    }
-
-    if (status->ok()) {
-      if (fd->Tell() != fd->Size()) *status = Status::Corruption(file_path);
-    }
-
-    if (status->ok()) {
-      self->buckets_ = new Bucket[bucket_size];
-      self->bucket_size_ = bucket_size;
-      self->data_size_ = data_size;
-
-      for (int i = 0; i < self->bucket_size_; ++i) {
-        self->buckets_[i].empty = true;
-      }
-
-      char *p = buffer, *p_end = buffer + kSerializeBukcetSize * data_size;
-      int32_t position;
-      K key;
-      V value;
-      for (int i = 0; i < data_size; ++i) {
-        self->Desericalize(&position, &key, &value, p, p_end - p);
-        self->buckets_[position].key = key;
-        self->buckets_[position].value = value;
-        self->buckets_[position].empty = false;
-        p += kSerializeBukcetSize;
+      } else {
+        header = static_cast<const Header *>(mapped_file->data());
       }
     }
 
-    delete[] buffer;
-    delete fd;
-    fd = NULL;
+    if (status->ok() && header->magic_number == kVersion1MagicNumber) {
+      self->LoadVersion1(file_path, bundle, status);
+      delete mapped_file;
+    } else if (status->ok()) {
+      // `self` takes the ownership of `mapped_file`
+      self->MapTable(mapped_file, status);
+    } else {
+      delete mapped_file;
+    }
 
     if (status->ok()) {
       return self;
@@ -136,29 +104,23 @@ class StaticHashTable {
     }
   }
 
-  // Save the hash table into file
+  // Save the hash table into file, always in the current format
   void Save(const char *file_path, Status *status) const {
-    char buffer[kSerializeBukcetSize];
     WritableFile *fd = WritableFile::New(file_path, status);
 
-    int32_t magic_number = 0x3321;
-    if (status->ok()) fd->WriteValue<int32_t>(magic_number, status);
-    if (status->ok()) fd->WriteValue<int32_t>(bucket_size_, status);
-    if (status->ok()) fd->WriteValue<int32_t>(data_size_, status);
-
-    int32_t serialize_size = kSerializeBukcetSize;
-    if (status->ok()) fd->WriteValue<int32_t>(serialize_size, status);
-
-    for (int i = 0; i < bucket_size_ && status->ok(); ++i) {
-      if (buckets_[i].empty == false) {
-        Serialize(i,
-                  buckets_[i].key,
-                  buckets_[i].value,
-                  buffer,
-                  sizeof(buffer));
-        fd->Write(buffer, kSerializeBukcetSize, status);
-      }
-    }
+    Header header;
+    memset(&header, 0, sizeof(header));
+    header.magic_number = kMagicNumber;
+    header.version = kVersion;
+    header.hash_function = kMixHashFunction;
+    header.bucket_size = capacity_;
+    header.data_size = data_size_;
+    header.key_bytes = sizeof(K);
+    header.value_bytes = sizeof(V);
+    header.load_factor = static_cast<float>(load_factor_);
+    if (status->ok()) fd->Write(&header, sizeof(header), status);
+    if (status->ok()) fd->Write(keys_, sizeof(K) * capacity_, status);
+    if (status->ok()) fd->Write(values_, sizeof(V) * capacity_, status);
 
     delete fd;
   }
@@ -167,56 +129,280 @@ class StaticHashTable {
   // value else return NULL
   const V *Find(const K &key) const {
     int position = FindPosition(key);
-    if (buckets_[position].empty) {
+    if (keys_[position] == EmptyKey()) {
       return NULL;
     } else {
-      return &(buckets_[position].value);
+      return values_ + position;
+    }
+  }
+
+  // Finds the values of `size` keys. Stores a pointer to the value of
+  // `keys[i]` into `values[i]`, or NULL if it not exists. The slots of a group
+  // of keys are prefetched before probing, so the cache misses of the group
+  // overlap each other
+  void FindBatch(const K *keys, int size, const V **values) const {
+    uint32_t positions[kBatchSize];
+    for (int begin = 0; begin < size; begin += kBatchSize) {
+      int end = begin + kBatchSize < size? begin + kBatchSize: size;
+      for (int i = begin; i < end; ++i) {
+        uint32_t position = Hash(keys[i]) & mask_;
+        Prefetch(keys_ + position);
+        Prefetch(values_ + position);
+        positions[i - begin] = position;
+      }
+
+      for (int i = begin; i < end; ++i) {
+        uint32_t position = positions[i - begin];
+        while (keys_[position] != keys[i] && keys_[position] != EmptyKey()) {
+          position = (position + 1) & mask_;
+        }
+        values[i] = keys_[position] == EmptyKey()? NULL: values_ + position;
+      }
     }
   }
 
+  // Gets all the key-value pairs in the table
+  void GetAllPairs(std::vector<K> *keys, std::vector<V> *values) const {
+    keys->clear();
+    values->clear();
+    for (int i = 0; i < capacity_; ++i) {
+      if (keys_[i] != EmptyKey()) {
+        keys->push_back(keys_[i]);
+        values->push_back(values_[i]);
+      }
+    }
+  }
+
+  // Number of key-value pairs in the table
+  int size() const { return data_size_; }
+
+  double load_factor() const { return load_factor_; }
+
   ~StaticHashTable() {
-    if (buckets_ != NULL) {
-      delete[] buckets_;
-      buckets_ = NULL;
+    if (mapped_file_ == NULL) {
+      delete[] keys_;
+      delete[] values_;
     }
+    keys_ = NULL;
+    values_ = NULL;
+
+    delete mapped_file_;
+    mapped_file_ = NULL;
   }
 
  private:
-  struct Bucket {
-    K key;
-    V value;
-    bool empty;
+  // File header of the current format, followed by `bucket_size` keys and
+  // then `bucket_size` values. The size of header keeps the key array aligned
+  // to 8 bytes
+  struct Header {
+    int32_t magic_number;
+    int32_t version;
+    int32_t hash_function;
+    int32_t bucket_size;
+    int32_t data_size;
+    int16_t key_bytes;
+    int16_t value_bytes;
+    float load_factor;
+    int32_t reserved;
   };
 
-  Bucket *buckets_;
+  static const int32_t kVersion1MagicNumber = 0x3321;
+  static const int32_t kMagicNumber = 0x3324;
+  static const int32_t kVersion = 3;
 
-  // How many key-value pairs in hash table
-  int data_size_;
-  int bucket_size_;
+  // Number of keys prefetched together in `FindBatch`
+  static const int kBatchSize = 16;
 
-  StaticHashTable(): buckets_(NULL), data_size_(0), bucket_size_(0) {}
+  K *keys_;
+  V *values_;
 
-  // Serialize size of each bucket
+  // How many key-value pairs in hash table
+  int data_size_;
+  int capacity_;
+  uint32_t mask_;
+  double load_factor_;
+
+  // Not NULL when `keys_` and `values_` point into the mapping of the model
+  // file
+  MappedFile *mapped_file_;
+
+  StaticHashTable(): keys_(NULL),
+                     values_(NULL),
+                     data_size_(0),
+                     capacity_(0),
+                     mask_(0),
+                     load_factor_(0.0),
+                     mapped_file_(NULL) {}
+
+  // Serialize size of each bucket in the version 1 format
   static const int kSerializeBukcetSize = sizeof(int32_t) +
                                           sizeof(K) +
                                           sizeof(V);
 
-  // Serialize a Bucket into buffer
-  void Serialize(int32_t position,
-                 const K &key,
-                 const V &value,
-                 void *buffer,
-                 int buffer_size) const {
-    assert(kSerializeBukcetSize <= buffer_size);
+  // The key marks an empty slot. It could not be inserted into the table
+  static K EmptyKey() { return static_cast<K>(-1); }
 
-    char *p = reinterpret_cast<char *>(buffer);
-    *reinterpret_cast<int32_t *>(p) = position;
+  static void Prefetch(const void *address) {
+#if defined(__GNUC__)
+    __builtin_prefetch(address);
+#endif  // defined(__GNUC__)
+  }
 
-    p += sizeof(int32_t);
-    *reinterpret_cast<K *>(p) = key;
+  // The finalizer of MurmurHash3, it mixes all bits of the key into the lower
+  // bits used as the position
+  static uint32_t Hash(const K &key) {
+    uint64_t hash = static_cast<uint64_t>(key);
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return static_cast<uint32_t>(hash);
+  }
 
-    p += sizeof(K);
-    *reinterpret_cast<V *>(p) = value;
+  // Builds the table from `size` key-value pairs. The capacity is the minimal
+  // power of 2 not less than `size / load_factor`
+  void Initialize(const K *keys,
+                  const V *values,
+                  int size,
+                  double load_factor) {
+    int64_t min_capacity = static_cast<int64_t>(size / load_factor) + 1;
+    capacity_ = 2;
+    while (capacity_ < min_capacity) capacity_ *= 2;
+    mask_ = capacity_ - 1;
+    load_factor_ = load_factor;
+
+    keys_ = new K[capacity_];
+    values_ = new V[capacity_];
+    for (int i = 0; i < capacity_; ++i) keys_[i] = EmptyKey();
+    memset(values_, 0, sizeof(V) * capacity_);
+
+    data_size_ = 0;
+    for (int i = 0; i < size; ++i) {
+      assert(keys[i] != EmptyKey());
+      int position = FindPosition(keys[i]);
+      if (keys_[position] == EmptyKey()) ++data_size_;
+      keys_[position] = keys[i];
+      values_[position] = values[i];
+    }
+  }
+
+  // Checks the header of `mapped_file` and points `keys_` and `values_` into
+  // it
+  void MapTable(MappedFile *mapped_file, Status *status) {
+    mapped_file_ = mapped_file;
+    const char *file_path = mapped_file->file_path();
+
+    const Header *header = NULL;
+    if (mapped_file->size() < static_cast<int64_t>(sizeof(Header))) {
+      *status = Status::Corruption(file_path);
+    } else {
+      header = static_cast<const Header *>(mapped_file->data());
+    }
+
+    // The probes stop at an empty slot, so a full table is corrupted too
+    if (status->ok()) {
+      int32_t capacity = header->bucket_size;
+      if (header->magic_number != kMagicNumber ||
+          header->version != kVersion ||
+          header->hash_function != kMixHashFunction ||
+          header->key_bytes != sizeof(K) ||
+          header->value_bytes != sizeof(V) ||
+          capacity <= 0 ||
+          (capacity & (capacity - 1)) != 0 ||
+          header->data_size < 0 ||
+          header->data_size >= capacity) {
+        *status = Status::Corruption(file_path);
+      }
+    }
+
+    if (status->ok()) {
+      int64_t expected_size = sizeof(Header) +
+                              (sizeof(K) + sizeof(V)) *
+                              static_cast<int64_t>(header->bucket_size);
+      if (mapped_file->size() != expected_size) {
+        *status = Status::Corruption(file_path);
+      }
+    }
+
+    if (status->ok()) {
+      const char *data = static_cast<const char *>(mapped_file->data());
+      capacity_ = header->bucket_size;
+      mask_ = capacity_ - 1;
+      data_size_ = header->data_size;
+      load_factor_ = header->load_factor;
+      keys_ = reinterpret_cast<K *>(const_cast<char *>(data + sizeof(Header)));
+      values_ = reinterpret_cast<V *>(
+          const_cast<char *>(data + sizeof(Header) + sizeof(K) * capacity_));
+    }
+  }
+
+  // Reads the version 1 format, which only stores the (position, key, value)
+  // records of the non-empty buckets
+  void LoadVersion1(const char *file_path,
+                    const Bundle *bundle,
+                    Status *status) {
+    char *buffer = NULL;
+    ReadableFile *fd = Bundle::OpenFile(bundle, file_path, status);
+
+    int32_t magic_number;
+    if (status->ok()) fd->ReadValue(&magic_number, status);
+    if (status->ok()) {
+      if (magic_number != kVersion1MagicNumber)
+        *status = Status::Corruption(file_path);
+    }
+
+    int32_t bucket_size;
+    if (status->ok()) fd->ReadValue(&bucket_size, status);
+
+    int32_t data_size;
+    if (status->ok()) fd->ReadValue(&data_size, status);
+
+    int32_t serialize_size;
+    if (status->ok()) fd->ReadValue(&serialize_size, status);
+
+    if (status->ok()) {
+      if (kSerializeBukcetSize != serialize_size)
+        *status = Status::Corruption(file_path);
+    }
+
+    // The records should fill the rest of file, and the table they came from
+    // should have an empty bucket
+    if (status->ok()) {
+      int64_t expected_size = fd->Tell() + static_cast<int64_t>(
+          kSerializeBukcetSize) * data_size;
+      if (data_size < 0 ||
+          bucket_size <= 0 ||
+          data_size > bucket_size ||
+          fd->Size() != expected_size) {
+        *status = Status::Corruption(file_path);
+      }
+    }
+
+    if (status->ok() && data_size > 0) {
+      buffer = new char[kSerializeBukcetSize * data_size];
+      fd->Read(buffer, kSerializeBukcetSize * data_size, status);
+    }
+
+    if (status->ok()) {
+      if (fd->Tell() != fd->Size()) *status = Status::Corruption(file_path);
+    }
+
+    if (status->ok()) {
+      std::vector<K> keys(data_size);
+      std::vector<V> values(data_size);
+
+      char *p = buffer, *p_end = buffer + kSerializeBukcetSize * data_size;
+      int32_t position;
+      for (int i = 0; i < data_size; ++i) {
+        Desericalize(&position, &keys[i], &values[i], p, p_end - p);
+        p += kSerializeBukcetSize;
+      }
+      Initialize(keys.data(), values.data(), data_size, 0.5);
+    }
+
+    delete[] buffer;
+    delete fd;
   }
 
   void Desericalize(int32_t *position,
@@ -237,40 +423,13 @@ class StaticHashTable {
   }
 
   int FindPosition(const K &key) const {
-    int original = JSHash(key) % bucket_size_,
-        position = original;
-    for (int i = 1; ; i++) {
-      if (buckets_[position].empty) {
-        // key not exists in hash table
-        return position;
-      } else if (buckets_[position].key == key) {
-        // OK, find the key
-        return position;
-      } else {
-        position = (position + i) % bucket_size_;
-        assert(i < bucket_size_);
-      }
+    uint32_t position = Hash(key) & mask_;
+    while (keys_[position] != key && keys_[position] != EmptyKey()) {
+      position = (position + 1) & mask_;
     }
+    return position;
   }
 
-  // The JS hash function
-  int JSHash(const K &key) const {
-    const char *p = reinterpret_cast<const char *>(&key);
-    uint32_t b = 378551;
-    uint32_t a = 63689;
-    uint32_t hash = 0;
-
-    for (int i = 0; i < sizeof(K); ++i) {
-      hash = hash * a + (*p++);
-      a *= b;
-    }
-
-    hash = hash & 0x7FFFFFFF;
-
-    return static_cast<int>(hash);
-  }
-
-
   DISALLOW_COPY_AND_ASSIGN(StaticHashTable);
 };
 
@@ -28,23 +28,52 @@
 #include <vector>
 #include <algorithm>
 #include <map>
+#include "common/bundle.h"
 #include "common/darts.h"
 #include "common/trie_tree.h"
 #include "utils/utils.h"
+#include "utils/mapped_file.h"
 #include "utils/readable_file.h"
 
 namespace milkcat {
 
+DoubleArrayTrieTree::DoubleArrayTrieTree(): mapped_file_(NULL) {}
+
+DoubleArrayTrieTree::~DoubleArrayTrieTree() {
+  double_array_.clear();
+
+  delete mapped_file_;
+  mapped_file_ = NULL;
+}
+
 DoubleArrayTrieTree *DoubleArrayTrieTree::New(const char *file_path,
-                                              Status *status) {
+                                              Status *status,
+                                              int flags,
+                                              const Bundle *bundle) {
   DoubleArrayTrieTree *self = new DoubleArrayTrieTree();
 
-  if (-1 == self->double_array_.open(file_path)) {
+  if (bundle != NULL || (flags & MappedFile::kMmap)) {
+    self->mapped_file_ = Bundle::MapFile(bundle, file_path, flags, status);
+    if (status->ok()) {
+      int64_t size = self->mapped_file_->size();
+      if (size == 0 || size % self->double_array_.unit_size() != 0) {
+        *status = Status::Corruption(file_path);
+      }
+    }
+    if (status->ok()) {
+      self->double_array_.set_array(
+          const_cast<void *>(self->mapped_file_->data()),
+          self->mapped_file_->size() / self->double_array_.unit_size());
+    }
+  } else if (-1 == self->double_array_.open(file_path)) {
     *status = Status::IOError(file_path);
+  }
+
+  if (status->ok()) {
+    return self;
+  } else {
     delete self;
     return NULL;
-  } else {
-    return self;
   }
 }
 
@@ -81,4 +110,57 @@ int DoubleArrayTrieTree::Traverse(const char *text, size_t *node) const {
   return double_array_.traverse(text, *node, key_pos);
 }
 
+int DoubleArrayTrieTree::Traverse(const char *text,
+                                  int len,
+                                  size_t *node) const {
+  size_t key_pos = 0;
+  return double_array_.traverse(text,
+                                *node,
+                                key_pos,
+                                static_cast<size_t>(len));
+}
+
+void DoubleArrayTrieTree::CommonPrefixSearch(
+    const char *const *tokens,
+    const int *lengths,
+    int token_number,
+    std::vector<std::pair<int, int> > *matches) const {
+  matches->clear();
+  size_t node = 0;
+  for (int i = 0; i < token_number; ++i) {
+    size_t key_pos = 0;
+    int value = double_array_.traverse(tokens[i],
+                                       node,
+                                       key_pos,
+                                       static_cast<size_t>(lengths[i]));
+    if (value == kNone) return;
+    if (value >= 0) matches->push_back(std::make_pair(i, value));
+  }
+}
+
+// Visits the subtree of `node` in `double_array`, whose path is `prefix`, and
+// puts the words in it into `words`
+static void GetWordsInSubtree(const Darts::DoubleArray &double_array,
+                              size_t node,
+                              std::string *prefix,
+                              std::map<std::string, int> *words) {
+  char label[2] = {0, 0};
+  for (int ch = 1; ch < 256; ++ch) {
+    size_t child = node, key_pos = 0;
+    label[0] = static_cast<char>(ch);
+    int value = double_array.traverse(label, child, key_pos, 1);
+    if (value == -2) continue;
+
+    prefix->push_back(label[0]);
+    if (value >= 0) words->insert(std::make_pair(*prefix, value));
+    GetWordsInSubtree(double_array, child, prefix, words);
+    prefix->erase(prefix->size() - 1);
+  }
+}
+
+void DoubleArrayTrieTree::GetAllWords(std::map<std::string, int> *words) const {
+  std::string prefix;
+  GetWordsInSubtree(double_array_, 0, &prefix, words);
+}
+
 }  // namespace milkcat
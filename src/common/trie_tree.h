@@ -29,6 +29,8 @@
 
 #include <map>
 #include <string>
+#include <utility>
+#include <vector>
 #include "common/darts.h"
 #include "utils/utils.h"
 
@@ -51,27 +53,55 @@ class TrieTree {
   // returns kExist if something with text as its prefix exists buf text itself
   // doesn't exist return kNone it text doesn't exist.
   virtual int Traverse(const char *text, size_t *node) const = 0;
+  virtual int Traverse(const char *text, int len, size_t *node) const = 0;
 };
 
 inline TrieTree::~TrieTree() {}
 
+class Bundle;
+class MappedFile;
+
 class DoubleArrayTrieTree: public TrieTree {
  public:
-  static DoubleArrayTrieTree *New(const char *file_path, Status *status);
+  // Loads the double array from `file_path`. If `flags` has
+  // MappedFile::kMmap, the file is mapped read-only instead of being read into
+  // the heap, other MappedFile flags are applied as hints to the mapping. If
+  // `bundle` is not NULL, its section named `file_path` is always mapped
+  static DoubleArrayTrieTree *New(const char *file_path,
+                                  Status *status,
+                                  int flags = 0,
+                                  const Bundle *bundle = NULL);
 
   // Create the double array from the map data. The key of map is the
   // word itself, and the value of map is the id of word
   static DoubleArrayTrieTree *NewFromMap(
     const std::map<std::string, int> &src_map);
-  DoubleArrayTrieTree() {}
+  DoubleArrayTrieTree();
+  ~DoubleArrayTrieTree();
 
   int Search(const char *text) const;
   int Search(const char *text, int len) const;
   int Traverse(const char *text, size_t *node) const;
+  int Traverse(const char *text, int len, size_t *node) const;
+
+  // Finds the words formed by the first tokens of `tokens`, the i-th token is
+  // `lengths[i]` bytes at `tokens[i]`. It walks the tokens from the root and
+  // stores a (i, value) pair into `matches` for each word of i + 1 tokens, in
+  // the order of i. It is not virtual to keep the walk in a tight loop
+  void CommonPrefixSearch(const char *const *tokens,
+                          const int *lengths,
+                          int token_number,
+                          std::vector<std::pair<int, int> > *matches) const;
+
+  // Gets all the words in the double array and their values
+  void GetAllWords(std::map<std::string, int> *words) const;
 
  private:
   Darts::DoubleArray double_array_;
 
+  // Not NULL when double_array_ uses the array in mapping of the file
+  MappedFile *mapped_file_;
+
   DISALLOW_COPY_AND_ASSIGN(DoubleArrayTrieTree);
 };
 
@@ -0,0 +1,348 @@
+//
+// The MIT License (MIT)
+//
+// Copyright 2013-2014 The MilkCat Project Developers
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// user_dictionary.cc --- Created at 2015-01-14
+//
+
+#include "common/user_dictionary.h"
+
+#include <algorithm>
+#include "common/milkcat_config.h"
+#include "utils/atomic.h"
+
+namespace milkcat {
+
+// A sorted set of user words indexed by a double array. The value of a word in
+// the double array is its position in `words`
+class UserDictionary::Layer {
+ public:
+  // Builds the layer from `entries`, returns NULL if `entries` is empty. If
+  // `system_index` is not NULL, also builds the combined index from it
+  static Layer *New(const EntryMap &entries,
+                    const DoubleArrayTrieTree *system_index,
+                    const StaticArray<float> *system_cost) {
+    if (entries.empty()) return NULL;
+
+    Layer *self = new Layer();
+    std::map<std::string, int> positions;
+    for (EntryMap::const_iterator
+         it = entries.begin(); it != entries.end(); ++it) {
+      positions.insert(std::make_pair(it->first, self->words.size()));
+      self->words.push_back(it->first);
+      self->entries.push_back(it->second);
+    }
+    self->index = DoubleArrayTrieTree::NewFromMap(positions);
+
+    if (system_index != NULL) self->Combine(system_index, system_cost);
+    return self;
+  }
+
+  ~Layer() {
+    delete index;
+    index = NULL;
+
+    delete combined_index;
+    combined_index = NULL;
+  }
+
+  void AddRef() {
+    AtomicAdd(&ref_count, 1);
+  }
+
+  void Release() {
+    if (AtomicAdd(&ref_count, -1) == 0) delete this;
+  }
+
+  int size() const { return words.size(); }
+
+  DoubleArrayTrieTree *index;
+  std::vector<std::string> words;
+  std::vector<Entry> entries;
+
+  int ref_count;
+
+  // The words of this layer and the system dictionary, NULL if not combined
+  DoubleArrayTrieTree *combined_index;
+  std::vector<CombinedEntry> combined_entries;
+
+ private:
+  Layer(): index(NULL), ref_count(1), combined_index(NULL) {}
+
+  // Builds the combined index from the words in this layer and `system_index`
+  void Combine(const DoubleArrayTrieTree *system_index,
+               const StaticArray<float> *system_cost) {
+    std::map<std::string, int> term_ids;
+    system_index->GetAllWords(&term_ids);
+
+    CombinedEntry combined_entry;
+    for (std::map<std::string, int>::iterator
+         it = term_ids.begin(); it != term_ids.end(); ++it) {
+      combined_entry.term_id = it->second;
+      combined_entry.cost = system_cost->get(it->second);
+      combined_entry.flags = kSystemWord;
+      it->second = combined_entries.size();
+      combined_entries.push_back(combined_entry);
+    }
+
+    for (int position = 0; position < size(); ++position) {
+      if (entries[position].removed) continue;
+
+      float cost = entries[position].cost;
+      std::map<std::string, int>::iterator
+      it = term_ids.find(words[position]);
+      if (it != term_ids.end()) {
+        // The term-id in system dictionary is used, see
+        // BigramSegmenter::GetTermIdAndUnigramCost
+        CombinedEntry *system_entry = &combined_entries[it->second];
+        if (cost != kDefaultCost) system_entry->cost = cost;
+        system_entry->flags |= kUserWord;
+      } else {
+        combined_entry.term_id = position;
+        combined_entry.cost = cost;
+        combined_entry.flags = kUserWord;
+        term_ids.insert(std::make_pair(words[position],
+                                       combined_entries.size()));
+        combined_entries.push_back(combined_entry);
+      }
+    }
+
+    combined_index = DoubleArrayTrieTree::NewFromMap(term_ids);
+  }
+};
+
+UserDictionary::UserDictionary(int64_t version):
+    version_(version),
+    ref_count_(1),
+    combined_index_(NULL),
+    combined_entries_(NULL),
+    combined_id_start_(0),
+    first_layer_(0) {
+}
+
+UserDictionary::~UserDictionary() {
+  for (std::vector<Layer *>::iterator
+       it = layers_.begin(); it != layers_.end(); ++it) {
+    (*it)->Release();
+  }
+}
+
+void UserDictionary::AppendLayer(Layer *layer) {
+  int id_start = kUserTermIdStart;
+  if (!layers_.empty()) id_start = id_starts_.back() + layers_.back()->size();
+  layers_.push_back(layer);
+  id_starts_.push_back(id_start);
+
+  // Only the first layer could be combined, since the layers on it are
+  // traversed separately
+  if (layers_.size() == 1 && layer->combined_index != NULL) {
+    combined_index_ = layer->combined_index;
+    combined_entries_ = layer->combined_entries.data();
+    combined_id_start_ = id_start;
+    first_layer_ = 1;
+  }
+}
+
+UserDictionary *UserDictionary::New(
+    const std::map<std::string, float> &words,
+    int64_t version,
+    const DoubleArrayTrieTree *system_index,
+    const StaticArray<float> *system_cost) {
+  EntryMap entries;
+  Entry entry;
+  entry.removed = false;
+  for (std::map<std::string, float>::const_iterator
+       it = words.begin(); it != words.end(); ++it) {
+    if (it->first.empty()) continue;
+    entry.cost = it->second;
+    entries.insert(std::make_pair(it->first, entry));
+  }
+
+  UserDictionary *self = new UserDictionary(version);
+  Layer *layer = Layer::New(entries, system_index, system_cost);
+  if (layer != NULL) self->AppendLayer(layer);
+  return self;
+}
+
+UserDictionary *UserDictionary::Add(const std::map<std::string, float> &words,
+                                    int fixed_layers,
+                                    int64_t version) const {
+  EntryMap entries;
+  Entry entry;
+  entry.removed = false;
+  for (std::map<std::string, float>::const_iterator
+       it = words.begin(); it != words.end(); ++it) {
+    if (it->first.empty()) continue;
+    entry.cost = it->second;
+    entries.insert(std::make_pair(it->first, entry));
+  }
+  return Push(entries, fixed_layers, version);
+}
+
+UserDictionary *UserDictionary::Remove(const std::vector<std::string> &words,
+                                       int fixed_layers,
+                                       int64_t version) const {
+  EntryMap entries;
+  Entry entry;
+  entry.cost = kDefaultCost;
+  entry.removed = true;
+  for (std::vector<std::string>::const_iterator
+       it = words.begin(); it != words.end(); ++it) {
+    if (it->empty()) continue;
+    entries.insert(std::make_pair(*it, entry));
+  }
+  return Push(entries, fixed_layers, version);
+}
+
+void UserDictionary::MergeLayers(int begin,
+                                 int end,
+                                 EntryMap *entries) const {
+  // Newer entries are inserted first, so insert() keeps them
+  for (int layer_idx = end - 1; layer_idx >= begin; --layer_idx) {
+    const Layer *layer = layers_[layer_idx];
+    for (int i = 0; i < layer->size(); ++i) {
+      entries->insert(std::make_pair(layer->words[i], layer->entries[i]));
+    }
+  }
+
+  // Nothing is older than the first layer to hide
+  if (begin == 0) {
+    EntryMap::iterator it = entries->begin();
+    while (it != entries->end()) {
+      if (it->second.removed) {
+        entries->erase(it++);
+      } else {
+        ++it;
+      }
+    }
+  }
+}
+
+UserDictionary *UserDictionary::Push(const EntryMap &entries,
+                                     int fixed_layers,
+                                     int64_t version) const {
+  // Merges the layers on the top while they are not much larger than the
+  // merged ones, like a size-tiered LSM tree. It keeps the number of layers
+  // logarithmic to the number of words
+  int begin = layers_.size();
+  int merged_size = entries.size();
+  int lowest_layer = std::max(fixed_layers, first_layer_);
+  while (begin > lowest_layer) {
+    int layer_size = layers_[begin - 1]->size();
+    if (layer_size > 2 * merged_size ||
+        layer_size + merged_size > kMergeSizeMax) {
+      break;
+    }
+    merged_size += layer_size;
+    --begin;
+  }
+
+  EntryMap merged = entries;
+  MergeLayers(begin, layers_.size(), &merged);
+
+  UserDictionary *self = new UserDictionary(version);
+  for (int i = 0; i < begin; ++i) {
+    layers_[i]->AddRef();
+    self->AppendLayer(layers_[i]);
+  }
+  Layer *layer = Layer::New(merged, NULL, NULL);
+  if (layer != NULL) self->AppendLayer(layer);
+  return self;
+}
+
+UserDictionary::Layer *UserDictionary::Compact(
+    int layer_number,
+    const DoubleArrayTrieTree *system_index,
+    const StaticArray<float> *system_cost) const {
+  EntryMap merged;
+  MergeLayers(0, layer_number, &merged);
+  return Layer::New(merged, system_index, system_cost);
+}
+
+UserDictionary *UserDictionary::Replace(
+    const UserDictionary *compacted_snapshot,
+    Layer *compacted,
+    int compacted_layers,
+    int64_t version) const {
+  bool matched = compacted_layers <= layer_number();
+  for (int i = 0; matched && i < compacted_layers; ++i) {
+    if (layers_[i] != compacted_snapshot->layers_[i]) matched = false;
+  }
+  if (!matched) {
+    if (compacted != NULL) compacted->Release();
+    return NULL;
+  }
+
+  UserDictionary *self = new UserDictionary(version);
+  if (compacted != NULL) self->AppendLayer(compacted);
+  for (int i = compacted_layers; i < layer_number(); ++i) {
+    layers_[i]->AddRef();
+    self->AppendLayer(layers_[i]);
+  }
+  return self;
+}
+
+void UserDictionary::AddRef() {
+  AtomicAdd(&ref_count_, 1);
+}
+
+void UserDictionary::Release() {
+  if (AtomicAdd(&ref_count_, -1) == 0) delete this;
+}
+
+int UserDictionary::Traverse(const char *text,
+                             int len,
+                             size_t *nodes,
+                             float *cost) const {
+  int term_id = TrieTree::kNone;
+  bool exist = false;
+
+  // The newest layer containing the word decides it, but all the layers are
+  // traversed to keep their states
+  for (int layer_idx = layers_.size() - 1;
+       layer_idx >= first_layer_;
+       --layer_idx) {
+    if (nodes[layer_idx] == kNoNode) continue;
+
+    const Layer *layer = layers_[layer_idx];
+    int position = layer->index->Traverse(text, len, &nodes[layer_idx]);
+    if (position == TrieTree::kNone) {
+      nodes[layer_idx] = kNoNode;
+      continue;
+    }
+
+    exist = true;
+    if (position >= 0 && term_id == TrieTree::kNone) {
+      if (layer->entries[position].removed) {
+        term_id = kRemoved;
+      } else {
+        term_id = id_starts_[layer_idx] + position;
+        *cost = layer->entries[position].cost;
+      }
+    }
+  }
+
+  if (term_id != TrieTree::kNone) return term_id;
+  return exist? TrieTree::kExist: TrieTree::kNone;
+}
+
+}  // namespace milkcat
@@ -0,0 +1,209 @@
+//
+// The MIT License (MIT)
+//
+// Copyright 2013-2014 The MilkCat Project Developers
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// user_dictionary.h --- Created at 2015-01-14
+//
+
+#ifndef SRC_COMMON_USER_DICTIONARY_H_
+#define SRC_COMMON_USER_DICTIONARY_H_
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "common/static_array.h"
+#include "common/trie_tree.h"
+#include "utils/utils.h"
+
+namespace milkcat {
+
+// A snapshot of the user dictionary. It never changes after created, so it
+// could be read by many segmenters without locking. Model::Impl replaces the
+// whole snapshot to update the user dictionary, and the old one is deleted
+// when the last segmenter using it calls `Release`.
+//
+// The words are stored in a stack of immutable layers shared between
+// snapshots, a word in newer layer hides the same word in older layers. An
+// update only builds a new layer from the words it changes and merges the
+// small layers on the top, so its time is proportional to the size of the
+// update. The large layers are merged by `Compact`, which is called in
+// background by Model::Impl.
+//
+// The first layer could be combined with the system dictionary into one
+// double array, then the segmenter finds a word in both dictionaries with
+// one traversal. Its entries already have the resolved term-id and cost
+class UserDictionary {
+ public:
+  class Layer;
+
+  // Returned by Traverse if the word is removed by the newer layers
+  static const int kRemoved = -3;
+
+  // Flags of a CombinedEntry
+  enum {
+    kSystemWord = 1,
+    kUserWord = 2
+  };
+
+  // An entry in the combined index. Its term-id is the term-id in system
+  // dictionary if it has kSystemWord, or the position in the first layer if
+  // not. Its cost is the cost in user dictionary if it is not kDefaultCost, or
+  // the cost in system dictionary if not
+  struct CombinedEntry {
+    int term_id;
+    float cost;
+    int flags;
+  };
+
+  // Creates a snapshot from `words`, which maps a word to its cost. If
+  // `system_index` is not NULL, the words are combined with the words in
+  // `system_index` with the cost in `system_cost`. The reference count of a
+  // new snapshot is 1
+  static UserDictionary *New(
+      const std::map<std::string, float> &words,
+      int64_t version,
+      const DoubleArrayTrieTree *system_index = NULL,
+      const StaticArray<float> *system_cost = NULL);
+
+  // Returns a new snapshot with `words` added or replaced, or with `words`
+  // removed. The first `fixed_layers` layers are not merged into the new
+  // layer, they are under compaction
+  UserDictionary *Add(const std::map<std::string, float> &words,
+                      int fixed_layers,
+                      int64_t version) const;
+  UserDictionary *Remove(const std::vector<std::string> &words,
+                         int fixed_layers,
+                         int64_t version) const;
+
+  // Merges the first `layer_number` layers of this snapshot into one layer
+  // and returns it. It takes time proportional to the size of these layers,
+  // and also the size of `system_index` if it is not NULL to combine with
+  Layer *Compact(int layer_number,
+                 const DoubleArrayTrieTree *system_index = NULL,
+                 const StaticArray<float> *system_cost = NULL) const;
+
+  // Returns a new snapshot with the first `compacted_layers` layers replaced
+  // by `compacted`, the result of `Compact` on the same layers of an older
+  // snapshot. If this snapshot no longer starts with these layers, the
+  // `compacted` is discarded and NULL is returned
+  UserDictionary *Replace(const UserDictionary *compacted_snapshot,
+                          Layer *compacted,
+                          int compacted_layers,
+                          int64_t version) const;
+
+  // Increases the reference count
+  void AddRef();
+
+  // Decreases the reference count, deletes this snapshot if it reaches 0
+  void Release();
+
+  // Traverses the user words with `len` bytes of `text` from the state
+  // `nodes`, which contains `layer_number()` elements that are all 0 at the
+  // beginning. If the traversed string is a user word, returns its term-id and
+  // stores its cost into `cost`. If it is removed, returns kRemoved.
+  // Otherwise, returns TrieTree::kExist if it is a prefix of some words or
+  // TrieTree::kNone if not. The combined layer is not traversed
+  int Traverse(const char *text, int len, size_t *nodes, float *cost) const;
+
+  // The combined index of system and user dictionary, or NULL if the first
+  // layer is not combined. The value of a word is the index of its
+  // CombinedEntry
+  const DoubleArrayTrieTree *combined_index() const {
+    return combined_index_;
+  }
+  const CombinedEntry &combined_entry(int idx) const {
+    return combined_entries_[idx];
+  }
+
+  // Term-id of the user word at `position` in the combined index
+  int combined_term_id(int position) const {
+    return combined_id_start_ + position;
+  }
+
+  // Returns true if there are layers to traverse by `Traverse`
+  bool has_layers() const { return layer_number() > first_layer_; }
+
+  // Number of layers in this snapshot
+  int layer_number() const { return static_cast<int>(layers_.size()); }
+
+  // Version of this snapshot, a newer snapshot has a larger version
+  int64_t version() const { return version_; }
+
+  // Returns true if there are too many layers and they should be compacted
+  bool NeedsCompaction() const { return layers_.size() > kMaxLayers; }
+
+ private:
+  // An entry in a layer. A removed entry hides the word in older layers
+  struct Entry {
+    float cost;
+    bool removed;
+  };
+  typedef std::map<std::string, Entry> EntryMap;
+
+  // The maximum number of words to merge into a new layer in an update
+  static const int kMergeSizeMax = 16384;
+
+  // The maximum number of layers before compacting
+  static const int kMaxLayers = 8;
+
+  // Stored in nodes of Traverse after traversing failed in a layer
+  static const size_t kNoNode = static_cast<size_t>(-1);
+
+  // Layers from the oldest to the newest. The term-id of the word at position
+  // i of layers_[j] is id_starts_[j] + i. The layers are shared between
+  // snapshots, but the term-ids are only unique in one snapshot, so each
+  // snapshot assigns them from kUserTermIdStart again
+  std::vector<Layer *> layers_;
+  std::vector<int> id_starts_;
+  int64_t version_;
+  int ref_count_;
+
+  // From the combined index of first layer, `first_layer_` is 1 if it exists
+  const DoubleArrayTrieTree *combined_index_;
+  const CombinedEntry *combined_entries_;
+  int combined_id_start_;
+  int first_layer_;
+
+  UserDictionary(int64_t version);
+  ~UserDictionary();
+
+  // Appends `layer` to the layers and assigns the term-ids after the previous
+  // layer to it. It takes the reference of the caller
+  void AppendLayer(Layer *layer);
+
+  // Returns a new snapshot with `entries` pushed onto the layers
+  UserDictionary *Push(const EntryMap &entries,
+                       int fixed_layers,
+                       int64_t version) const;
+
+  // Merges layers in [begin, end) into `entries`, the entries already in
+  // `entries` are newer than them. Removed entries are dropped if `begin` is
+  // the oldest layer
+  void MergeLayers(int begin, int end, EntryMap *entries) const;
+
+  DISALLOW_COPY_AND_ASSIGN(UserDictionary);
+};
+
+}  // namespace milkcat
+
+#endif  // SRC_COMMON_USER_DICTIONARY_H_
@@ -34,31 +34,7 @@
 
 namespace milkcat {
 
-class Parser;
-
-// ---------------------------- Model ----------------------------------------
-
-class Model {
- public:
-  class Impl;
-
-  ~Model();
-  
-  // Create the model for further use. model_dir is the path of the model data
-  // dir, NULL is to use the default data dir.
-  static Model *New(const char *model_dir = NULL);
-
-  // Set the user dictionary for segmenter. On success, return true. On failed,
-  // return false;
-  bool SetUserDictionary(const char *userdict_path);
-
-  // Get the instance of the implementation class
-  Impl *impl() { return impl_; }
-
- private:
-  Model();
-  Impl *impl_;
-};
+class Model;
 
 // ---------------------------- Parser ---------------------------------------
 
@@ -168,6 +144,55 @@ class Parser::Iterator {
   Impl *impl_;
 };
 
+// ---------------------------- Model ----------------------------------------
+
+class Model {
+ public:
+  class Impl;
+
+  ~Model();
+  
+  // Create the model for further use. model_dir is the path of the model data
+  // dir or a model bundle file built by `mctools bundle`, NULL is to use the
+  // default data dir. On failed, returns NULL and LastError() tells why
+  static Model *New(const char *model_dir = NULL);
+
+  // Set the user dictionary for segmenter. On success, return true. On failed,
+  // return false. It could be called again to update the user dictionary while
+  // parsers of this model are running, they use the new one from the next
+  // sentence. If `combined` is true, the user dictionary and the system
+  // dictionary are built into one index, which makes segmenting faster but
+  // takes more time and memory to load
+  bool SetUserDictionary(const char *userdict_path, bool combined = false);
+
+  // Adds `size` words to the user dictionary or replaces their costs, without
+  // rebuilding the whole user dictionary. `costs` could be NULL to use the
+  // default cost for all words
+  void AddUserWords(const char *const *words, const float *costs, int size);
+
+  // Removes `size` words from the user dictionary
+  void RemoveUserWords(const char *const *words, int size);
+
+  // Loads all the model data needed by the parser with `options` in advance,
+  // `threads` pieces of data are loaded in parallel and 0 means the number of
+  // processors. On success, returns true. On failed, returns false and
+  // LastError() tells why
+  bool Preload(const Parser::Options &options, int threads = 0);
+
+  // The pieces of data loaded by last Preload, their names and the time in
+  // seconds to load each of them
+  int preload_number() const;
+  const char *preload_name(int idx) const;
+  double preload_time(int idx) const;
+
+  // Get the instance of the implementation class
+  Impl *impl() { return impl_; }
+
+ private:
+  Model();
+  Impl *impl_;
+};
+
 // Get the information of last error
 const char *LastError();
 
@@ -30,6 +30,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <map>
 #include <string>
 #include <utility>
 #include <vector>
@@ -315,38 +316,41 @@ Parser::Impl::~Impl() {
 }
 
 Parser::Impl *Parser::Impl::New(const Options &options, Model *model) {
-  global_status = Status::OK();
+  Status status;
   Impl *self = new Parser::Impl();
   int type = options.TypeValue();
   Model::Impl *model_impl = model? model->impl(): NULL;
 
   if (model_impl == NULL) {
-    self->model_impl_ = new Model::Impl(MODEL_PATH);
+    self->model_impl_ = Model::Impl::New(MODEL_PATH, &status);
     self->own_model_ = true;
   } else {
     self->model_impl_ = model_impl;
     self->own_model_ = false;
   }
 
-  if (global_status.ok())
+  if (status.ok())
     self->segmenter_ = SegmenterFactory(
         self->model_impl_,
         type,
-        &global_status);
+        &status);
 
-  if (global_status.ok())
+  if (status.ok())
     self->part_of_speech_tagger_ = PartOfSpeechTaggerFactory(
         self->model_impl_,
         type,
-        &global_status);
+        &status);
 
-  if (global_status.ok())
+  if (status.ok())
     self->dependency_parser_ = DependencyParserFactory(
         self->model_impl_,
         type,
-        &global_status);
+        &status);
 
-  if (!global_status.ok()) {
+  // Only touches the global state on failure, so that parsers could be
+  // created from several threads at once
+  if (!status.ok()) {
+    global_status = status;
     delete self;
     return NULL;
   } else {
@@ -443,14 +447,105 @@ Model::~Model() {
 }
 
 Model *Model::New(const char *model_dir) {
-  Model *self = new Model();
-  self->impl_ = new Model::Impl(model_dir? model_dir: MODEL_PATH);
+  Status status;
+  Model::Impl *impl = Model::Impl::New(model_dir? model_dir: MODEL_PATH,
+                                       &status);
+  if (impl == NULL) {
+    global_status = status;
+    return NULL;
+  }
 
+  Model *self = new Model();
+  self->impl_ = impl;
   return self;
 }
 
-bool Model::SetUserDictionary(const char *userdict_path) {
-  return impl_->SetUserDictionary(userdict_path);
+bool Model::SetUserDictionary(const char *userdict_path, bool combined) {
+  return impl_->SetUserDictionary(userdict_path, combined);
+}
+
+void Model::AddUserWords(const char *const *words,
+                         const float *costs,
+                         int size) {
+  std::map<std::string, float> word_costs;
+  for (int i = 0; i < size; ++i) {
+    word_costs[words[i]] = costs != NULL? costs[i]: kDefaultCost;
+  }
+  impl_->AddUserWords(word_costs);
+}
+
+void Model::RemoveUserWords(const char *const *words, int size) {
+  impl_->RemoveUserWords(std::vector<std::string>(words, words + size));
+}
+
+namespace {
+
+// Gets the model components needed by the segmenter, part-of-speech tagger and
+// dependency parser of `parser_type`
+void ComponentsOfParser(int parser_type,
+                        std::vector<Model::Impl::Component> *components) {
+  switch (parser_type & kSegmenterMask) {
+    case kMixedSegmenter:
+      components->push_back(Model::Impl::kCRFSegModel);
+      components->push_back(Model::Impl::kOOVProperty);
+      // fall through
+    case kBigramSegmenter:
+      components->push_back(Model::Impl::kBigramCost);
+      // fall through
+    case kUnigramSegmenter:
+      components->push_back(Model::Impl::kUnigramIndex);
+      components->push_back(Model::Impl::kUnigramCost);
+      break;
+    case kCrfSegmenter:
+      components->push_back(Model::Impl::kCRFSegModel);
+      break;
+  }
+
+  switch (parser_type & kPartOfSpeechTaggerMask) {
+    case kMixedTagger:
+      components->push_back(Model::Impl::kCRFPosModel);
+      components->push_back(Model::Impl::kHMMPosModel);
+      break;
+    case kCrfTagger:
+      components->push_back(Model::Impl::kCRFPosModel);
+      break;
+    case kHmmTagger:
+      components->push_back(Model::Impl::kHMMPosModel);
+      break;
+  }
+
+  if ((parser_type & kParserMask) == kArcEagerParser) {
+    components->push_back(Model::Impl::kDependencyModel);
+    components->push_back(Model::Impl::kDependencyTemplate);
+  }
+}
+
+}  // namespace
+
+bool Model::Preload(const Parser::Options &options, int threads) {
+  Status status;
+  std::vector<Model::Impl::Component> components;
+  ComponentsOfParser(options.TypeValue(), &components);
+  impl_->Preload(components, threads, &status);
+
+  if (status.ok()) {
+    return true;
+  } else {
+    global_status = status;
+    return false;
+  }
+}
+
+int Model::preload_number() const {
+  return impl_->preload_number();
+}
+
+const char *Model::preload_name(int idx) const {
+  return Model::Impl::ComponentName(impl_->preload_component(idx));
+}
+
+double Model::preload_time(int idx) const {
+  return impl_->preload_time(idx);
 }
 
 const char *LastError() {
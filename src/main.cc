@@ -67,7 +67,7 @@ int PrintUsage() {
   printf("    milkcat [parser-options] filename|-i\n");
   printf("        Parses the text from filename or stdin (-i).\n");
   printf("Parser Options:\n");
-  printf("    -d <path>    Set the path of model directory.\n");
+  printf("    -d <path>    Set the path of model directory or bundle.\n");
   printf("    -u <path>    Set the path of user dictionary file.\n");
   printf("    -m <method>  Set the parsing method. methods are:\n");
   printf("        crf_seg     - Use CRF segmenter.\n");
@@ -104,8 +104,6 @@ const char *WordType(int word_type) {
 
 void GetArgs(int argc, char **argv, Options *options) {
   char c;
-  char last_char;
-  std::string model_dir;
 
   while ((c = getopt(argc, argv, "iu:td:m:")) != -1) {
     switch (c) {
@@ -115,10 +113,7 @@ void GetArgs(int argc, char **argv, Options *options) {
 
       case 'd':
         options->use_default_model_dir = false;
-        model_dir = optarg;
-        last_char = model_dir[model_dir.size() - 1];
-        if (last_char != '/') model_dir.push_back('/');
-        options->model_dir = model_dir;
+        options->model_dir = optarg;
         break;
 
       case 'u':
@@ -33,11 +33,16 @@
 #include <stdint.h>
 #include <assert.h>
 #include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
 #include <map>
 #include <string>
 #include <algorithm>
 #include <set>
+#include "common/bundle.h"
+#include "common/compressed_bigram_table.h"
 #include "common/darts.h"
+#include "common/elias_fano_bigram_table.h"
 #include "common/reimu_trie.h"
 #include "common/static_array.h"
 #include "common/static_hashtable.h"
@@ -49,8 +54,12 @@
 #include "parser/beam_arceager_dependency_parser.h"
 #include "parser/dependency_parser.h"
 #include "parser/naive_arceager_dependency_parser.h"
+#include "segmenter/bigram_segmenter.h"
+#include "segmenter/term_instance.h"
 #include "tagger/crf_part_of_speech_tagger.h"
 #include "tagger/hmm_part_of_speech_tagger.h"
+#include "tokenizer/token_instance.h"
+#include "tokenizer/tokenizer.h"
 #include "utils/utils.h"
 #include "utils/readable_file.h"
 #include "utils/writable_file.h"
@@ -169,6 +178,44 @@ void BuildAndSaveUnigramData(const std::map<std::string, double> &unigram_data,
   delete fd;
 }
 
+// Formats of the bigram file saved by mctools gram
+enum BigramFormat {
+  kHashBigramFormat,
+  kCompressedBigramFormat,
+  kEliasFanoBigramFormat
+};
+
+// Saves the bigram keys and costs into `file_path` in `format`
+void SaveBigramTable(const std::vector<int64_t> &keys,
+                     const std::vector<float> &costs,
+                     BigramFormat format,
+                     const char *file_path,
+                     Status *status) {
+  if (format == kCompressedBigramFormat) {
+    const CompressedBigramTable *table = CompressedBigramTable::Build(
+        keys.data(),
+        costs.data(),
+        keys.size());
+    table->Save(file_path, status);
+    delete table;
+  } else if (format == kEliasFanoBigramFormat) {
+    const EliasFanoBigramTable *table = EliasFanoBigramTable::Build(
+        keys.data(),
+        costs.data(),
+        keys.size());
+    table->Save(file_path, status);
+    delete table;
+  } else {
+    const StaticHashTable<int64_t, float> *
+    hashtable = StaticHashTable<int64_t, float>::Build(
+        keys.data(),
+        costs.data(),
+        keys.size());
+    hashtable->Save(file_path, status);
+    delete hashtable;
+  }
+}
+
 // Save unigram data into binary file UNIGRAM_FILE. On success, return the
 // number of bigram word pairs successfully writed. On failed, set status !=
 // Status::OK()
@@ -176,6 +223,7 @@ int SaveBigramBinFile(
     const std::map<std::pair<std::string, std::string>, int> &bigram_data,
     int total_count,
     const Darts::DoubleArray &double_array,
+    BigramFormat format,
     Status *status) {
   const char *left_word, *right_word;
   int32_t left_id, right_id;
@@ -196,25 +244,79 @@ int SaveBigramBinFile(
     }
   }
 
+  SaveBigramTable(keys, values, format, BIGRAM_FILE, status);
+  return keys.size();
+}
+
+// Converts the bigram file `input_path` from an older format into `format`
+// and saves it as `output_path`
+int ConvertBigramFile(const char *input_path,
+                      const char *output_path,
+                      BigramFormat format) {
+  Status status;
+
+  printf("Loading bigram binary file ...");
+  fflush(stdout);
   const StaticHashTable<int64_t, float> *
-  hashtable = StaticHashTable<int64_t, float>::Build(
-      keys.data(),
-      values.data(),
-      keys.size());
-  hashtable->Save(BIGRAM_FILE, status);
+  hashtable = StaticHashTable<int64_t, float>::New(input_path, &status);
+
+  if (status.ok()) {
+    printf(" OK, %d entries loaded.\n", hashtable->size());
+    printf("Saving bigram binary file ...");
+    fflush(stdout);
+    std::vector<int64_t> keys;
+    std::vector<float> costs;
+    hashtable->GetAllPairs(&keys, &costs);
+    SaveBigramTable(keys, costs, format, output_path, &status);
+  }
 
   delete hashtable;
-  return keys.size();
+  if (status.ok()) {
+    printf(" OK\n");
+    return 0;
+  } else {
+    puts(status.what());
+    return -1;
+  }
 }
 
 int MakeGramModel(int argc, char **argv) {
+  // The options before the file arguments: --convert converts a bigram
+  // binary file, --csr and --elias-fano choose the format of the bigram file
+  BigramFormat format = kHashBigramFormat;
+  bool convert = false;
+  bool bad_option = false;
+  int argi = 2;
+  for (; argi < argc && strncmp(argv[argi], "--", 2) == 0; ++argi) {
+    if (strcmp(argv[argi], "--convert") == 0) {
+      convert = true;
+    } else if (strcmp(argv[argi], "--csr") == 0) {
+      format = kCompressedBigramFormat;
+    } else if (strcmp(argv[argi], "--elias-fano") == 0) {
+      format = kEliasFanoBigramFormat;
+    } else {
+      bad_option = true;
+    }
+  }
+  if (!bad_option && convert && argc - argi == 2) {
+    return ConvertBigramFile(argv[argc - 2], argv[argc - 1], format);
+  }
+
   Darts::DoubleArray double_array;
   std::map<std::string, double> unigram_data;
   std::map<std::pair<std::string, std::string>, int> bigram_data;
   Status status;
 
-  if (argc != 4)
-    status = Status::Info("Usage: mc_model gram [UNIGRAM FILE] [BIGRAM FILE]");
+  if (bad_option || convert || argc - argi != 2)
+    status = Status::Info(
+        "Usage: mc_model gram [--csr|--elias-fano] [UNIGRAM FILE]"
+        " [BIGRAM FILE]\n"
+        "       mc_model gram --convert [--csr|--elias-fano]"
+        " [OLD BIGRAM BIN] [NEW BIGRAM BIN]\n"
+        "  --csr         compressed rows of right ids, a size/speed trade-off:"
+        " the file is\n"
+        "                about 1/10 of the default hash table, but the"
+        " segmenter is slower");
 
   const char *unigram_file = argv[argc - 2];
   const char *bigram_file = argv[argc - 1];
@@ -244,7 +346,11 @@ int MakeGramModel(int argc, char **argv) {
   if (status.ok()) {
     printf(" OK\n");
     printf("Saving Bigram Binary File ...");
-    count = SaveBigramBinFile(bigram_data, total_count, double_array, &status);
+    count = SaveBigramBinFile(bigram_data,
+                              total_count,
+                              double_array,
+                              format,
+                              &status);
   }
 
   if (status.ok()) {
@@ -456,6 +562,86 @@ int TestPartOfSpeechTagger(int argc, char **argv) {
   return 0;
 }
 
+// Segments the sentences in corpus_file `round` times with the bigram and the
+// unigram segmenter and prints their throughputs. The corpus is tokenized
+// before timing
+int BenchmarkSegmenter(int argc, char **argv) {
+  if (argc != 3 && argc != 4) {
+    fprintf(stderr,
+            "Usage: milkcat-tools --segmenter-bench corpus_file "
+            "[model_dir]\n");
+    return 1;
+  }
+  const char *corpus_file = argv[2];
+  const char *model_dir = argc == 4? argv[3]: NULL;
+  const int round = 100;
+
+  Status status;
+  std::vector<char> text;
+  ReadableFile *fd = ReadableFile::New(corpus_file, &status);
+  if (status.ok()) {
+    text.resize(fd->Size() + 1);
+    fd->Read(text.data(), fd->Size(), &status);
+    text.back() = '\0';
+  }
+  delete fd;
+
+  std::vector<TokenInstance *> sentences;
+  int token_number = 0;
+  if (status.ok()) {
+    Tokenization tokenizer;
+    tokenizer.Scan(text.data());
+    TokenInstance *token_instance = new TokenInstance();
+    while (tokenizer.GetSentence(token_instance)) {
+      token_number += token_instance->size();
+      sentences.push_back(token_instance);
+      token_instance = new TokenInstance();
+    }
+    delete token_instance;
+  }
+
+  Model *model = NULL;
+  if (status.ok()) {
+    model = Model::New(model_dir);
+    if (model == NULL) status = Status::Corruption(LastError());
+  }
+
+  TermInstance term_instance;
+  const char *names[] = {"bigram", "unigram"};
+  for (int i = 0; i < 2 && status.ok(); ++i) {
+    BigramSegmenter *segmenter = BigramSegmenter::New(model->impl(),
+                                                      i == 0,
+                                                      &status);
+    if (status.ok()) {
+      double start_time = Now();
+      for (int r = 0; r < round; ++r) {
+        for (std::vector<TokenInstance *>::iterator
+             it = sentences.begin(); it != sentences.end(); ++it) {
+          segmenter->Segment(&term_instance, *it);
+        }
+      }
+      double elapsed = Now() - start_time;
+      printf("%s: %d tokens x %d in %.3fs, %.0f tokens/s\n",
+             names[i],
+             token_number,
+             round,
+             elapsed,
+             token_number * round / elapsed);
+    }
+    delete segmenter;
+  }
+
+  if (!status.ok()) puts(status.what());
+
+  for (std::vector<TokenInstance *>::iterator
+       it = sentences.begin(); it != sentences.end(); ++it) {
+    delete *it;
+  }
+  delete model;
+
+  return status.ok()? 0: 1;
+}
+
 int TrainHmmPartOfSpeechTagger(int argc, char **argv) {
   if (argc != 5) {
     fprintf(stderr,
@@ -500,6 +686,92 @@ int WapitiConvert(int argc, char **argv) {
   }
 }
 
+// Verifies the checksums of all sections in the bundle file `bundle_path`
+int VerifyBundle(const char *bundle_path) {
+  Status status;
+  Bundle *bundle = Bundle::Open(bundle_path, &status);
+  if (status.ok()) bundle->Verify(&status);
+
+  if (status.ok()) {
+    for (int i = 0; i < bundle->section_number(); ++i) {
+      printf("%-32s %12ld\n",
+             bundle->section_name(i),
+             static_cast<long>(bundle->section_size(i)));
+    }
+    printf("OK, %d sections verified.\n", bundle->section_number());
+  }
+
+  delete bundle;
+  if (status.ok()) {
+    return 0;
+  } else {
+    puts(status.what());
+    return -1;
+  }
+}
+
+// Packs all the model files in a model directory into a single bundle file.
+// Hidden files and other bundles in the directory are skipped
+int MakeBundle(int argc, char **argv) {
+  if (argc == 4 && strcmp(argv[2], "--verify") == 0) {
+    return VerifyBundle(argv[3]);
+  }
+
+  Status status;
+  if (argc != 4)
+    status = Status::Info(
+        "Usage: mc_model bundle [MODEL DIR] [OUTPUT FILE]\n"
+        "       mc_model bundle --verify [BUNDLE FILE]");
+
+  std::string model_dir;
+  DIR *dir = NULL;
+  if (status.ok()) {
+    model_dir = argv[2];
+    if (model_dir[model_dir.size() - 1] != '/') model_dir.push_back('/');
+    dir = opendir(model_dir.c_str());
+    if (dir == NULL) status = Status::IOError(model_dir.c_str());
+  }
+
+  std::vector<std::string> section_names;
+  std::vector<std::string> file_paths;
+  const char *bundle_suffix = ".bundle";
+  struct dirent *entry;
+  while (status.ok() && (entry = readdir(dir)) != NULL) {
+    std::string name = entry->d_name;
+    std::string file_path = model_dir + name;
+    struct stat file_stat;
+    if (name[0] == '.' ||
+        stat(file_path.c_str(), &file_stat) != 0 ||
+        !S_ISREG(file_stat.st_mode)) continue;
+    if (name.size() >= strlen(bundle_suffix) &&
+        name.compare(name.size() - strlen(bundle_suffix),
+                     std::string::npos,
+                     bundle_suffix) == 0) continue;
+    section_names.push_back(name);
+  }
+  if (dir != NULL) closedir(dir);
+
+  if (status.ok()) {
+    std::sort(section_names.begin(), section_names.end());
+    for (std::vector<std::string>::iterator
+         it = section_names.begin(); it != section_names.end(); ++it) {
+      file_paths.push_back(model_dir + *it);
+    }
+
+    printf("Packing %d model files ...", static_cast<int>(file_paths.size()));
+    fflush(stdout);
+    Bundle::Create(argv[3], section_names, file_paths, &status);
+  }
+
+  if (status.ok()) {
+    printf(" OK\n");
+    return 0;
+  } else {
+    puts(status.what());
+    return -1;
+  }
+}
+
 }  // namespace milkcat
 
 int main(int argc, char **argv) {
@@ -514,6 +786,8 @@ int main(int argc, char **argv) {
     return milkcat::MakeIndexFile(argc, argv);
   } else if (strcmp(tool, "gram") == 0) {
     return milkcat::MakeGramModel(argc, argv);
+  } else if (strcmp(tool, "bundle") == 0) {
+    return milkcat::MakeBundle(argc, argv);
   } else if (strcmp(tool, "multiperc") == 0) {
     return milkcat::MakeMulticlassPerceptronFile(argc, argv);
   } else if (strcmp(tool, "--depparser-train") == 0) {
@@ -522,6 +796,8 @@ int main(int argc, char **argv) {
     return milkcat::TestDependendyParser(argc, argv);
   } else if (strcmp(tool, "--postagger-test") == 0) {
     return milkcat::TestPartOfSpeechTagger(argc, argv);
+  } else if (strcmp(tool, "--segmenter-bench") == 0) {
+    return milkcat::BenchmarkSegmenter(argc, argv);
   } else if (strcmp(tool, "--postagger-train") == 0) {
     return milkcat::TrainHmmPartOfSpeechTagger(argc, argv);  
   } else if (strcmp(tool, "--wapiti-conv") == 0) {
@@ -30,27 +30,31 @@
 #include <assert.h>
 #include <stdio.h>
 #include <algorithm>
+#include <vector>
 #include "utils/utils.h"
 
 namespace milkcat {
 
+template<class T, class Comparator> class BeamList;
+
 template<class T, class Comparator>
 class Beam {
  public:
   Beam(int beam_size):
       capability_(beam_size * 10),
       beam_size_(beam_size),
-      size_(0) {
+      size_(0),
+      owns_items_(true) {
     items_ = new T *[capability_];
   }
 
   ~Beam() {
-    delete[] items_;
+    if (owns_items_) delete[] items_;
   }
 
   int size() const { return size_; }
   T *at(int index) const {
-    ASSERT(index < beam_size_, "Beam index overflow");
+    ASSERT(index < size_, "Beam index overflow");
     return items_[index];
   }
 
@@ -80,11 +84,107 @@ class Beam {
   }
 
  private:
+  friend class BeamList<T, Comparator>;
+
   T **items_;
   int capability_;
   Comparator comparator_;
   int beam_size_;
   int size_;
+  bool owns_items_;
+
+  // The beam in a BeamList, `items` is owned by the BeamList
+  Beam(int beam_size, T **items):
+      items_(items),
+      capability_(beam_size * 10),
+      beam_size_(beam_size),
+      size_(0),
+      owns_items_(false) {
+  }
+};
+
+// A list of Beam whose items are stored in one flat buffer. It grows on
+// demand to the largest number of beams required
+template<class T, class Comparator>
+class BeamList {
+ public:
+  explicit BeamList(int beam_size): beam_size_(beam_size), items_(NULL) {
+  }
+
+  ~BeamList() {
+    delete[] items_;
+  }
+
+  int size() const { return static_cast<int>(beams_.size()); }
+  Beam<T, Comparator> *at(int index) {
+    assert(index < size());
+    return &beams_[index];
+  }
+
+  // Grows the list to at least `size` beams, the new beams are empty. It
+  // invalidates the pointers returned by at()
+  void Reserve(int size) {
+    if (size <= this->size()) return;
+    if (size < 2 * this->size()) size = 2 * this->size();
+
+    int capability = beam_size_ * 10;
+    T **items = new T *[size * capability];
+    for (int i = 0; i < this->size(); ++i) {
+      Beam<T, Comparator> &beam = beams_[i];
+      std::copy(beam.items_, beam.items_ + beam.size_, items + i * capability);
+      beam.items_ = items + i * capability;
+    }
+    delete[] items_;
+    items_ = items;
+
+    beams_.reserve(size);
+    for (int i = this->size(); i < size; ++i) {
+      beams_.push_back(Beam<T, Comparator>(beam_size_,
+                                           items + i * capability));
+    }
+  }
+
+  // Shrinks the list to `size` beams and frees the items of the others if it
+  // has more. It invalidates the pointers returned by at()
+  void Release(int size) {
+    if (size >= this->size()) return;
+
+    int capability = beam_size_ * 10;
+    T **items = new T *[size * capability];
+    std::vector<Beam<T, Comparator> >(beams_.begin(),
+                                      beams_.begin() + size).swap(beams_);
+    for (int i = 0; i < size; ++i) {
+      Beam<T, Comparator> &beam = beams_[i];
+      std::copy(beam.items_, beam.items_ + beam.size_, items + i * capability);
+      beam.items_ = items + i * capability;
+    }
+    delete[] items_;
+    items_ = items;
+  }
+
+  // Removes the first `count` beams, the beams after them are moved to the
+  // front and the last `count` beams are empty
+  void Shift(int count) {
+    for (int i = 0; i < size(); ++i) {
+      Beam<T, Comparator> &beam = beams_[i];
+      if (i + count < size()) {
+        const Beam<T, Comparator> &from_beam = beams_[i + count];
+        std::copy(from_beam.items_,
+                  from_beam.items_ + from_beam.size_,
+                  beam.items_);
+        beam.size_ = from_beam.size_;
+      } else {
+        beam.Clear();
+      }
+    }
+  }
+
+ private:
+  std::vector<Beam<T, Comparator> > beams_;
+  int beam_size_;
+  T **items_;
+
+  DISALLOW_COPY_AND_ASSIGN(BeamList);
 };
 
 }  // namespace milkcat
@@ -0,0 +1,184 @@
+//
+// The MIT License (MIT)
+//
+// Copyright 2013-2014 The MilkCat Project Developers
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// character_score_table.cc --- Created at 2015-01-15
+//
+
+#include "ml/character_score_table.h"
+#include <utility>
+#include "ml/crf_model.h"
+
+namespace milkcat {
+
+namespace {
+
+// Gets the number of bytes of the UTF-8 character starts with `lead` and
+// sets `bits` to the code point bits in it. Returns 0 if `lead` could not
+// start a character
+int LeadByte(int lead, int *bits) {
+  if (lead >= 0x01 && lead <= 0x7f) {
+    *bits = lead;
+    return 1;
+  } else if (lead >= 0xc2 && lead <= 0xdf) {
+    *bits = lead & 0x1f;
+    return 2;
+  } else if (lead >= 0xe0 && lead <= 0xef) {
+    *bits = lead & 0x0f;
+    return 3;
+  } else if (lead >= 0xf0 && lead <= 0xf4) {
+    *bits = lead & 0x07;
+    return 4;
+  } else {
+    return 0;
+  }
+}
+
+// Returns true if `code_point` is the shortest encoding of `length` bytes
+bool IsShortestForm(int code_point, int length) {
+  static const int kMinCodePoint[] = {0, 0, 0x80, 0x800, 0x10000};
+  return code_point >= kMinCodePoint[length] && code_point <= 0x10ffff;
+}
+
+}  // namespace
+
+CharacterScoreTable::CharacterScoreTable(): slot_number_(0), ysize_(0) {
+}
+
+CharacterScoreTable *CharacterScoreTable::New(const CRFModel *model) {
+  CharacterScoreTable *self = new CharacterScoreTable();
+  self->ysize_ = model->ysize();
+
+  // Templates like "u1:%x[0,0]" have only one field and nothing after it
+  for (int i = 0; i < model->unigram_template_num(); ++i) {
+    const CRFModel::Template &tmpl = model->compiled_unigram_template(i);
+    if (tmpl.fields.size() == 1 &&
+        tmpl.fields[0].column == 0 &&
+        tmpl.fields[0].suffix.empty()) {
+      self->slots_.push_back(self->slot_number_++);
+    } else {
+      self->slots_.push_back(-1);
+    }
+  }
+
+  // Character kNoFeature has zero scores
+  self->dense_ids_.assign(kDenseSize, kNoFeature);
+  self->scores_.assign(self->row_size(), 0.0f);
+
+  for (int i = 0; i < model->unigram_template_num(); ++i) {
+    const CRFModel::Template &tmpl = model->compiled_unigram_template(i);
+    if (self->slots_[i] >= 0 && tmpl.prefix_node != CRFModel::kNoNode) {
+      self->CollectCharacters(model,
+                              self->slots_[i],
+                              tmpl.prefix_node,
+                              0,
+                              0,
+                              0);
+    }
+  }
+
+  return self;
+}
+
+int CharacterScoreTable::PutCharacter(int code_point) {
+  int *id;
+  if (code_point < kDenseSize) {
+    id = &dense_ids_[code_point];
+  } else {
+    unordered_map<int, int>::iterator it = rare_ids_.find(code_point);
+    if (it == rare_ids_.end()) {
+      it = rare_ids_.insert(std::make_pair(code_point, kNoFeature)).first;
+    }
+    id = &it->second;
+  }
+
+  if (*id == kNoFeature) {
+    *id = character_number();
+    scores_.resize(scores_.size() + row_size(), 0.0f);
+  }
+  return *id;
+}
+
+void CharacterScoreTable::CollectCharacters(const CRFModel *model,
+                                            int slot,
+                                            int node,
+                                            int remaining,
+                                            int length,
+                                            int code_point) {
+  // Lead bytes when `remaining` is 0, otherwise continuation bytes
+  int first = remaining == 0? 0x01: 0x80;
+  int last = remaining == 0? 0xf4: 0xbf;
+  char key[2] = {0, 0};
+  for (int byte = first; byte <= last; ++byte) {
+    int bits = byte & 0x3f;
+    int next_remaining = remaining - 1;
+    int next_length = length;
+    if (remaining == 0) {
+      next_length = LeadByte(byte, &bits);
+      if (next_length == 0) continue;
+      next_remaining = next_length - 1;
+    }
+
+    key[0] = static_cast<char>(byte);
+    int next_node = node;
+    int xid;
+    if (!model->TraverseX(&next_node, key, &xid)) continue;
+
+    int next_code_point = (code_point << 6) | bits;
+    if (remaining == 0) next_code_point = bits;
+    if (next_remaining > 0) {
+      CollectCharacters(model,
+                        slot,
+                        next_node,
+                        next_remaining,
+                        next_length,
+                        next_code_point);
+    } else if (xid >= 0 && IsShortestForm(next_code_point, next_length)) {
+      int id = PutCharacter(next_code_point);
+      float *row = &scores_[(id * slot_number_ + slot) * ysize_];
+      for (int yid = 0; yid < ysize_; ++yid) {
+        row[yid] = static_cast<float>(model->unigram_cost(xid, yid));
+      }
+    }
+  }
+}
+
+int CharacterScoreTable::CharacterId(const char *observation) const {
+  const unsigned char *p = reinterpret_cast<const unsigned char *>(
+      observation);
+  int code_point;
+  int length = LeadByte(p[0], &code_point);
+  if (length == 0) return kNotCharacter;
+  for (int i = 1; i < length; ++i) {
+    if ((p[i] & 0xc0) != 0x80) return kNotCharacter;
+    code_point = (code_point << 6) | (p[i] & 0x3f);
+  }
+  if (p[length] != '\0' || !IsShortestForm(code_point, length)) {
+    return kNotCharacter;
+  }
+
+  if (code_point < kDenseSize) return dense_ids_[code_point];
+  unordered_map<int, int>::const_iterator it = rare_ids_.find(code_point);
+  return it == rare_ids_.end()? kNoFeature: it->second;
+}
+
+}  // namespace milkcat
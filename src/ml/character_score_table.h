@@ -0,0 +1,112 @@
+//
+// The MIT License (MIT)
+//
+// Copyright 2013-2014 The MilkCat Project Developers
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// character_score_table.h --- Created at 2015-01-15
+//
+
+#ifndef SRC_ML_CHARACTER_SCORE_TABLE_H_
+#define SRC_ML_CHARACTER_SCORE_TABLE_H_
+
+#include <vector>
+#include "utils/utils.h"
+
+namespace milkcat {
+
+class CRFModel;
+
+// CharacterScoreTable is a load-time transform of the CRF unigram templates
+// whose only field is a single character like "u1:%x[0,0]". It maps each
+// character to an id, and stores the per-tag scores of these templates in a
+// dense array indexed by (character id, template). So the unigram cost of
+// a character is got by array reads instead of walking the feature index.
+// Characters in the Basic Multilingual Plane are mapped by a dense array and
+// the others by a hash table
+class CharacterScoreTable {
+ public:
+  enum {
+    // The id of characters which have no feature in any template of the table
+    kNoFeature = 0,
+
+    // Returned by CharacterId when the observation is not a single character
+    kNotCharacter = -1
+  };
+
+  // Builds the table from the unigram templates of `model`
+  static CharacterScoreTable *New(const CRFModel *model);
+
+  // Gets the id of `observation`. Returns kNotCharacter if it is not a
+  // single UTF-8 character
+  int CharacterId(const char *observation) const;
+
+  // Returns true if the `template_id`th unigram template is in the table
+  bool has_template(int template_id) const {
+    return slots_[template_id] >= 0;
+  }
+
+  // Gets the scores of tags for the `template_id`th unigram template with
+  // character `character_id`. The template should be in the table
+  const float *scores(int template_id, int character_id) const {
+    int slot = slots_[template_id];
+    return &scores_[(character_id * slot_number_ + slot) * ysize_];
+  }
+
+  // Number of characters in the table
+  int character_number() const {
+    return row_size() == 0? 0: scores_.size() / row_size();
+  }
+
+ private:
+  // Code points below it are mapped by `dense_ids_`
+  enum { kDenseSize = 0x10000 };
+
+  std::vector<int> slots_;
+  int slot_number_;
+  int ysize_;
+  std::vector<int> dense_ids_;
+  unordered_map<int, int> rare_ids_;
+  std::vector<float> scores_;
+
+  CharacterScoreTable();
+
+  int row_size() const { return slot_number_ * ysize_; }
+
+  // Gets the id of `code_point`, adds it if not exists
+  int PutCharacter(int code_point);
+
+  // Walks the feature index of `model` from `node` through every UTF-8
+  // character, `remaining` is the number of bytes left in current character
+  // and `code_point` is the bits got so far. Stores the scores of the
+  // features found into `slot`
+  void CollectCharacters(const CRFModel *model,
+                         int slot,
+                         int node,
+                         int remaining,
+                         int length,
+                         int code_point);
+
+  DISALLOW_COPY_AND_ASSIGN(CharacterScoreTable);
+};
+
+}  // namespace milkcat
+
+#endif  // SRC_ML_CHARACTER_SCORE_TABLE_H_
@@ -35,9 +35,12 @@
 #include <set>
 #include <string>
 #include <vector>
+#include "common/bundle.h"
 #include "common/milkcat_config.h"
 #include "common/reimu_trie.h"
+#include "ml/character_score_table.h"
 #include "utils/utils.h"
+#include "utils/mapped_file.h"
 #include "utils/readable_file.h"
 #include "utils/writable_file.h"
 
@@ -46,6 +49,8 @@ namespace milkcat {
 CRFModel::CRFModel(): xindex_(NULL),
                       unigram_cost_(NULL),
                       bigram_cost_(0),
+                      character_table_(NULL),
+                      aligned_ysize_(0),
                       bigram_xsize_(0), 
                       unigram_xsize_(0) {
 }
@@ -59,12 +64,116 @@ CRFModel::~CRFModel() {
 
   delete bigram_cost_;
   bigram_cost_ = NULL;
+
+  delete character_table_;
+  character_table_ = NULL;
 }
 
 int CRFModel::xid(const char *xname) const {
   return xindex_->Get(xname, -1);
 }
 
+bool CRFModel::TraverseX(int *node, const char *key, int *xid) const {
+  return xindex_->Traverse(node, key, xid, -1);
+}
+
+void CRFModel::BuildCharacterTable() {
+  delete character_table_;
+  character_table_ = CharacterScoreTable::New(this);
+}
+
+bool CRFModel::CompileTemplate(const char *template_str,
+                               Template *compiled) const {
+  // The template is like "u3:%x[-1,0]/%x[0,0]"
+  compiled->prefix.clear();
+  compiled->fields.clear();
+  std::string *literal = &compiled->prefix;
+  const char *p = template_str;
+  while (*p) {
+    if (p[0] != '%') {
+      literal->push_back(*p++);
+      continue;
+    }
+
+    int row, column, length = 0;
+    if (sscanf(p, "%%x[%d,%d]%n", &row, &column, &length) != 2 ||
+        length == 0 ||
+        row < -kMaxContextSize ||
+        row > kMaxContextSize ||
+        column < 0) {
+      return false;
+    }
+    p += length;
+
+    Template::Field field;
+    field.row = row;
+    field.column = column;
+    compiled->fields.push_back(field);
+    literal = &compiled->fields.back().suffix;
+  }
+
+  int xid;
+  compiled->prefix_node = 0;
+  if (!TraverseX(&compiled->prefix_node, compiled->prefix.c_str(), &xid)) {
+    compiled->prefix_node = kNoNode;
+  }
+  return true;
+}
+
+void CRFModel::CompileTemplates(Status *status) {
+  int unigram_number = static_cast<int>(unigram_tmpl_.size());
+  unigram_templates_.resize(unigram_number);
+  for (int i = 0; status->ok() && i < unigram_number; ++i) {
+    if (!CompileTemplate(unigram_tmpl_[i].c_str(), &unigram_templates_[i])) {
+      *status = Status::Corruption(unigram_tmpl_[i].c_str());
+    }
+  }
+  int bigram_number = static_cast<int>(bigram_tmpl_.size());
+  bigram_templates_.resize(bigram_number);
+  for (int i = 0; status->ok() && i < bigram_number; ++i) {
+    if (!CompileTemplate(bigram_tmpl_[i].c_str(), &bigram_templates_[i])) {
+      *status = Status::Corruption(bigram_tmpl_[i].c_str());
+    }
+  }
+}
+
+void CRFModel::BuildRightBigramCost(Status *status) {
+  int ysize = this->ysize();
+  if (bigram_cost_->size() != bigram_xsize_ * ysize * ysize) {
+    *status = Status::Corruption("bad bigram cost size of CRF model");
+    return;
+  }
+
+  aligned_ysize_ = (ysize + kRowAlignment - 1) / kRowAlignment *
+                   kRowAlignment;
+  right_bigram_cost_.assign(bigram_xsize_ * ysize * aligned_ysize_, 0.0f);
+  for (int xid = 0; xid < bigram_xsize_; ++xid) {
+    for (int left_yid = 0; left_yid < ysize; ++left_yid) {
+      for (int right_yid = 0; right_yid < ysize; ++right_yid) {
+        int idx = (xid * ysize + right_yid) * aligned_ysize_ + left_yid;
+        right_bigram_cost_[idx] = bigram_cost(xid, left_yid, right_yid);
+      }
+    }
+  }
+
+  // Templates without fields like "b" have the same feature at every
+  // position, sums their costs into `static_bigram_cost_`
+  static_bigram_cost_.assign(ysize * aligned_ysize_, 0.0f);
+  for (std::vector<Template>::const_iterator it = bigram_templates_.begin();
+       it != bigram_templates_.end();
+       ++it) {
+    int node = it->prefix_node, xid = -1;
+    if (!it->fields.empty() || node == kNoNode) continue;
+    TraverseX(&node, "", &xid);
+    if (xid < 0) continue;
+
+    for (int i = 0; i < ysize * aligned_ysize_; ++i) {
+      static_bigram_cost_[i] += right_bigram_cost_[xid * ysize *
+                                                   aligned_ysize_ + i];
+    }
+  }
+}
+
 CRFModel *CRFModel::OpenText(const char *text_filename,
                              const char *template_filename,
                              Status *status) {
@@ -167,6 +276,8 @@ CRFModel *CRFModel::OpenText(const char *text_filename,
   delete fd;
   fd = NULL;
 
+  if (status->ok()) self->CompileTemplates(status);
+  if (status->ok()) self->BuildRightBigramCost(status);
   if (status->ok()) {
     return self;
   } else {
@@ -233,7 +344,9 @@ void CRFModel::Save(const char *model_prefix, Status *status) {
   delete fd;
 }
 
-CRFModel *CRFModel::New(const char *model_prefix, Status *status) {
+CRFModel *CRFModel::New(const char *model_prefix,
+                        Status *status,
+                        const Bundle *bundle) {
   std::string prefix = model_prefix;
   std::string xindex_filename = prefix + ".x.idx";
   std::string bigram_cost_filename = prefix + ".cost.bi";
@@ -242,21 +355,23 @@ CRFModel *CRFModel::New(const char *model_prefix, Status *status) {
 
   CRFModel *self = new CRFModel();
 
-  self->xindex_ = ReimuTrie::Open(xindex_filename.c_str());
+  self->xindex_ = ReimuTrie::Open(xindex_filename.c_str(),
+                                 MappedFile::kDefaultModelFlags,
+                                 bundle);
   if (self->xindex_ == NULL) *status = Status::IOError(xindex_filename.c_str());
 
   if (status->ok()) {
-    self->unigram_cost_ = StaticArray<float>::New(
-        unigram_cost_filename.c_str(), status);
+    self->unigram_cost_ = StaticArray<float>::Mmap(
+        unigram_cost_filename.c_str(), status, bundle);
   }
   if (status->ok()) {
-    self->bigram_cost_ = StaticArray<float>::New(
-        bigram_cost_filename.c_str(), status);
+    self->bigram_cost_ = StaticArray<float>::Mmap(
+        bigram_cost_filename.c_str(), status, bundle);
   }
 
   ReadableFile *fd = NULL;
   if (status->ok()) {
-    fd = ReadableFile::New(meta_filename.c_str(), status);
+    fd = Bundle::OpenFile(bundle, meta_filename.c_str(), status);
   }
   int32_t magic_number;
   if (status->ok()) {
@@ -293,6 +408,8 @@ CRFModel *CRFModel::New(const char *model_prefix, Status *status) {
     }
   }
 
+  if (status->ok()) self->CompileTemplates(status);
+  if (status->ok()) self->BuildRightBigramCost(status);
   if (status->ok()) {
     return self;
   } else {
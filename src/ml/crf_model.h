@@ -40,13 +40,44 @@
 
 namespace milkcat {
 
+class Bundle;
+class CharacterScoreTable;
 class ReimuTrie;
 template<class T> class StaticArray;
 
 class CRFModel {
  public:
-  // Open a CRF++ model file
-  static CRFModel *New(const char *model_path, Status *status);
+  // A feature template compiled at load time. The feature string is `prefix`
+  // followed by the observation at (position + row, column) and `suffix` of
+  // each field. `prefix_node` is the node in the feature index after
+  // `prefix`, or kNoNode if no feature starts with `prefix`. A bigram template
+  // without fields is static, its costs are in static_bigram_costs()
+  struct Template {
+    struct Field {
+      int row;
+      int column;
+      std::string suffix;
+    };
+
+    std::string prefix;
+    int prefix_node;
+    std::vector<Field> fields;
+  };
+
+  static const int kNoNode = -1;
+
+  // The max distance between a position and the observations in its features
+  static const int kMaxContextSize = 5;
+
+  // The rows of scores indexed by left tag are padded to a multiple of it, so
+  // they could be processed by SIMD instructions without a scalar tail
+  static const int kRowAlignment = 8;
+
+  // Open a CRF++ model file. If `bundle` is not NULL, opens it from the
+  // sections of `bundle` instead
+  static CRFModel *New(const char *model_path,
+                       Status *status,
+                       const Bundle *bundle = NULL);
   static CRFModel *OpenText(const char *text_filename,
                             const char *template_filename,
                             Status *status);
@@ -82,6 +113,28 @@ class CRFModel {
   int unigram_template_num() const { return unigram_tmpl_.size(); }
   int bigram_template_num() const { return bigram_tmpl_.size(); }
 
+  // Compiled templates
+  const Template &compiled_unigram_template(int index) const {
+    return unigram_templates_[index];
+  }
+  const Template &compiled_bigram_template(int index) const {
+    return bigram_templates_[index];
+  }
+
+  // Walks the feature index from `*node` through `key` and sets `*node` to
+  // the node reached. Sets `xid` to the id of the feature ends at this node
+  // or -1. Returns false if the path does not exist
+  bool TraverseX(int *node, const char *key, int *xid) const;
+
+  // Builds the CharacterScoreTable of this model. It is used by CRFTagger to
+  // get the unigram costs of single characters without the feature index
+  void BuildCharacterTable();
+
+  // Gets the CharacterScoreTable, NULL if it is not built
+  const CharacterScoreTable *character_table() const {
+    return character_table_;
+  }
+
   // Get the number of tag
   int ysize() const { return y_.size(); }
 
@@ -96,17 +149,50 @@ class CRFModel {
     return bigram_cost_->get(idx);
   }
 
+  // Number of tags rounded up to kRowAlignment
+  int aligned_ysize() const { return aligned_ysize_; }
+
+  // Gets the bigram costs of feature `xid` from every left tag to
+  // `right_yid`. The row has aligned_ysize() costs and the padding is 0
+  const float *right_bigram_costs(int xid, int right_yid) const {
+    return &right_bigram_cost_[(xid * ysize() + right_yid) * aligned_ysize_];
+  }
+
+  // Like right_bigram_costs, but gets the sum of the costs of all static
+  // bigram templates, which are the same at every position
+  const float *static_bigram_costs(int right_yid) const {
+    return &static_bigram_cost_[right_yid * aligned_ysize_];
+  }
+
  private:
   std::vector<std::string> y_;
   std::vector<std::string> unigram_tmpl_;
   std::vector<std::string> bigram_tmpl_;
+  std::vector<Template> unigram_templates_;
+  std::vector<Template> bigram_templates_;
   ReimuTrie *xindex_;
   StaticArray<float> *unigram_cost_;
   StaticArray<float> *bigram_cost_;
+  CharacterScoreTable *character_table_;
+  std::vector<float> right_bigram_cost_;
+  std::vector<float> static_bigram_cost_;
+  int aligned_ysize_;
   int bigram_xsize_;
   int unigram_xsize_;
   
   CRFModel();
+
+  // Compiles the template strings into unigram_templates_ and
+  // bigram_templates_
+  void CompileTemplates(Status *status);
+
+  // Compiles `template_str` into `compiled`, returns false if it is invalid
+  bool CompileTemplate(const char *template_str, Template *compiled) const;
+
+  // Copies the bigram costs into `right_bigram_cost_`, where the costs to the
+  // same right tag are contiguous, and folds the static bigram templates into
+  // `static_bigram_cost_`
+  void BuildRightBigramCost(Status *status);
 };
 
 }  // namespace milkcat
@@ -37,39 +37,99 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <limits.h>
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include <algorithm>
+#include <limits>
 #include <string>
+#include "ml/character_score_table.h"
 #include "utils/utils.h"
 
 namespace milkcat {
 
-struct CRFTagger::Node {
-  double cost;
-  int left_tag_id;
+const char *BOS[CRFModel::kMaxContextSize] = {
+  "_x+1", "_x-2", "_x-3", "_x-4", "_x-#"
 };
+const char *EOS[CRFModel::kMaxContextSize] = {
+  "_x-1", "_x+2", "_x+3", "_x+4", "_x+#"
+};
+
+namespace {
 
-const size_t kMaxContextSize = 5;
-const char *BOS[kMaxContextSize] = {"_x+1", "_x-2", "_x-3", "_x-4", "_x-#"};
-const char *EOS[kMaxContextSize] = {"_x-1", "_x+2", "_x+3", "_x+4", "_x+#"};
+const float kMinusInfinity = -std::numeric_limits<float>::infinity();
+
+// Sets `sum` to `a` + `b`. `size` is a multiple of CRFModel::kRowAlignment
+inline void AddRow(const float *a, const float *b, float *sum, int size) {
+#if defined(__AVX__)
+  for (int i = 0; i < size; i += 8) {
+    __m256 v = _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+    _mm256_storeu_ps(sum + i, v);
+  }
+#elif defined(__SSE2__)
+  for (int i = 0; i < size; i += 4) {
+    __m128 v = _mm_add_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+    _mm_storeu_ps(sum + i, v);
+  }
+#else
+  for (int i = 0; i < size; ++i) sum[i] = a[i] + b[i];
+#endif
+}
 
-CRFTagger::CRFTagger(const CRFModel *model): model_(model) {
-  for (int i = 0; i < kSequenceMax; ++i) {
-    decode_lattice_[i] = new Node[model_->ysize()];
+// Gets the index of the max value in `row`, the first one if there are
+// several. `size` is a multiple of CRFModel::kRowAlignment
+inline int ArgMaxRow(const float *row, int size) {
+  float best;
+#if defined(__AVX__)
+  __m256 max8 = _mm256_loadu_ps(row);
+  for (int i = 8; i < size; i += 8) {
+    max8 = _mm256_max_ps(max8, _mm256_loadu_ps(row + i));
+  }
+  __m128 max4 = _mm_max_ps(_mm256_castps256_ps128(max8),
+                           _mm256_extractf128_ps(max8, 1));
+#elif defined(__SSE2__)
+  __m128 max4 = _mm_loadu_ps(row);
+  for (int i = 4; i < size; i += 4) {
+    max4 = _mm_max_ps(max4, _mm_loadu_ps(row + i));
+  }
+#endif
+#if defined(__AVX__) || defined(__SSE2__)
+  max4 = _mm_max_ps(max4, _mm_movehl_ps(max4, max4));
+  max4 = _mm_max_ss(max4, _mm_shuffle_ps(max4, max4, 1));
+  best = _mm_cvtss_f32(max4);
+#else
+  best = row[0];
+  for (int i = 1; i < size; ++i) {
+    if (row[i] > best) best = row[i];
   }
+#endif
 
+  int index = 0;
+  while (row[index] != best) ++index;
+  return index;
+}
+
+}  // namespace
+
+CRFTagger::CRFTagger(const CRFModel *model): model_(model),
+                                              unigram_cache_enabled_(false) {
   transition_table_ = new TransitionTable(model);
   transition_table_->AllowAll();
 
   lattice_ = new Lattice(model);
-  for (int idx = 0; idx < kSequenceMax; ++idx) lattice_->AllowAll(idx);
+
+  left_costs_.resize(model->aligned_ysize());
+  arc_costs_.resize(model->aligned_ysize());
 }
 
 CRFTagger::~CRFTagger() {
-  for (int i = 0; i < kSequenceMax; ++i) {
-    delete[] decode_lattice_[i];
-  }
-
   delete transition_table_;
   transition_table_ = NULL;
+
+  delete lattice_;
+  lattice_ = NULL;
 }
 
 void CRFTagger::TagRange(SequenceFeatureSet *sequence_feature_set,
@@ -79,33 +139,132 @@ void CRFTagger::TagRange(SequenceFeatureSet *sequence_feature_set,
                          int end_tag) {
   sequence_feature_set_ = sequence_feature_set;
 
+  // The position `end` is used by the end tag
+  if (static_cast<int>(result_.size()) < end - begin + 1) {
+    result_.resize(end - begin + 1);
+  }
+  lattice_->Reserve(end + 1);
+
   Viterbi(begin, end, begin_tag, end_tag);
   StoreResult(begin, end, end_tag);
 }
 
 void CRFTagger::Viterbi(int begin, int end, int begin_tag, int end_tag) {
   assert(begin >= 0 && begin < end && end <= sequence_feature_set_->size());
+  begin_ = begin;
+  bucket_offset_ = begin;
+  const CharacterScoreTable *table = model_->character_table();
+  if (table != NULL) GetCharacterIds(table, begin, end);
+  ReserveBucket(begin);
   ClearBucket(begin);
   if (begin_tag != -1) CalcBeginTagBigramCost(begin, begin_tag);
   CalcUnigramCost(begin);
 
   for (int position = begin + 1; position < end; ++position) {
-    // ClearBucket(position);
+    // Stores the prefix which all paths agree to keep `decode_lattice_` in
+    // about kDecodeWindow positions. If the paths still disagree after
+    // kDecodeWindowMax positions, the best path so far is stored instead
+    int window_size = position - bucket_offset_;
+    if (window_size >= kDecodeWindow && window_size % kDecodeWindow == 0) {
+      StoreConvergedResult(position - 1, window_size >= kDecodeWindowMax);
+    }
+
+    ReserveBucket(position);
     CalcBigramCost(position);
     CalcUnigramCost(position);
   }
 
-  if (end_tag != -1) CalcBigramCost(end);
+  if (end_tag != -1) {
+    ReserveBucket(end);
+    CalcBigramCost(end);
+  }
+}
+
+void CRFTagger::ReleaseBuffers(int size) {
+  int ysize = model_->ysize();
+  ReleaseVector(&decode_lattice_, size * ysize);
+  ReleaseVector(&result_, size);
+  ReleaseVector(&character_ids_, size + 2 * CRFModel::kMaxContextSize);
+  ReleaseVector(&unigram_costs_, size * ysize);
+  ReleaseVector(&unigram_cached_, size);
+  lattice_->Release(size);
+}
+
+void CRFTagger::ReserveBucket(int position) {
+  size_t size = (position - bucket_offset_ + 1) * model_->ysize();
+  if (decode_lattice_.size() < size) decode_lattice_.resize(size);
+}
+
+void CRFTagger::StoreConvergedResult(int position, bool force) {
+  int ysize = model_->ysize();
+
+  // Traces all the paths to `position` back until they reach the same tag.
+  // The bucket at `position` is kept since the next position uses it
+  path_tags_.clear();
+  int y_num = lattice_->y_num(position);
+  for (int y_idx = 0; y_idx < y_num; ++y_idx) {
+    path_tags_.push_back(lattice_->at(position, y_idx));
+  }
+
+  // Keeps only the best tag at `position`, so its path is the only one left.
+  // It may not be on the best path of the whole sequence, the result is
+  // approximate
+  if (force) {
+    Node *current_bucket = bucket(position);
+    int best_yid = path_tags_[0];
+    for (size_t i = 1; i < path_tags_.size(); ++i) {
+      if (current_bucket[path_tags_[i]].cost > current_bucket[best_yid].cost) {
+        best_yid = path_tags_[i];
+      }
+    }
+    for (size_t i = 0; i < path_tags_.size(); ++i) {
+      if (path_tags_[i] != best_yid) {
+        current_bucket[path_tags_[i]].cost = kMinusInfinity;
+      }
+    }
+    path_tags_.assign(1, best_yid);
+  }
+  tag_visited_.resize(ysize);
+  int converged_position = position;
+  while ((path_tags_.size() > 1 || converged_position == position) &&
+         converged_position > bucket_offset_) {
+    std::fill(tag_visited_.begin(), tag_visited_.end(), false);
+    const Node *current_bucket = bucket(converged_position);
+    int path_num = 0;
+    for (size_t i = 0; i < path_tags_.size(); ++i) {
+      int left_yid = current_bucket[path_tags_[i]].left_tag_id;
+      if (tag_visited_[left_yid] == false) {
+        tag_visited_[left_yid] = true;
+        path_tags_[path_num++] = left_yid;
+      }
+    }
+    path_tags_.resize(path_num);
+    --converged_position;
+  }
+  if (path_tags_.size() != 1 || converged_position == bucket_offset_) return;
+
+  // The result before `converged_position` is fixed, stores it and removes
+  // their buckets
+  int yid = path_tags_[0];
+  for (int i = converged_position; i >= bucket_offset_; --i) {
+    result_[i - begin_] = yid;
+    yid = bucket(i)[yid].left_tag_id;
+  }
+  int offset = converged_position + 1;
+  std::copy(decode_lattice_.begin() + (offset - bucket_offset_) * ysize,
+            decode_lattice_.begin() + (position - bucket_offset_ + 1) * ysize,
+            decode_lattice_.begin());
+  bucket_offset_ = offset;
 }
 
 void CRFTagger::StoreResult(int begin, int end, int end_tag) {
   int best_yid = 0;
-  double best_cost = -1e37;
-  const Node *last_bucket = decode_lattice_[end - 1];
+  float best_cost = kMinusInfinity;
+  const Node *last_bucket = bucket(end - 1);
 
   if (end_tag != -1) {
     // Have the end tag ... so find the best result from left tag of `end_tag`
-    best_yid = decode_lattice_[end][end_tag].left_tag_id;
+    best_yid = bucket(end)[end_tag].left_tag_id;
   } else {
     int y_num = lattice_->y_num(end - 1);
     for (int y_idx = 0; y_idx < y_num; ++y_idx) {
@@ -117,31 +276,133 @@ void CRFTagger::StoreResult(int begin, int end, int end_tag) {
     }
   }
 
-  for (int position = end - 1; position >= begin; --position) {
+  // The results before `bucket_offset_` are already stored
+  for (int position = end - 1; position >= bucket_offset_; --position) {
     result_[position - begin] = best_yid;
-    best_yid = decode_lattice_[position][best_yid].left_tag_id;
+    best_yid = bucket(position)[best_yid].left_tag_id;
   }
 }
 
 void CRFTagger::ClearBucket(int position) {
-  memset(decode_lattice_[position], 0, sizeof(Node) * model_->ysize());
+  memset(bucket(position), 0, sizeof(Node) * model_->ysize());
+}
+
+void CRFTagger::GetCharacterIds(const CharacterScoreTable *table,
+                                int begin,
+                                int end) {
+  character_ids_.clear();
+  for (int position = begin - CRFModel::kMaxContextSize;
+       position < end + CRFModel::kMaxContextSize;
+       ++position) {
+    // BOS and EOS are not in the table
+    if (position < 0 || position >= sequence_feature_set_->size()) {
+      character_ids_.push_back(CharacterScoreTable::kNotCharacter);
+    } else {
+      FeatureSet *feature_set = sequence_feature_set_->at_index(position);
+      character_ids_.push_back(table->CharacterId(feature_set->at(0)));
+    }
+  }
+}
+
+void CRFTagger::CalcCharacterUnigramCost(const CharacterScoreTable *table,
+                                         int idx) {
+  Node *current_bucket = bucket(idx);
+  int y_num = lattice_->y_num(idx);
+  for (int i = 0; i < model_->unigram_template_num(); ++i) {
+    const CRFModel::Template &tmpl = model_->compiled_unigram_template(i);
+    int character_id = CharacterScoreTable::kNotCharacter;
+    if (table->has_template(i)) {
+      int offset = idx - begin_ + CRFModel::kMaxContextSize;
+      character_id = character_ids_[offset + tmpl.fields[0].row];
+    }
+
+    if (character_id != CharacterScoreTable::kNotCharacter) {
+      const float *scores = table->scores(i, character_id);
+      for (int y_idx = 0; y_idx < y_num; ++y_idx) {
+        int yid = lattice_->at(idx, y_idx);
+        current_bucket[yid].cost += scores[yid];
+      }
+    } else {
+      // Not a single character, gets its feature from the index
+      int feature_id = FeatureAt(tmpl, idx);
+      if (feature_id == -1) continue;
+      for (int y_idx = 0; y_idx < y_num; ++y_idx) {
+        int yid = lattice_->at(idx, y_idx);
+        current_bucket[yid].cost += model_->unigram_cost(feature_id, yid);
+      }
+    }
+  }
+}
+
+const float *CRFTagger::CachedUnigramCosts(int idx) {
+  int ysize = model_->ysize();
+  if (static_cast<int>(unigram_cached_.size()) <= idx) {
+    unigram_cached_.resize(idx + 1, false);
+    if (static_cast<int>(unigram_costs_.size()) < (idx + 1) * ysize) {
+      unigram_costs_.resize((idx + 1) * ysize);
+    }
+  }
+  float *costs = &unigram_costs_[idx * ysize];
+  if (unigram_cached_[idx]) return costs;
+
+  std::fill(costs, costs + ysize, 0.0f);
+  const CharacterScoreTable *table = model_->character_table();
+  for (int i = 0; i < model_->unigram_template_num(); ++i) {
+    const CRFModel::Template &tmpl = model_->compiled_unigram_template(i);
+    int character_id = CharacterScoreTable::kNotCharacter;
+    if (table != NULL && table->has_template(i)) {
+      int offset = idx - begin_ + CRFModel::kMaxContextSize;
+      character_id = character_ids_[offset + tmpl.fields[0].row];
+    }
+
+    if (character_id != CharacterScoreTable::kNotCharacter) {
+      const float *scores = table->scores(i, character_id);
+      for (int yid = 0; yid < ysize; ++yid) costs[yid] += scores[yid];
+    } else {
+      int feature_id = FeatureAt(tmpl, idx);
+      if (feature_id == -1) continue;
+      for (int yid = 0; yid < ysize; ++yid) {
+        costs[yid] += model_->unigram_cost(feature_id, yid);
+      }
+    }
+  }
+
+  unigram_cached_[idx] = true;
+  return costs;
 }
 
 void CRFTagger::CalcUnigramCost(int idx) {
+  if (unigram_cache_enabled_) {
+    const float *costs = CachedUnigramCosts(idx);
+    Node *current_bucket = bucket(idx);
+    int y_num = lattice_->y_num(idx);
+    for (int y_idx = 0; y_idx < y_num; ++y_idx) {
+      int yid = lattice_->at(idx, y_idx);
+      current_bucket[yid].cost += costs[yid];
+    }
+    return;
+  }
+
+  const CharacterScoreTable *table = model_->character_table();
+  if (table != NULL) {
+    CalcCharacterUnigramCost(table, idx);
+    return;
+  }
+
   int feature_ids[kMaxFeature],
       feature_id;
   int feature_num = UnigramFeatureAt(idx, feature_ids);
-  double cost;
+  float cost;
 
   int y_num = lattice_->y_num(idx);
   for (int y_idx = 0; y_idx < y_num; ++y_idx) {
     int yid = lattice_->at(idx, y_idx);
-    cost = decode_lattice_[idx][yid].cost;
+    cost = bucket(idx)[yid].cost;
     for (int i = 0; i < feature_num; ++i) {
       feature_id = feature_ids[i];
       cost += model_->unigram_cost(feature_id, yid);
     }
-    decode_lattice_[idx][yid].cost = cost;
+    bucket(idx)[yid].cost = cost;
     // printf("Bucket Cost: %d %s %lf\n", idx,
     // model_->GetTagText(yid), cost);
   }
@@ -151,194 +412,190 @@ void CRFTagger::CalcBeginTagBigramCost(int begin, int begin_tag) {
   int feature_ids[kMaxFeature],
       feature_id;
   int feature_num = BigramFeatureAt(begin, feature_ids);
-  double cost;
+  float cost;
 
   int y_num = lattice_->y_num(begin);
   for (int y_idx = 0; y_idx < y_num; ++y_idx) {
     int yid = lattice_->at(begin, y_idx);
-    cost = 0;
+    cost = model_->static_bigram_costs(yid)[begin_tag];
     for (int i = 0; i < feature_num; ++i) {
       feature_id = feature_ids[i];
       cost += model_->bigram_cost(feature_id, begin_tag, yid);
     }
-    decode_lattice_[begin][yid].cost = cost;
+    bucket(begin)[yid].cost = cost;
   }
 }
 
 void CRFTagger::CalcBigramCost(int idx) {
-  int feature_ids[kMaxFeature],
-      feature_id;
+  int feature_ids[kMaxFeature];
   int feature_num = BigramFeatureAt(idx, feature_ids);
-  double cost, best_cost;
-  int best_tag_id = 0;
+  int aligned_ysize = model_->aligned_ysize();
 
-  int y_num = lattice_->y_num(idx);
+  // Gathers the costs at `idx - 1` into a row, the states not in lattice
+  // are -inf
+  float *left_costs = &left_costs_[0];
+  std::fill(left_costs_.begin(), left_costs_.end(), kMinusInfinity);
+  const Node *left_bucket = bucket(idx - 1);
   int left_y_num = lattice_->y_num(idx - 1);
+  float left_best_cost = kMinusInfinity;
+  for (int left_y_idx = 0; left_y_idx < left_y_num; ++left_y_idx) {
+    int left_yid = lattice_->at(idx - 1, left_y_idx);
+    left_costs[left_yid] = left_bucket[left_yid].cost;
+    left_best_cost = std::max(left_best_cost, left_costs[left_yid]);
+  }
+
+  // The costs are relative to the best cost at `idx - 1`, so they do not
+  // grow with the length of sequence and lose the precision of float
+  if (left_best_cost == kMinusInfinity) left_best_cost = 0.0f;
+
+  // For each state, the best left tag is the max of the left costs plus the
+  // transition costs and the bigram costs of the features at `idx` to it
+  float *arc_costs = &arc_costs_[0];
+  Node *current_bucket = bucket(idx);
+  const int *left_yids = lattice_->states(idx - 1);
+  int y_num = lattice_->y_num(idx);
   for (int y_idx = 0; y_idx < y_num; ++y_idx) {
     int yid = lattice_->at(idx, y_idx);
-    best_cost = -1e37;
-    for (int left_y_idx = 0; left_y_idx < left_y_num; ++left_y_idx) {
-      int left_yid = lattice_->at(idx - 1, left_y_idx);
-      // Ignore the bigram when it is not allowed in `transition_table_`
-      if (transition_table_->transition(left_yid, yid) == false)
-        continue;
-
-      cost = decode_lattice_[idx - 1][left_yid].cost;
+
+    // The arcs are the intersection of the predecessors of `yid` and the
+    // states at `idx - 1`. Walks the smaller one if it has no more than one
+    // tag per kRowAlignment tags, otherwise computes the whole row with SIMD
+    const int *candidates = transition_table_->predecessors(yid);
+    int candidate_num = transition_table_->predecessor_num(yid);
+    if (left_y_num < candidate_num) {
+      candidates = left_yids;
+      candidate_num = left_y_num;
+    }
+
+    int best_tag_id;
+    float best_cost;
+    if (candidate_num * CRFModel::kRowAlignment <= aligned_ysize) {
+      best_tag_id = BestCandidate(yid,
+                                  candidates,
+                                  candidate_num,
+                                  feature_ids,
+                                  feature_num,
+                                  &best_cost);
+    } else {
+      AddRow(left_costs,
+             transition_table_->costs(yid),
+             arc_costs,
+             aligned_ysize);
       for (int i = 0; i < feature_num; ++i) {
-        feature_id = feature_ids[i];
-        cost += model_->bigram_cost(feature_id, left_yid, yid);
-        // printf("Arc Cost: %s %s %lf\n", model_->GetTagText(left_yid),
-        // model_->GetTagText(yid),
-        // model_->GetBigramCost(feature_id, left_yid, yid));
-      }
-      if (cost > best_cost) {
-        best_tag_id = left_yid;
-        best_cost = cost;
+        AddRow(arc_costs,
+               model_->right_bigram_costs(feature_ids[i], yid),
+               arc_costs,
+               aligned_ysize);
       }
+      best_tag_id = ArgMaxRow(arc_costs, aligned_ysize);
+      best_cost = arc_costs[best_tag_id];
     }
-    decode_lattice_[idx][yid].cost = best_cost;
-    decode_lattice_[idx][yid].left_tag_id = best_tag_id;
-    // printf("Arc Cost: %d %s %s %lf\n", idx, model_->GetTagText(yid),
-    // model_->GetTagText(best_tag_id), best_cost);
+
+    current_bucket[yid].cost = best_cost - left_best_cost;
+    current_bucket[yid].left_tag_id = best_tag_id;
   }
 }
 
-int CRFTagger::UnigramFeatureAt(int position, int *feature_ids) {
-  const char *template_str;
-  int count = 0,
-      feature_id;
-  std::string feature_str;
-  bool result;
+int CRFTagger::BestCandidate(int yid,
+                             const int *candidates,
+                             int candidate_num,
+                             const int *feature_ids,
+                             int feature_num,
+                             float *best_cost) {
+  // The same order of additions as the rows in CalcBigramCost. Ties are
+  // broken by the smaller tag like ArgMaxRow, since `candidates` may be in
+  // any order
+  const float *transition_costs = transition_table_->costs(yid);
+  const float *feature_costs[kMaxFeature];
+  for (int j = 0; j < feature_num; ++j) {
+    feature_costs[j] = model_->right_bigram_costs(feature_ids[j], yid);
+  }
 
-  for (int i = 0; i < model_->unigram_template_num(); ++i) {
-    template_str = model_->unigram_template(i);
-    result = ApplyRule(&feature_str, template_str, position);
-    assert(result);
-    feature_id = model_->xid(feature_str.c_str());
-    if (feature_id != -1) {
-      // printf("%s %d\n", feature_str.c_str(), feature_id);
-      feature_ids[count++] = feature_id;
+  int best_tag_id = 0;
+  *best_cost = kMinusInfinity;
+  for (int i = 0; i < candidate_num; ++i) {
+    int left_yid = candidates[i];
+    float cost = left_costs_[left_yid] + transition_costs[left_yid];
+    for (int j = 0; j < feature_num; ++j) {
+      cost += feature_costs[j][left_yid];
+    }
+    if (cost > *best_cost ||
+        (cost == *best_cost && left_yid < best_tag_id)) {
+      best_tag_id = left_yid;
+      *best_cost = cost;
     }
   }
 
+  return best_tag_id;
+}
+
+int CRFTagger::UnigramFeatureAt(int position, int *feature_ids) {
+  int count = 0;
+  for (int i = 0; i < model_->unigram_template_num(); ++i) {
+    int feature_id = FeatureAt(model_->compiled_unigram_template(i),
+                               position);
+    if (feature_id != -1) feature_ids[count++] = feature_id;
+  }
+
   return count;
 }
 
 int CRFTagger::BigramFeatureAt(int position, int *feature_ids) {
-  const char *template_str;
-  int count = 0,
-      feature_id;
-  std::string feature_str;
-  bool result;
-
+  int count = 0;
   for (int i = 0; i < model_->bigram_template_num(); ++i) {
-    template_str = model_->bigram_template(i);
-    result = ApplyRule(&feature_str, template_str, position);
-    assert(result);
-    feature_id = model_->xid(feature_str.c_str());
-    if (feature_id != -1) {
-      feature_ids[count++] = feature_id;
-    }
+    const CRFModel::Template &tmpl = model_->compiled_bigram_template(i);
+
+    // The static templates are already in the transition costs
+    if (tmpl.fields.empty()) continue;
+
+    int feature_id = FeatureAt(tmpl, position);
+    if (feature_id != -1) feature_ids[count++] = feature_id;
   }
 
   return count;
 }
 
-const char *CRFTagger::GetIndex(const char **pp, int position) {
-  const char *&p = *pp;
-  if (*p++ !='[') {
-    return 0;
+inline const char *CRFTagger::ObservationAt(int position, int column) {
+  if (position < 0) {
+    return BOS[-position - 1];
   }
-
-  int col = 0;
-  int row = 0;
-
-  int neg = 1;
-  if (*p++ == '-') {
-    neg = -1;
-  } else {
-    --p;
-  }
-
-  for (; *p; ++p) {
-    switch (*p) {
-      case '0': case '1': case '2': case '3': case '4':
-      case '5': case '6': case '7': case '8': case '9':
-        row = 10 * row +(*p - '0');
-        break;
-      case ',':
-        ++p;
-        goto NEXT1;
-      default: return  0;
-    }
+  if (position >= sequence_feature_set_->size()) {
+    return EOS[position - sequence_feature_set_->size()];
   }
 
-NEXT1:
-  for (; *p; ++p) {
-    switch (*p) {
-      case '0': case '1': case '2': case '3': case '4':
-      case '5': case '6': case '7': case '8': case '9':
-        col = 10 * col + (*p - '0');
-        break;
-      case ']': goto NEXT2;
-      default: return 0;
-    }
-  }
+  return sequence_feature_set_->at_index(position)->at(column);
+}
 
-NEXT2:
-  row *= neg;
-
-  if (row < -static_cast<int>(kMaxContextSize) ||
-      row > static_cast<int>(kMaxContextSize) ||
-      col < 0) {
-    return 0;
-  }
-
-  const int idx = position + row;
-  if (idx < 0) {
-    return BOS[-idx-1];
-  }
-  if (idx >= static_cast<int>(sequence_feature_set_->size())) {
-    return EOS[idx - sequence_feature_set_->size()];
-  }
-
-  return sequence_feature_set_->at_index(idx)->at(col);
-}
-
-bool CRFTagger::ApplyRule(std::string *output_str,
-                          const char *template_str,
-                          size_t position) {
-  const char *p = template_str,
-             *index_str;
-  output_str->clear();
-  for (; *p; p++) {
-    switch (*p) {
-      default:
-        output_str->push_back(*p);
-        break;
-      case '%':
-        switch (*++p) {
-          case 'x':
-            ++p;
-            index_str = GetIndex(&p, position);
-            if (!index_str) {
-              return false;
-            }
-            output_str->append(index_str);
-            break;
-          default:
-            return false;
-        }
-        break;
-    }
+int CRFTagger::FeatureAt(const CRFModel::Template &tmpl, int position) {
+  // Resumes the walk in the feature index from the node after the prefix
+  int node = tmpl.prefix_node;
+  if (node == CRFModel::kNoNode) return -1;
+
+  int xid = -1;
+  bool path_exists = true;
+  for (std::vector<CRFModel::Template::Field>::const_iterator
+       it = tmpl.fields.begin();
+       path_exists && it != tmpl.fields.end();
+       ++it) {
+    const char *observation = ObservationAt(position + it->row, it->column);
+    path_exists = model_->TraverseX(&node, observation, &xid) &&
+                  model_->TraverseX(&node, it->suffix.c_str(), &xid);
   }
-  return true;
+  if (tmpl.fields.empty()) model_->TraverseX(&node, "", &xid);
+
+  return path_exists? xid: -1;
 }
 
 CRFTagger::TransitionTable::TransitionTable(const CRFModel *model):
     model_(model) {
   ysize_ = model->ysize();
+  aligned_ysize_ = model->aligned_ysize();
   transition_ = new bool[ysize_ * ysize_];
+
+  // The padding of costs is always -inf
+  costs_.assign(ysize_ * aligned_ysize_, kMinusInfinity);
+  predecessors_.resize(ysize_ * ysize_);
+  predecessor_num_.resize(ysize_);
   AllowAll();
 }
 CRFTagger::TransitionTable::~TransitionTable() {
@@ -349,10 +606,24 @@ CRFTagger::TransitionTable::~TransitionTable() {
 void CRFTagger::TransitionTable::Allow(int left, int right) {
   assert(left < ysize_ && right < ysize_);
   transition_[left * ysize_ + right] = true;
+  costs_[right * aligned_ysize_ + left] =
+      model_->static_bigram_costs(right)[left];
+  UpdatePredecessors(right);
 }
 void CRFTagger::TransitionTable::Disallow(int left, int right) {
   assert(left < ysize_ && right < ysize_);
   transition_[left * ysize_ + right] = false;
+  costs_[right * aligned_ysize_ + left] = kMinusInfinity;
+  UpdatePredecessors(right);
+}
+
+void CRFTagger::TransitionTable::UpdatePredecessors(int right) {
+  int *predecessors = &predecessors_[right * ysize_];
+  int num = 0;
+  for (int left = 0; left < ysize_; ++left) {
+    if (transition(left, right)) predecessors[num++] = left;
+  }
+  predecessor_num_[right] = num;
 }
 
 void CRFTagger::TransitionTable::AllowAll() {
@@ -372,33 +643,44 @@ void CRFTagger::TransitionTable::DisallowAll() {
 
 CRFTagger::Lattice::Lattice(const CRFModel *model) {
   ysize_ = model->ysize();
-  for (int idx = 0; idx < kSequenceMax; ++idx) {
-    lattice_[idx] = new int[ysize_];
-    top_[idx] = 0;
-  }
 }
 
 CRFTagger::Lattice::~Lattice() {
-  for (int idx = 0; idx < kSequenceMax; ++idx) {
-    delete lattice_[idx];
-    lattice_[idx] = NULL;
-  }
+}
+
+void CRFTagger::Lattice::Reserve(int size) {
+  int old_size = static_cast<int>(top_.size());
+  if (size <= old_size) return;
+  if (size < 2 * old_size) size = 2 * old_size;
+
+  lattice_.resize(size * ysize_);
+  top_.resize(size);
+  for (int idx = old_size; idx < size; ++idx) AllowAll(idx);
+}
+
+void CRFTagger::Lattice::Release(int size) {
+  if (size >= static_cast<int>(top_.size())) return;
+  ReleaseVector(&lattice_, size * ysize_);
+  ReleaseVector(&top_, size);
 }
 
 void CRFTagger::Lattice::Add(int idx, int y) {
-  assert(idx < kSequenceMax && top_[idx] < ysize_);
+  if (idx >= static_cast<int>(top_.size())) Reserve(idx + 1);
+  assert(top_[idx] < ysize_);
   int top = top_[idx];
-  lattice_[idx][top] = y;
+  lattice_[idx * ysize_ + top] = y;
   top_[idx]++;
 }
 
 void CRFTagger::Lattice::Clear(int idx) {
+  if (idx >= static_cast<int>(top_.size())) Reserve(idx + 1);
   top_[idx] = 0;
 }
 
 void CRFTagger::Lattice::AllowAll(int idx) {
+  if (idx >= static_cast<int>(top_.size())) Reserve(idx + 1);
   for (int i = 0; i < ysize_; ++i) {
-    lattice_[idx][i] = i;
+    lattice_[idx * ysize_ + i] = i;
   }
   top_[idx] = ysize_;
 }
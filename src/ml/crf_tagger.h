@@ -35,12 +35,14 @@
 #define SRC_PARSER_CRF_TAGGER_H_
 
 #include <string>
+#include <vector>
 #include "common/milkcat_config.h"
 #include "ml/crf_model.h"
 #include "ml/sequence_feature_set.h"
 
 namespace milkcat {
 
+class CharacterScoreTable;
 class SequenceFeatureSet;
 
 class CRFTagger {
@@ -92,20 +94,74 @@ class CRFTagger {
 
   const CRFModel *model() const { return model_; } 
 
+  // Keeps the unigram costs of each position of the sequence between the
+  // calls of TagRange, so the ranges of a sequence tagged one by one compute
+  // them only once. The features of the sequence should not change until
+  // ClearUnigramCache is called
+  void EnableUnigramCache() { unigram_cache_enabled_ = true; }
+  void ClearUnigramCache() { unigram_cached_.clear(); }
+
+  // Frees the buffers grown by a sequence longer than `size` positions down
+  // to `size` positions, including the lattice and the unigram cache. It
+  // should be called between sequences, so the buffers of a long sequence
+  // are not kept forever
+  void ReleaseBuffers(int size);
+
   // Gets `transition_table_` or `lattice_`
   TransitionTable *transition_table() { return transition_table_; }
   Lattice *lattice() { return lattice_; }
 
  private:
-  struct Node;
+  struct Node {
+    float cost;
+    int left_tag_id;
+  };
 
   const CRFModel *model_;
-  Node *decode_lattice_[kSequenceMax];
-  int result_[kSequenceMax];
+
+  // Buffers of the Viterbi kernel, each has aligned_ysize() costs
+  std::vector<float> left_costs_;
+  std::vector<float> arc_costs_;
+
+  // The nodes of each position from `bucket_offset_` are stored one after
+  // another, ysize nodes for each position. The positions before
+  // `bucket_offset_` are removed once all paths agree on their result, or
+  // the best path is forced after kDecodeWindowMax positions, so it keeps at
+  // most kDecodeWindowMax positions for a long sequence
+  std::vector<Node> decode_lattice_;
+  int bucket_offset_;
+  int begin_;
+  std::vector<int> result_;
+  std::vector<int> path_tags_;
+  std::vector<bool> tag_visited_;
+
+  // The character ids in the CharacterScoreTable of model from the position
+  // `begin_ - CRFModel::kMaxContextSize`
+  std::vector<int> character_ids_;
+  // The unigram costs of every tag at each position of the sequence, ysize
+  // costs for each position. They are valid if `unigram_cached_` is true
+  bool unigram_cache_enabled_;
+  std::vector<float> unigram_costs_;
+  std::vector<bool> unigram_cached_;
+
   SequenceFeatureSet *sequence_feature_set_;
   TransitionTable *transition_table_;
   Lattice *lattice_;
 
+  // Gets the nodes at `position` in `decode_lattice_`
+  Node *bucket(int position) {
+    return &decode_lattice_[(position - bucket_offset_) * model_->ysize()];
+  }
+
+  // Makes sure `decode_lattice_` has the bucket of `position`
+  void ReserveBucket(int position);
+
+  // Stores the result before the position where all paths to the tags at
+  // `position` converge, and removes the buckets before it. If `force` is
+  // true, the paths are first cut down to the one of the best tag at
+  // `position`, so the result before `position` is always stored
+  void StoreConvergedResult(int position, bool force);
+
   // Get the xid of unigram/bigram features at `idx`, returns the number of
   // features
   int BigramFeatureAt(int idx, int *feature_ids);
@@ -114,21 +170,43 @@ class CRFTagger {
   // CLear the decode bucket
   void ClearBucket(int position);
 
+  // Gets the ids of characters around [begin, end) into `character_ids_`
+  void GetCharacterIds(const CharacterScoreTable *table, int begin, int end);
+
+  // Gets the unigram costs of every tag at `idx` from the cache, computes
+  // them if they are not cached
+  const float *CachedUnigramCosts(int idx);
+
   // Calculate the unigram/bigram costs
   void CalcUnigramCost(int idx);
+  void CalcCharacterUnigramCost(const CharacterScoreTable *table, int idx);
   void CalcBigramCost(int idx);
   void CalcBeginTagBigramCost(int begin, int begin_tag);
 
+  // Gets the best left tag of `yid` at `idx` from `candidates`, which are
+  // left tags in any order, and sets `best_cost` to the cost of its arc.
+  // Returns 0 if no arc from `candidates` is allowed. `left_costs_` should
+  // have the costs at `idx - 1`
+  int BestCandidate(int yid,
+                    const int *candidates,
+                    int candidate_num,
+                    const int *feature_ids,
+                    int feature_num,
+                    float *best_cost);
+
   // Viterbi algorithm
   void Viterbi(int begin, int end, int begin_tag, int end_tag);
 
   // Get the best tag sequence from lattice and stores it into `lattice_`
   void StoreResult(int begin, int end, int end_tag);
 
-  const char *GetIndex(const char **pp, int position);
-  bool ApplyRule(std::string *output_str,
-                 const char *template_str,
-                 size_t position);
+  // Gets the observation at `column` of `position`. The positions out of
+  // the sequence have BOS or EOS observations
+  const char *ObservationAt(int position, int column);
+
+  // Gets the xid of the feature from `tmpl` at `position`, returns -1 if it
+  // does not exist
+  int FeatureAt(const CRFModel::Template &tmpl, int position);
 };
 
 // TransitionTable stores the allowed transitions
@@ -150,13 +228,35 @@ class CRFTagger::TransitionTable {
     return transition_[ysize_ * left + right];
   }
 
+  // Gets the costs of transitions from every left tag to `right`. It has
+  // model->aligned_ysize() values, the static bigram cost if the transition
+  // is allowed or -inf if not
+  const float *costs(int right) const {
+    return &costs_[right * aligned_ysize_];
+  }
+
+  // Gets the left tags allowed to transit to `right` in ascending order, and
+  // the number of them
+  const int *predecessors(int right) const {
+    return &predecessors_[right * ysize_];
+  }
+  int predecessor_num(int right) const { return predecessor_num_[right]; }
+
  private:
   bool *transition_;
+  std::vector<float> costs_;
+  std::vector<int> predecessors_;
+  std::vector<int> predecessor_num_;
   int ysize_;
+  int aligned_ysize_;
   const CRFModel *model_;
+
+  // Rebuilds the predecessor list of `right` from `transition_`
+  void UpdatePredecessors(int right);
 };
 
-// Lattice stores the allowed state for each observation
+// Lattice stores the allowed state for each observation. It grows on demand
+// and all states are allowed at the new positions
 class CRFTagger::Lattice {
  public:
   Lattice(const CRFModel *model);
@@ -171,15 +271,25 @@ class CRFTagger::Lattice {
   // Allows all states at `idx`
   void AllowAll(int idx);
 
+  // Grows the lattice to at least `size` positions
+  void Reserve(int size);
+
+  // Removes the positions from `size` and frees their memory if the lattice
+  // has more. They are all states allowed again once reserved
+  void Release(int size);
+
   // Number os states at `idx`
   int y_num(int idx) const { return top_[idx]; }
 
   // Gets the states at
-  int at(int idx, int num) const { return lattice_[idx][num]; }
+  int at(int idx, int num) const { return lattice_[idx * ysize_ + num]; }
+
+  // Gets all states at `idx`, there are y_num(idx) of them
+  const int *states(int idx) const { return &lattice_[idx * ysize_]; }
 
  private:
-  int *lattice_[kSequenceMax];
-  int top_[kSequenceMax];
+  std::vector<int> lattice_;
+  std::vector<int> top_;
   int ysize_;
 };
 
@@ -25,17 +25,19 @@
 //
 
 #include "ml/feature_set.h"
-#include "utils/utils.h"
+
+#include <string.h>
 
 namespace milkcat {
 
-FeatureSet::FeatureSet(): top_(0) {
+FeatureSet::FeatureSet() {
 }
 
 void FeatureSet::Add(const char *feature_string) {
-  ASSERT(top_ < kFeatureNumberMax, "Too many features");
-  strlcpy(feature_string_[top_], feature_string, kFeatureSizeMax);
-  top_++;
+  offsets_.push_back(string_pool_.size());
+  string_pool_.insert(string_pool_.end(),
+                      feature_string,
+                      feature_string + strlen(feature_string) + 1);
 }
 
 }  // namespace milkcat
\ No newline at end of file
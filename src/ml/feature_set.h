@@ -28,6 +28,7 @@
 #define SRC_COMMON_FEATURE_EXTRACTOR_H_
 
 #include <assert.h>
+#include <vector>
 
 namespace milkcat {
 
@@ -38,7 +39,6 @@ class FeatureSet {
   FeatureSet();
 
   enum {
-    kFeatureNumberMax = 100,
     kFeatureSizeMax = 128
   };
 
@@ -46,20 +46,26 @@ class FeatureSet {
   void Add(const char *feature_string);
 
   // Remove all features
-  void Clear() { top_ = 0; }
+  void Clear() {
+    offsets_.clear();
+    string_pool_.clear();
+  }
 
-  // Gets the feature string at `index`
-  char *at(int index) const {
-    return const_cast<char *>(feature_string_[index]); 
+  // Gets the feature string at `index`. It is valid until the next Add or
+  // Clear
+  const char *at(int index) const {
+    assert(index < size());
+    return &string_pool_[offsets_[index]];
   }
 
   // Gets number of features in the set
-  int size() const { return top_; }
-  void set_size(int size) { top_ = size; }
+  int size() const { return static_cast<int>(offsets_.size()); }
 
  private:
-  char feature_string_[kFeatureNumberMax][kFeatureSizeMax];
-  int top_;
+  // The features are stored one after another in `string_pool_`, which
+  // keeps its capacity after Clear
+  std::vector<char> string_pool_;
+  std::vector<int> offsets_;
 };
 
 }  // namespace milkcat
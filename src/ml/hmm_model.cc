@@ -31,17 +31,21 @@
 #include <string.h>
 #include <map>
 #include <string>
+#include "common/bundle.h"
 #include "common/milkcat_config.h"
 #include "common/reimu_trie.h"
+#include "utils/mapped_file.h"
 #include "utils/readable_file.h"
 #include "utils/utils.h"
 #include "utils/writable_file.h"
 
 namespace milkcat {
 
-HMMModel *HMMModel::New(const char *model_filename, Status *status) {
+HMMModel *HMMModel::New(const char *model_filename,
+                        Status *status,
+                        const Bundle *bundle) {
   HMMModel *self = NULL;
-  ReadableFile *fd = ReadableFile::New(model_filename, status);
+  ReadableFile *fd = Bundle::OpenFile(bundle, model_filename, status);
 
   // Reads magic number
   int32_t magic_number = 0;
@@ -86,7 +90,9 @@ HMMModel *HMMModel::New(const char *model_filename, Status *status) {
   std::string index_filename = std::string(model_filename) + ".x.idx";
   if (status->ok()) {
     delete self->index_;
-    self->index_ = ReimuTrie::Open(index_filename.c_str());
+    self->index_ = ReimuTrie::Open(index_filename.c_str(),
+                                   MappedFile::kDefaultModelFlags,
+                                   bundle);
     if (self->index_ == NULL) {
       *status = Status::IOError(index_filename.c_str());
     }
@@ -33,6 +33,7 @@
 
 namespace milkcat {
 
+class Bundle;
 class Status;
 class ReimuTrie;
 class ReadableFile;
@@ -48,7 +49,11 @@ class HMMModel {
   HMMModel(const std::vector<std::string> &yname);
   ~HMMModel();
 
-  static HMMModel *New(const char *model_path, Status *status);
+  // Loads the model from `model_path`. If `bundle` is not NULL, loads it from
+  // the sections of `bundle` instead
+  static HMMModel *New(const char *model_path,
+                       Status *status,
+                       const Bundle *bundle = NULL);
 
   // Save the model to file specified by model_path
   void Save(const char *model_path, Status *status);
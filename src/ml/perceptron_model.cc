@@ -34,6 +34,7 @@
 #include <algorithm>
 #include <map>
 #include <set>
+#include "common/bundle.h"
 #include "common/milkcat_config.h"
 #include "common/reimu_trie.h"
 #include "ml/packed_score.h"
@@ -109,14 +110,16 @@ PerceptronModel::OpenText(const char *filename, Status *status) {
 }
 
 PerceptronModel *
-PerceptronModel::Open(const char *filename_prefix, Status *status) {
+PerceptronModel::Open(const char *filename_prefix,
+                      Status *status,
+                      const Bundle *bundle) {
   std::string prefix = filename_prefix;
   std::string metafile = prefix + ".meta";
   std::string xindex_file = prefix + ".x.idx";
   std::string cost_file = prefix + ".cost.data";
 
   // The metadata file
-  ReadableFile *fd = ReadableFile::New(metafile.c_str(), status);
+  ReadableFile *fd = Bundle::OpenFile(bundle, metafile.c_str(), status);
   PerceptronModel *self = NULL;
 
   if (status->ok()) {
@@ -153,7 +156,7 @@ PerceptronModel::Open(const char *filename_prefix, Status *status) {
   if (status->ok()) {
     // Use new xindex instead
     delete self->xindex_;
-    self->xindex_ = ReimuTrie::Open(xindex_file.c_str());
+    self->xindex_ = ReimuTrie::Open(xindex_file.c_str(), 0, bundle);
     if (self->xindex_ == NULL) *status = Status::IOError(xindex_file.c_str());
   }
 
@@ -164,7 +167,7 @@ PerceptronModel::Open(const char *filename_prefix, Status *status) {
   }
 
   // Cost data file
-  if (status->ok()) fd = ReadableFile::New(cost_file.c_str(), status);
+  if (status->ok()) fd = Bundle::OpenFile(bundle, cost_file.c_str(), status);
   if (status->ok()) {
     for (int i = 0; status->ok() && i < xsize; ++i) {
       PackedScore<float> *score = PackedScore<float>::Read(fd, status);
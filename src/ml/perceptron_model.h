@@ -34,6 +34,7 @@
 
 namespace milkcat {
 
+class Bundle;
 class Status;
 class ReimuTrie;
 template<class T> class PackedScore;
@@ -43,7 +44,9 @@ class PerceptronModel {
  public:
   // Loads the multiclass perceptron model data from `filename`.
   static PerceptronModel *OpenText(const char *filename, Status *status);
-  static PerceptronModel *Open(const char *filename, Status *status);
+  static PerceptronModel *Open(const char *filename,
+                               Status *status,
+                               const Bundle *bundle = NULL);
 
   // Creates a new `PerceptronModel` with specified labels (y)
   PerceptronModel(const std::vector<std::string> &y);
@@ -28,12 +28,12 @@
 #define SRC_ML_SEQUENCE_FEATURE_SET_H_
 
 #include <assert.h>
-#include "common/milkcat_config.h"
+#include <vector>
 #include "ml/feature_set.h"
 
 namespace milkcat {
 
-// A sequence of FeatureSet
+// A sequence of FeatureSet. It grows to the longest sequence ever set
 class SequenceFeatureSet {
  public:
   SequenceFeatureSet(): size_(0) {
@@ -47,14 +47,14 @@ class SequenceFeatureSet {
 
   // Sets/Gets the size of current SequenceFeatureSet
   void set_size(int size) {
-    assert(size_ < kTokenMax);
+    if (size > static_cast<int>(sequence_.size())) sequence_.resize(size);
     size_ = size;
   }
   int size() const { return size_; }
 
 
  private:
-  FeatureSet sequence_[kTokenMax];
+  std::vector<FeatureSet> sequence_;
   int size_;
 };
 
@@ -31,6 +31,7 @@
 
 #include <stdio.h>
 #include <map>
+#include "common/bundle.h"
 #include "common/reimu_trie.h"
 #include "common/trie_tree.h"
 #include "ml/feature_set.h"
@@ -59,11 +60,13 @@ DependencyParser::FeatureTemplate::FeatureTemplate(
 }
 
 DependencyParser::FeatureTemplate *
-DependencyParser::FeatureTemplate::Open(const char *filename, Status *status) {
+DependencyParser::FeatureTemplate::Open(const char *filename,
+                                        Status *status,
+                                        const Bundle *bundle) {
   // Read template file
   char line[1024];
   std::vector<std::string> template_vector;
-  ReadableFile *fd = ReadableFile::New(filename, status);
+  ReadableFile *fd = Bundle::OpenFile(bundle, filename, status);
 
   while (status->ok() && !fd->Eof()) {
     fd->ReadLine(line, sizeof(line), status);
@@ -134,14 +137,15 @@ int DependencyParser::FeatureTemplate::Extract(
   strlcpy(single_feature_[kN0RCt], N0RCt(), kFeatureStringMax);
 
   feature_set->Clear();
+  char feature[FeatureSet::kFeatureSizeMax];
   bool ignore = false;
   for (std::vector<std::string>::const_iterator 
        it = feature_template_.begin();
        it != feature_template_.end();
        ++it) {
     ignore = false;
-    StringBuilder builder(feature_set->at(feature_num),
-                          FeatureSet::kFeatureSizeMax);
+    feature[0] = '\0';
+    StringBuilder builder(feature, sizeof(feature));
     const char *templ = it->c_str();
     const char *p = templ, *q = NULL;
     while (*p) {
@@ -162,9 +166,11 @@ int DependencyParser::FeatureTemplate::Extract(
         p = q + 1;
       }
     }
-    if (ignore == false) feature_num++;
+    if (ignore == false) {
+      feature_set->Add(feature);
+      feature_num++;
+    }
   }
-  feature_set->set_size(feature_num);
 
   return feature_num;
 }
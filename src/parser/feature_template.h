@@ -36,6 +36,7 @@ namespace milkcat {
 class TermInstance;
 class PartOfSpeechTagInstance;
 class TrieTree;
+class Bundle;
 class FeatureSet;
 class Status;
 class ReimuTrie;
@@ -65,8 +66,11 @@ class DependencyParser::FeatureTemplate {
     kSingleFeatureNumber
   };
 
-  // Get feature template from `filename`. On failed, return NULL
-  static FeatureTemplate *Open(const char *filename, Status *status);
+  // Get feature template from `filename`, or from the section `filename` of
+  // `bundle` if it is not NULL. On failed, return NULL
+  static FeatureTemplate *Open(const char *filename,
+                               Status *status,
+                               const Bundle *bundle = NULL);
 
   FeatureTemplate(const std::vector<std::string> &feature_template);
   ~FeatureTemplate();
@@ -40,8 +40,7 @@ template<class T> class Pool;
 class DependencyParser::State {
  public:
   enum {
-    kMaxStackSize = 128,
-    kMaxInputSize = 1024
+    kMaxStackSize = 128
   };
 
   State();
@@ -107,7 +106,7 @@ class DependencyParser::State {
   std::vector<int> stack_;
   std::vector<int> input_;
   
-  Node *sentence_[kMaxInputSize];
+  std::vector<Node *> sentence_;
   int sentence_length_;
 
   double weight_;
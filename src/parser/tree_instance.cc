@@ -31,7 +31,7 @@
 namespace milkcat {
 
 TreeInstance::TreeInstance() {
-  instance_data_ = new InstanceData(1, 1, kTokenMax);
+  instance_data_ = new InstanceData(1, 1);
 }
 
 TreeInstance::~TreeInstance() {
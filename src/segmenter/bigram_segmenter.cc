@@ -27,15 +27,19 @@
 
 #include "segmenter/bigram_segmenter.h"
 
+#include <assert.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 #include <algorithm>
 #include <vector>
 #include <string>
 #include "libmilkcat.h"
+#include "common/bigram_table.h"
 #include "common/milkcat_config.h"
 #include "common/model_impl.h"
 #include "common/trie_tree.h"
+#include "common/user_dictionary.h"
 #include "include/milkcat.h"
 #include "segmenter/term_instance.h"
 #include "tokenizer/token_instance.h"
@@ -43,57 +47,35 @@
 
 namespace milkcat {
 
-struct BigramSegmenter::Node {
-  int beam_id;            // The bucket contains this node
-  int term_id;            // term_id for this node
-  double cost;            // Cost in this path  
-  const Node *from_node;  // Previous node pointer
-  int term_position;      // Position in a term_instance
-
-  inline void 
-  set_value(int beam_id, int term_id, double cost, const Node *from_node) {
-    this->beam_id = beam_id;
-    this->term_id = term_id;
-    this->cost = cost;
-    this->from_node = from_node;
-
-    if (from_node) {
-      this->term_position = from_node->term_position + 1;
-    } else {
-      this->term_position = -1;
-    }
-  }
-};
+namespace {
 
 // Compare two Node in cost
-class BigramSegmenter::NodeComparator {
- public:
-  bool operator()(BigramSegmenter::Node *n1, BigramSegmenter::Node *n2) {
-    return n1->cost < n2->cost;
-  }
-};
+bool NodeCostLess(const BigramSegmenter::Node &n1,
+                  const BigramSegmenter::Node &n2) {
+  return n1.cost < n2.cost;
+}
+
+}  // namespace
 
 BigramSegmenter::BigramSegmenter(): beam_size_(0),
-                                    node_pool_(NULL),
+                                    bucket_capacity_(0),
+                                    bucket_offset_(0),
+                                    root_position_(0),
+                                    edge_begin_(0),
                                     unigram_cost_(NULL),
-                                    user_cost_(NULL),
                                     bigram_cost_(NULL),
                                     index_(NULL),
-                                    user_index_(NULL),
-                                    has_user_index_(false),
+                                    combined_index_(NULL),
+                                    model_impl_(NULL),
+                                    user_dictionary_(NULL),
+                                    user_dictionary_version_(0),
+                                    has_user_dictionary_(false),
                                     use_disabled_term_ids_(false) {
 }
 
 BigramSegmenter::~BigramSegmenter() {
-  delete node_pool_;
-  node_pool_ = NULL;
-
-  for (int i = 0;
-       i < sizeof(beams_) / sizeof(Beam<Node, NodeComparator> *);
-       ++i) {
-    delete beams_[i];
-    beams_[i] = NULL;
-  }
+  if (user_dictionary_ != NULL) user_dictionary_->Release();
+  user_dictionary_ = NULL;
 }
 
 BigramSegmenter *BigramSegmenter::New(Model::Impl *model_factory,
@@ -102,21 +84,11 @@ BigramSegmenter *BigramSegmenter::New(Model::Impl *model_factory,
   BigramSegmenter *self = new BigramSegmenter();
 
   self->beam_size_ = use_bigram? kDefaultBeamSize: 1;
-  self->node_pool_ = new Pool<Node>();
-
-  // Initialize the beams_
-  for (int i = 0;
-       i < sizeof(self->beams_) / sizeof(Beam<Node, NodeComparator> *);
-       ++i) {
-    self->beams_[i] = new Beam<Node, NodeComparator>(self->beam_size_);
-  }
+  self->bucket_capacity_ = self->beam_size_ * 10;
 
+  self->model_impl_ = model_factory;
   self->index_ = model_factory->Index(status);
-  if (status->ok() && model_factory->HasUserDictionary()) {
-    self->has_user_index_ = true;
-    self->user_index_ = model_factory->UserIndex(status);
-    if (status->ok()) self->user_cost_ = model_factory->UserCost(status);
-  }
+  if (status->ok()) self->UpdateUserDictionary();
 
   if (status->ok()) self->unigram_cost_ = model_factory->UnigramCost(status);
   if (status->ok() && use_bigram == true) 
@@ -133,41 +105,73 @@ BigramSegmenter *BigramSegmenter::New(Model::Impl *model_factory,
   }
 }
 
+inline int BigramSegmenter::GetSystemTermIdAndUnigramCost(int value,
+                                                          bool *system_word,
+                                                          double *right_cost) {
+  int term_id;
+  if (combined_index_ != NULL) {
+    const UserDictionary::CombinedEntry &entry =
+        user_dictionary_->combined_entry(value);
+    *system_word = (entry.flags & UserDictionary::kSystemWord) != 0;
+    term_id = *system_word?
+        entry.term_id:
+        user_dictionary_->combined_term_id(entry.term_id);
+    *right_cost = entry.cost;
+    LOG("Combined unigram find ", term_id, " ", *right_cost);
+  } else {
+    term_id = value;
+    *system_word = true;
+    *right_cost = unigram_cost_->get(term_id);
+    LOG("System unigram find ", term_id, " ", *right_cost);
+  }
+
+  return term_id;
+}
+
 // Traverse the system and user index to find the term_id at current position,
 // then get the unigram cost for the term-id. Return the term-id and stores the
-// cost in double &unigram_cost
+// cost in double &unigram_cost. If the user dictionary is combined with the
+// system dictionary, `system_node` is the state in the combined index and only
+// the layers not combined are traversed with `user_nodes`
 // NOTE: If the word in current position exists both in system dictionary and
 // user dictionary, returns the term-id in system dictionary and stores the cost
 // of user dictionary into unigram_cost if its value is not kDefaultCost
 inline int BigramSegmenter::GetTermIdAndUnigramCost(
     const char *token_str,
+    int token_length,
     bool *system_flag,
     bool *user_flag,
     size_t *system_node,
-    size_t *user_node,
+    size_t *user_nodes,
     double *right_cost) {
 
   int term_id = TrieTree::kNone,
       uterm_id = TrieTree::kNone;
+  bool system_word = false;
 
   if (*system_flag) {
-    term_id = index_->Traverse(token_str, system_node);
-    if (term_id == TrieTree::kNone) *system_flag = false;
-    if (term_id >= 0) {
-      *right_cost = unigram_cost_->get(term_id);
-      LOG("System unigram find ", term_id, " ", *right_cost);
+    const DoubleArrayTrieTree *index = combined_index_ != NULL?
+        combined_index_:
+        index_;
+    int value = index->Traverse(token_str, token_length, system_node);
+    if (value == TrieTree::kNone) *system_flag = false;
+    if (value >= 0) {
+      term_id = GetSystemTermIdAndUnigramCost(value, &system_word, right_cost);
     }
   }
 
   if (*user_flag) {
-    uterm_id = user_index_->Traverse(token_str, user_node);
+    float cost;
+    uterm_id = user_dictionary_->Traverse(token_str,
+                                          token_length,
+                                          user_nodes,
+                                          &cost);
     if (uterm_id == TrieTree::kNone) *user_flag = false;
 
     if (uterm_id >= 0) {
-      double cost = user_cost_->get(uterm_id - kUserTermIdStart);
       LOG("User unigram find ", uterm_id, " ", cost);
 
-      if (term_id < 0) {
+      if (!system_word) {
         *right_cost = cost;
 
         // Use term id in user dictionary iff term-id in system dictionary not
@@ -177,6 +181,15 @@ inline int BigramSegmenter::GetTermIdAndUnigramCost(
         // If word exists in system dictionary only when the cost in user
         // dictionary not equals kDefaultCost, stores the cost to right_cost
         *right_cost = cost;
+      } else {
+        *right_cost = unigram_cost_->get(term_id);
+      }
+    } else if (uterm_id == UserDictionary::kRemoved && term_id >= 0) {
+      // The word in combined index is removed from user dictionary
+      if (system_word) {
+        *right_cost = unigram_cost_->get(term_id);
+      } else {
+        term_id = TrieTree::kExist;
       }
     }
   }
@@ -192,23 +205,19 @@ inline int BigramSegmenter::GetTermIdAndUnigramCost(
 }
 
 // Calculates the cost form left word-id to right term-id in bigram model. The
-// cost equals -log(p(right_word|left_word)). If no bigram data exists, use
-// unigram model cost = -log(p(right_word))
+// cost equals -log(p(right_word|left_word)). If no bigram data exists
+// (`bigram_cost` is BigramTable::kNoCost), use unigram model cost =
+// -log(p(right_word))
 inline double BigramSegmenter::CalculateBigramCost(int left_id,
-                                                   int right_id,
+                                                   float bigram_cost,
                                                    double left_cost,
                                                    double right_cost) {
   double cost;
 
-  // If bigram is disabled
-  if (bigram_cost_ == NULL) return left_cost + right_cost;
-
-  int64_t key = (static_cast<int64_t>(left_id) << 32) + right_id;
-  const float *it = bigram_cost_->Find(key);
-  if (it != NULL) {
+  if (bigram_cost != BigramTable::kNoCost) {
     // if have bigram data use p(x_n+1|x_n) = p(x_n+1, x_n) / p(x_n)
-    cost = left_cost + (*it - unigram_cost_->get(left_id));
-    LOG("bigram find ", left_id, " ", right_id, " ", cost - left_cost);
+    cost = left_cost + (bigram_cost - unigram_cost_->get(left_id));
+    LOG("bigram find ", left_id, " ", cost - left_cost);
   } else {
     cost = left_cost + right_cost;
   }
@@ -216,153 +225,420 @@ inline double BigramSegmenter::CalculateBigramCost(int left_id,
   return cost;
 }
 
+// Looks up the bigram costs of all (node in the bucket at `position`, word in
+// [begin, end)) pairs at once. The cost of the pair (node i, word j) is stored
+// in bigram_costs_[j * bucket_size + i]
+void BigramSegmenter::FindBigramCosts(int position,
+                                      const Candidate *begin,
+                                      const Candidate *end) {
+  const Node *bucket = bucket_at(position);
+  int bucket_size = bucket_size_at(position);
+  int word_number = static_cast<int>(end - begin);
+
+  bigram_costs_.resize(word_number * bucket_size);
+  if (bigram_cost_ == NULL) {
+    // If bigram is disabled
+    std::fill(bigram_costs_.begin(), bigram_costs_.end(),
+              BigramTable::kNoCost);
+    return;
+  }
+
+  left_ids_.resize(bucket_size);
+  for (int node_id = 0; node_id < bucket_size; ++node_id) {
+    left_ids_[node_id] = bucket[node_id].term_id;
+  }
+  right_ids_.resize(word_number);
+  for (int word_id = 0; word_id < word_number; ++word_id) {
+    right_ids_[word_id] = begin[word_id].term_id;
+  }
+  bigram_cost_->FindPairs(left_ids_.data(),
+                          bucket_size,
+                          right_ids_.data(),
+                          word_number,
+                          bigram_costs_.data());
+}
+
+void BigramSegmenter::UpdateUserDictionary() {
+  if (model_impl_->user_dictionary_version() == user_dictionary_version_) {
+    return;
+  }
+
+  if (user_dictionary_ != NULL) user_dictionary_->Release();
+  user_dictionary_ = model_impl_->AcquireUserDictionary();
+  if (user_dictionary_ != NULL) {
+    user_dictionary_version_ = user_dictionary_->version();
+    combined_index_ = user_dictionary_->combined_index();
+    has_user_dictionary_ = user_dictionary_->has_layers();
+    user_nodes_.resize(user_dictionary_->layer_number());
+  } else {
+    user_dictionary_version_ = 0;
+    combined_index_ = NULL;
+    has_user_dictionary_ = false;
+    user_nodes_.clear();
+  }
+}
+
 int BigramSegmenter::GetTermId(const char *term_str) {
   bool system_flag = true;
-  bool user_flag = has_user_index_;
+  bool user_flag = has_user_dictionary_;
   size_t system_node = 0;
-  size_t user_node = 0;
   double cost = 0.0;
+  std::fill(user_nodes_.begin(), user_nodes_.end(), 0);
 
   return GetTermIdAndUnigramCost(term_str,
+                                 strlen(term_str),
                                  &system_flag,
                                  &user_flag,
                                  &system_node,
-                                 &user_node,
+                                 user_nodes_.data(),
                                  &cost);
 }
 
-void BigramSegmenter::BuildBeamFromPosition(TokenInstance *token_instance, 
-                                            int position) {
-  size_t index_node = 0,
-         user_node = 0;
-  bool index_flag = true, 
-       user_flag = has_user_index_;
-  double cost, right_cost;
-  const Node *node = NULL;
-  Node *new_node = NULL;
-
-  beams_[position]->Shrink();
-  const char *token_str = NULL;
-  int length_end = token_instance->size() - position;
-  for (int length = 0; length < length_end; ++length) {
-    LOG("Position: [", position, ", ", position + length + 1, ")");
-
-    // Get current term-id from system and user dictionary
-    token_str = token_instance->token_text_at(position + length);
-    int term_id = GetTermIdAndUnigramCost(token_str,
-                                          &index_flag,
-                                          &user_flag,
-                                          &index_node,
-                                          &user_node,
-                                          &right_cost);
+inline void BigramSegmenter::ReserveBuckets(int position) {
+  int bucket_number = position - bucket_offset_ + 1;
+  if (bucket_number <= static_cast<int>(bucket_sizes_.size())) return;
+  bucket_number = std::max(bucket_number,
+                           2 * static_cast<int>(bucket_sizes_.size()));
 
-    double min_cost = 1e38;
-    const Node *min_node = NULL;
-
-    assert(beams_[position]->size() > 0);
-
-    if (term_id >= 0) {
-      // This token exists in unigram data
-      for (int node_id = 0;
-           node_id < beams_[position]->size();
-           ++node_id) {
-        node = beams_[position]->at(node_id);
-        double cost = CalculateBigramCost(node->term_id,
-                                          term_id,
-                                          node->cost,
-                                          right_cost);
-        LOG("Cost: ", cost - node->cost, ", total: ", cost);
-        if (cost < min_cost) {
-          min_cost = cost;
-          min_node = node;
+  nodes_.resize(bucket_number * bucket_capacity_);
+  bucket_sizes_.resize(bucket_number, 0);
+}
+
+// Same as Beam::Shrink(), it keeps the best `beam_size_` nodes with
+// std::partial_sort so that the ties are broken in the same way
+inline void BigramSegmenter::ShrinkBucket(int position) {
+  int &bucket_size = bucket_size_at(position);
+  if (bucket_size <= beam_size_) return;
+
+  Node *bucket = bucket_at(position);
+  std::partial_sort(bucket,
+                    bucket + beam_size_,
+                    bucket + bucket_size,
+                    NodeCostLess);
+  bucket_size = beam_size_;
+}
+
+inline void BigramSegmenter::AddNode(int position,
+                                     int term_id,
+                                     double cost,
+                                     int from_position,
+                                     int from_index) {
+  int &bucket_size = bucket_size_at(position);
+  Node *node = bucket_at(position) + bucket_size;
+  node->cost = cost;
+  node->term_id = term_id;
+  node->from_position = from_position;
+  node->from_index = from_index;
+  node->term_position = bucket_at(from_position)[from_index].term_position + 1;
+
+  bucket_size++;
+  if (bucket_size >= bucket_capacity_) ShrinkBucket(position);
+}
+
+void BigramSegmenter::BuildEdges(TokenInstance *token_instance,
+                                 int begin,
+                                 int end) {
+  int token_number = token_instance->size();
+  Candidate candidate;
+  double right_cost;
+  bool system_word;
+
+  edges_.clear();
+  edge_begin_ = begin;
+  edge_offsets_.resize(end - begin + 1);
+  const DoubleArrayTrieTree *index = combined_index_ != NULL?
+      combined_index_:
+      index_;
+  for (int position = begin; position < end; ++position) {
+    edge_offsets_[position - begin] = static_cast<int>(edges_.size());
+
+    if (!has_user_dictionary_) {
+      // Finds all words start from current position in the system (or
+      // combined) dictionary in one walk
+      index->CommonPrefixSearch(&token_data_[position],
+                                &token_lengths_[position],
+                                token_number - position,
+                                &matches_);
+      for (std::vector<std::pair<int, int> >::const_iterator
+           it = matches_.begin(); it != matches_.end(); ++it) {
+        int term_id = GetSystemTermIdAndUnigramCost(it->second,
+                                                    &system_word,
+                                                    &right_cost);
+        if (use_disabled_term_ids_ == true &&
+            disabled_term_ids_.find(term_id) != disabled_term_ids_.end()) {
+          continue;
         }
+        candidate.length = it->first;
+        candidate.term_id = term_id;
+        candidate.right_cost = right_cost;
+        edges_.push_back(candidate);
       }
+      continue;
+    }
 
-      // Add the min_node to decode graph
-      new_node = node_pool_->Alloc();
-      new_node->set_value(position + length + 1, term_id, min_cost, min_node);
-      beams_[position + length + 1]->Add(new_node);
-    } else {
-      // One token out-of-vocabulary word should be always put into Decode
-      // Graph When no arc to next bucket
-      if (length == 0 && beams_[position + 1]->size() == 0) {
-        for (int node_id = 0;
-             node_id < beams_[position]->size();
-             ++node_id) {
-          node = beams_[position]->at(node_id);
-          cost = node->cost + 20;
-
-          if (cost < min_cost) {
-            min_cost = cost;
-            min_node = node;
-          }
-        }
+    // Finds all words start from current position in system and user
+    // dictionary
+    size_t index_node = 0;
+    bool index_flag = true,
+         user_flag = true;
+    std::fill(user_nodes_.begin(), user_nodes_.end(), 0);
+    int length_end = token_number - position;
+    for (int length = 0; length < length_end; ++length) {
+      // Get current term-id from system and user dictionary
+      int term_id = GetTermIdAndUnigramCost(token_data_[position + length],
+                                            token_lengths_[position + length],
+                                            &index_flag,
+                                            &user_flag,
+                                            &index_node,
+                                            user_nodes_.data(),
+                                            &right_cost);
+      if (term_id >= 0) {
+        candidate.length = length;
+        candidate.term_id = term_id;
+        candidate.right_cost = right_cost;
+        edges_.push_back(candidate);
+      }
 
-        new_node = node_pool_->Alloc();
-        new_node->set_value(position + length + 1, 0, min_cost, min_node);
-        beams_[position + 1]->Add(new_node);
-      }  // end if node count == 0
-    }  // end if term_id >= 0
+      if (index_flag == false && user_flag == false) break;
+    }  // end for length
+  }
+  edge_offsets_[end - begin] = static_cast<int>(edges_.size());
+}
+
+void BigramSegmenter::DecodePosition(int position) {
+  int edge_id = position - edge_begin_;
+  const Candidate *begin = edges_.data() + edge_offsets_[edge_id],
+                  *end = edges_.data() + edge_offsets_[edge_id + 1];
+
+  // The longest word is the last one
+  ReserveBuckets(begin == end? position + 1: position + end[-1].length + 1);
+  ShrinkBucket(position);
+  const Node *bucket = bucket_at(position);
+  int bucket_size = bucket_size_at(position);
+  assert(bucket_size > 0);
+
+  if ((begin == end || begin->length != 0) &&
+      bucket_size_at(position + 1) == 0) {
+    // One token out-of-vocabulary word should be always put into Decode
+    // Graph When no arc to next bucket
+    double min_cost = 1e38;
+    int min_index = 0;
+    for (int node_id = 0; node_id < bucket_size; ++node_id) {
+      double cost = bucket[node_id].cost + 20;
+      if (cost < min_cost) {
+        min_cost = cost;
+        min_index = node_id;
+      }
+    }
+    AddNode(position + 1, 0, min_cost, position, min_index);
+  }
 
-    if (index_flag == false && user_flag == false) break;
-  }  // end for length
+  // Adds the best arc to each word into decode graph
+  FindBigramCosts(position, begin, end);
+  const float *bigram_costs = bigram_costs_.data();
+  for (const Candidate *it = begin; it != end; ++it) {
+    LOG("Position: [", position, ", ", position + it->length + 1, ")");
+    double min_cost = 1e38;
+    int min_index = 0;
+    for (int node_id = 0; node_id < bucket_size; ++node_id) {
+      const Node &node = bucket[node_id];
+      double cost = CalculateBigramCost(node.term_id,
+                                        bigram_costs[node_id],
+                                        node.cost,
+                                        it->right_cost);
+      LOG("Cost: ", cost - node.cost, ", total: ", cost);
+      if (cost < min_cost) {
+        min_cost = cost;
+        min_index = node_id;
+      }
+    }
+    bigram_costs += bucket_size;
+
+    // Add the best arc to decode graph
+    AddNode(position + it->length + 1,
+            it->term_id,
+            min_cost,
+            position,
+            min_index);
+  }
 }
 
-void BigramSegmenter::FindTheBestResult(TermInstance *term_instance, 
+void BigramSegmenter::FindTheBestResult(TermInstance *term_instance,
                                         TokenInstance *token_instance) {
   // Find the best result from decoding graph
-  const Node *node = beams_[token_instance->size()]->Best();
+  int position = token_instance->size();
+  const Node *bucket = bucket_at(position);
+  int index = static_cast<int>(std::min_element(
+      bucket,
+      bucket + bucket_size_at(position),
+      NodeCostLess) - bucket);
+  const Node *node = bucket + index;
 
   // Set the cost data for RecentSegCost()
   cost_ = node->cost;
 
   term_instance->set_size(node->term_position + 1);
-  int beam_id, from_beam_id, term_type;
-  std::string buffer;
-  while (node->term_position >= 0) {
-    buffer.clear();
-    beam_id = node->beam_id;
-    from_beam_id = node->from_node->beam_id;
-
-    for (int i = from_beam_id; i < beam_id; ++i) {
-      buffer.append(token_instance->token_text_at(i));
-    }
+  StoreTerms(term_instance, token_instance, position, index);
+}
 
-    term_type = beam_id - from_beam_id > 1?
+void BigramSegmenter::StoreTerms(TermInstance *term_instance,
+                                 TokenInstance *token_instance,
+                                 int position,
+                                 int index) {
+  int term_type;
+  const Node *node = bucket_at(position) + index;
+  while (node->from_position >= 0) {
+    int from_position = node->from_position;
+
+    term_type = position - from_position > 1?
         Parser::kChineseWord:
-        TokenTypeToTermType(token_instance->token_type_at(from_beam_id));
+        TokenTypeToTermType(token_instance->token_type_at(from_position));
 
     int oov_id = TermInstance::kTermIdOutOfVocabulary;
-    term_instance->set_value_at(
+    term_instance->set_tokens_at(
         node->term_position,
-        buffer.c_str(),
-        beam_id - from_beam_id,
+        token_instance,
+        from_position,
+        position,
         term_type,
         node->term_id == 0? oov_id: node->term_id);
-    node = node->from_node;
+    position = from_position;
+    node = bucket_at(position) + node->from_index;
   }  // end while
 }
 
+void BigramSegmenter::StoreConvergedResult(TermInstance *term_instance,
+                                           TokenInstance *token_instance,
+                                           int position,
+                                           bool force) {
+  ShrinkBucket(position);
+
+  // Keeps only the best node at `position` and removes the words across it,
+  // so all paths pass this node. It may not be on the best path of the whole
+  // sentence, the result is approximate
+  if (force) {
+    Node *bucket = bucket_at(position);
+    *bucket = *std::min_element(bucket,
+                                bucket + bucket_size_at(position),
+                                NodeCostLess);
+    bucket_size_at(position) = 1;
+    std::fill(bucket_sizes_.begin() + (position - bucket_offset_ + 1),
+              bucket_sizes_.end(),
+              0);
+  }
+
+  // The paths from all the nodes in the buckets from `position`
+  path_nodes_.clear();
+  int bucket_number = static_cast<int>(bucket_sizes_.size());
+  for (int bucket_id = position - bucket_offset_;
+       bucket_id < bucket_number;
+       ++bucket_id) {
+    for (int i = 0; i < bucket_sizes_[bucket_id]; ++i) {
+      path_nodes_.push_back(std::make_pair(bucket_id + bucket_offset_, i));
+    }
+  }
+
+  // Traces back the nodes in the latest bucket until all paths reach the same
+  // node
+  for (; ; ) {
+    std::sort(path_nodes_.begin(), path_nodes_.end());
+    path_nodes_.erase(std::unique(path_nodes_.begin(), path_nodes_.end()),
+                      path_nodes_.end());
+    if (path_nodes_.size() <= 1) break;
+
+    int latest_position = path_nodes_.back().first;
+    for (size_t i = 0; i < path_nodes_.size(); ++i) {
+      if (path_nodes_[i].first == latest_position) {
+        const Node &node = bucket_at(latest_position)[path_nodes_[i].second];
+        path_nodes_[i] = std::make_pair(node.from_position, node.from_index);
+      }
+    }
+  }
+  int converged_position = path_nodes_[0].first;
+  Node *converged_node = bucket_at(converged_position) + path_nodes_[0].second;
+  if (converged_node->from_position < 0) return;
+
+  StoreTerms(term_instance,
+             token_instance,
+             converged_position,
+             path_nodes_[0].second);
+
+  // The converged node becomes the new root, then removes the buckets before
+  // it. All the paths from `position` pass it, so the nodes before it are no
+  // longer used
+  converged_node->from_position = -1;
+  root_position_ = converged_position;
+  int shift = converged_position - bucket_offset_;
+  if (shift == 0) return;
+  for (int bucket_id = shift; bucket_id < bucket_number; ++bucket_id) {
+    int bucket_size = bucket_sizes_[bucket_id];
+    const Node *from = &nodes_[bucket_id * bucket_capacity_];
+    std::copy(from,
+              from + bucket_size,
+              &nodes_[(bucket_id - shift) * bucket_capacity_]);
+    bucket_sizes_[bucket_id - shift] = bucket_size;
+  }
+  std::fill(bucket_sizes_.end() - shift, bucket_sizes_.end(), 0);
+  bucket_offset_ = converged_position;
+}
+
 void BigramSegmenter::Segment(TermInstance *term_instance,
                               TokenInstance *token_instance) {
-  Node *new_node = node_pool_->Alloc();
-  new_node->set_value(0, 0, 0, NULL);
+  // Sentence boundary, it's safe to switch the user dictionary here
+  UpdateUserDictionary();
+
+  int token_number = token_instance->size();
+  token_data_.resize(token_number);
+  token_lengths_.resize(token_number);
+  for (int position = 0; position < token_number; ++position) {
+    token_data_[position] = token_instance->token_data_at(position);
+    token_lengths_[position] = token_instance->token_length_at(position);
+  }
+
+  bucket_offset_ = 0;
+  root_position_ = 0;
+  ReserveBuckets(0);
+
   // Add begin-of-sentence node
-  beams_[0]->Add(new_node);
+  Node *root_node = bucket_at(0);
+  root_node->cost = 0;
+  root_node->term_id = 0;
+  root_node->from_position = -1;
+  root_node->from_index = 0;
+  root_node->term_position = -1;
+  bucket_size_at(0) = 1;
 
   // Strat decoding
-  for (int beam_id = 0; beam_id < token_instance->size(); ++beam_id) {
-    // Shrink current bucket to ensure node number < n_best
-    BuildBeamFromPosition(token_instance, beam_id);
-  }  // end for decode_start
+  for (int position = 0; position < token_number; ++position) {
+    if (position % kDecodeWindow == 0) {
+      BuildEdges(token_instance,
+                 position,
+                 std::min(position + kDecodeWindow, token_number));
+    }
+
+    // Saves the terms which all paths agree to keep the nodes and buckets in
+    // about kDecodeWindow positions. If the paths still disagree after
+    // kDecodeWindowMax positions, the best path so far is saved instead
+    int window_size = position - root_position_;
+    if (window_size > 0 && window_size % kDecodeWindow == 0) {
+      StoreConvergedResult(term_instance,
+                           token_instance,
+                           position,
+                           window_size >= kDecodeWindowMax);
+    }
+
+    DecodePosition(position);
+  }  // end for position
 
   FindTheBestResult(term_instance, token_instance);
 
-  // Clear decode_node
-  for (int i = 0; i < token_instance->size() + 1; ++i) {
-    beams_[i]->Clear();
-  }
-  node_pool_->ReleaseAll();
+  // Clear the buckets, and frees the buffers this sentence grew beyond
+  // kDecodeBufferCap positions
+  std::fill(bucket_sizes_.begin(), bucket_sizes_.end(), 0);
+  ReleaseVector(&nodes_, kDecodeBufferCap * bucket_capacity_);
+  ReleaseVector(&bucket_sizes_, kDecodeBufferCap);
+  ReleaseVector(&token_data_, kDecodeBufferCap);
+  ReleaseVector(&token_lengths_, kDecodeBufferCap);
 }
 
 }  // namespace milkcat
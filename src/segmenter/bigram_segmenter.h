@@ -30,26 +30,34 @@
 
 #include <stdint.h>
 #include <set>
+#include <utility>
+#include <vector>
 #include "common/milkcat_config.h"
 #include "common/static_array.h"
-#include "common/static_hashtable.h"
 #include "include/milkcat.h"
-#include "ml/beam.h"
 #include "segmenter/segmenter.h"
-#include "utils/pool.h"
 
 namespace milkcat {
 
-class TrieTree;
+class BigramTable;
+class DoubleArrayTrieTree;
 class TokenInstance;
 class TermInstance;
 class Model;
 class Status;
+class UserDictionary;
 
 class BigramSegmenter: public Segmenter {
  public:
-  // A node in decode graph
-  struct Node;
+  // A node in decode graph. It refers to the previous node by its bucket and
+  // its index in the bucket
+  struct Node {
+    double cost;        // Cost in this path
+    int term_id;        // term_id for this node
+    int from_position;  // Bucket of previous node, -1 for the root node
+    int from_index;     // Index of previous node in its bucket
+    int term_position;  // Position in a term_instance
+  };
 
   // Create the bigram segmenter from a model factory. On success, return an
   // instance of BigramSegmenter. On failed, return NULL and set status
@@ -60,7 +68,8 @@ class BigramSegmenter: public Segmenter {
 
   ~BigramSegmenter();
 
-  // Segment a token instance into term instance
+  // Segment a token instance into term instance. It picks up the newest user
+  // dictionary of the model before segmenting
   void Segment(TermInstance *term_instance, TokenInstance *token_instance);
 
   // Get the recent segmentation cost
@@ -84,28 +93,62 @@ class BigramSegmenter: public Segmenter {
   }
 
  private:
-  class NodeComparator;
+  // A word starts from current position of decoding
+  struct Candidate {
+    int length;
+    int term_id;
+    double right_cost;
+  };
 
   static const int kDefaultBeamSize = 3;
-  // Number of Node in each buckets_
+  // Number of Node in each buckets after pruning
   int beam_size_;
 
-  // Buckets contain nodes for viterbi decoding
-  Beam<Node, NodeComparator> *beams_[kTokenMax + 1];
-
-  // NodePool instance to alloc and release node
-  Pool<Node> *node_pool_;
+  // Buckets contain nodes for viterbi decoding. The bucket at `position` is
+  // the `bucket_capacity_` nodes from nodes_[(position - bucket_offset_) *
+  // bucket_capacity_] and bucket_sizes_[position - bucket_offset_] of them
+  // are used. A full bucket is pruned to the best `beam_size_` nodes
+  int bucket_capacity_;
+  std::vector<Node> nodes_;
+  std::vector<int> bucket_sizes_;
+  int bucket_offset_;
+
+  // The buckets before `root_position_` are removed once all paths agree on
+  // their terms
+  int root_position_;
+  std::vector<std::pair<int, int> > path_nodes_;
+
+  // Words in the dictionary start from the positions in current window of
+  // decoding. The words from `position` are edges_[edge_offsets_[position -
+  // edge_begin_], edge_offsets_[position - edge_begin_ + 1]) in the order of
+  // their lengths
+  std::vector<Candidate> edges_;
+  std::vector<int> edge_offsets_;
+  int edge_begin_;
+
+  // The tokens of current sentence and the words found by CommonPrefixSearch
+  // from a position
+  std::vector<const char *> token_data_;
+  std::vector<int> token_lengths_;
+  std::vector<std::pair<int, int> > matches_;
 
   // Costs for unigram and bigram.
   const StaticArray<float> *unigram_cost_;
-  const StaticArray<float> *user_cost_;
-  const StaticHashTable<int64_t, float> *bigram_cost_;
+  const BigramTable *bigram_cost_;
+
 
+  // Index for words in dictionary, and the index combined with the user
+  // dictionary which is used instead of it if not NULL
+  const DoubleArrayTrieTree *index_;
+  const DoubleArrayTrieTree *combined_index_;
 
-  // Index for words in dictionary
-  const TrieTree *index_;
-  const TrieTree *user_index_;
-  bool has_user_index_;
+  // The user dictionary snapshot used by this segmenter and the traversing
+  // states of its layers
+  Model::Impl *model_impl_;
+  UserDictionary *user_dictionary_;
+  int64_t user_dictionary_version_;
+  bool has_user_dictionary_;
+  std::vector<size_t> user_nodes_;
 
   // Stores the final cost of recent segmentation
   double cost_;
@@ -114,24 +157,89 @@ class BigramSegmenter: public Segmenter {
   bool use_disabled_term_ids_;
   std::set<int> disabled_term_ids_;
 
+  // Buffers for the bigram lookups of current position
+  std::vector<int> left_ids_;
+  std::vector<int> right_ids_;
+  std::vector<float> bigram_costs_;
+
   BigramSegmenter();
 
+  // Switches to the newest user dictionary of the model if it is updated
+  void UpdateUserDictionary();
+
   double CalculateBigramCost(int left_id,
-                             int right_id,
+                             float bigram_cost,
                              double left_cost,
                              double right_cost);
 
+  // Finds the bigram costs from the nodes in the bucket at `position` to the
+  // words in [begin, end) and stores them into bigram_costs_
+  void FindBigramCosts(int position,
+                       const Candidate *begin,
+                       const Candidate *end);
+
+  // Gets the term-id and its unigram cost for the word whose value is `value`
+  // in the combined index if it exists or in the system index otherwise. Sets
+  // `system_word` to whether the term-id is in system dictionary
+  int GetSystemTermIdAndUnigramCost(int value,
+                                    bool *system_word,
+                                    double *right_cost);
+
   int GetTermIdAndUnigramCost(const char *token_str,
+                              int token_length,
                               bool *system_flag,
                               bool *user_flag,
                               size_t *system_node,
-                              size_t *user_node,
+                              size_t *user_nodes,
                               double *right_cost);
 
-  // Builds the beams_ from the words starts from current position in index
-  void BuildBeamFromPosition(TokenInstance *token_instance, int position);
+  // Gets the first node and the node number of bucket at `position`
+  Node *bucket_at(int position) {
+    return &nodes_[(position - bucket_offset_) * bucket_capacity_];
+  }
+  int &bucket_size_at(int position) {
+    return bucket_sizes_[position - bucket_offset_];
+  }
 
-  // Finds the best result from beams_ and save the result to term_instance 
+  // Grows the buckets to contain the bucket at `position`. It invalidates the
+  // pointers returned by bucket_at()
+  void ReserveBuckets(int position);
+
+  // Keeps the best `beam_size_` nodes in the bucket at `position`
+  void ShrinkBucket(int position);
+
+  // Appends a node to the bucket at `position` which should be reserved
+  void AddNode(int position,
+               int term_id,
+               double cost,
+               int from_position,
+               int from_index);
+
+  // Finds all words in the dictionary start from the positions in [begin,
+  // end) of token_instance and stores them into edges_. Without user
+  // dictionary layers, the words are found by CommonPrefixSearch
+  void BuildEdges(TokenInstance *token_instance, int begin, int end);
+
+  // Adds the arcs from the bucket at `position` into decode graph
+  void DecodePosition(int position);
+
+  // Saves the terms in the path to the node `index` of bucket at `position`
+  // to term_instance
+  void StoreTerms(TermInstance *term_instance,
+                  TokenInstance *token_instance,
+                  int position,
+                  int index);
+
+  // Saves the terms until the node where all paths from `position`
+  // converge, and removes the nodes and buckets before it. If `force` is
+  // true, the paths are first cut down to the one of the best node at
+  // `position`
+  void StoreConvergedResult(TermInstance *term_instance,
+                            TokenInstance *token_instance,
+                            int position,
+                            bool force);
+
+  // Finds the best result from the buckets and save the result to term_instance 
   void FindTheBestResult(TermInstance *term_instance,
                          TokenInstance *token_instance);
 };
@@ -28,6 +28,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <algorithm>
 #include <string>
 #include "libmilkcat.h"
 #include "common/model_impl.h"
@@ -45,6 +46,7 @@ CRFSegmenter *CRFSegmenter::New(Model::Impl *model_factory, Status *status) {
   
   if (status->ok()) {
     self->crf_tagger_ = new CRFTagger(model);
+    self->crf_tagger_->EnableUnigramCache();
     self->sequence_feature_set_ = new SequenceFeatureSet();
 
     // Get the tag's value in CRF++ model
@@ -99,18 +101,16 @@ CRFSegmenter::~CRFSegmenter() {
 }
 
 CRFSegmenter::CRFSegmenter(): crf_tagger_(NULL),
-                              sequence_feature_set_(NULL) {}
+                              sequence_feature_set_(NULL),
+                              prepared_serial_(-1) {}
 
-void CRFSegmenter::SegmentRange(TermInstance *term_instance,
-                                TokenInstance *token_instance,
+void CRFSegmenter::PrepareRange(TokenInstance *token_instance,
                                 int begin,
                                 int end) {
-  std::string buffer;
-
-  // Puts the `token_instance` into `sequence_feature_set_`
   CRFTagger::Lattice *lattice = crf_tagger_->lattice();
   sequence_feature_set_->set_size(token_instance->size());
-  for (int idx = 0; idx < token_instance->size(); ++idx) {
+  for (int idx = begin; idx < end; ++idx) {
+    if (prepared_[idx]) continue;
     FeatureSet *feature_set = sequence_feature_set_->at_index(idx);
 
     // Only one feature for word segmenter
@@ -125,43 +125,59 @@ void CRFSegmenter::SegmentRange(TermInstance *term_instance,
       lattice->Clear(idx);
       lattice->Add(idx, S);
     }
+    prepared_[idx] = true;
+  }
+}
+
+void CRFSegmenter::SegmentRange(TermInstance *term_instance,
+                                TokenInstance *token_instance,
+                                int begin,
+                                int end) {
+  // The cache is from another sentence
+  if (token_instance->serial() != prepared_serial_) {
+    StartSentence();
+    prepared_serial_ = token_instance->serial();
+    prepared_.resize(token_instance->size(), false);
   }
 
+  // Only the tokens around [begin, end) are used by the features of this
+  // range
+  int context_begin = std::max(begin - CRFModel::kMaxContextSize, 0);
+  int context_end = std::min(end + CRFModel::kMaxContextSize,
+                             token_instance->size());
+  PrepareRange(token_instance, context_begin, context_end);
+
   crf_tagger_->TagRange(sequence_feature_set_, begin, end, S, S);
 
   int tag_id;
   int term_count = 0;
-  size_t i = 0;
-  int token_count = 0;
+  int term_begin = begin;
   int term_type;
-  for (i = 0; i < end - begin; ++i) {
-    token_count++;
-    buffer.append(token_instance->token_text_at(begin + i));
-
-    tag_id = crf_tagger_->y(i);
+  for (int i = begin; i < end; ++i) {
+    tag_id = crf_tagger_->y(i - begin);
     if (tag_id == S || tag_id == E) {
       if (tag_id == S) {
-        term_type = TokenTypeToTermType(
-          token_instance->token_type_at(begin + i));
+        term_type = TokenTypeToTermType(token_instance->token_type_at(i));
       } else {
         term_type = Parser::kChineseWord;
       }
 
-      term_instance->set_value_at(term_count,
-                                  buffer.c_str(),
-                                  token_count,
-                                  term_type);
+      term_instance->set_tokens_at(term_count,
+                                   token_instance,
+                                   term_begin,
+                                   i + 1,
+                                   term_type);
       term_count++;
-      token_count = 0;
-      buffer.clear();
+      term_begin = i + 1;
     }
   }
 
-  if (!buffer.empty()) {
-    term_instance->set_value_at(term_count,
-                                buffer.c_str(),
-                                token_count,
-                                Parser::kChineseWord);
+  if (term_begin < end) {
+    term_instance->set_tokens_at(term_count,
+                                 token_instance,
+                                 term_begin,
+                                 end,
+                                 Parser::kChineseWord);
     term_count++;
   }
 
@@ -27,6 +27,9 @@
 #ifndef SRC_SEGMENTER_CRF_SEGMENTER_H_
 #define SRC_SEGMENTER_CRF_SEGMENTER_H_
 
+#include <stdint.h>
+#include <vector>
+#include "common/milkcat_config.h"
 #include "include/milkcat.h"
 #include "ml/crf_tagger.h"
 #include "segmenter/segmenter.h"
@@ -43,13 +46,25 @@ class CRFSegmenter: public Segmenter {
   static CRFSegmenter *New(Model::Impl *model_factory, Status *status);
   ~CRFSegmenter();
 
-  // Segment a range [begin, end) of token
+  // Segment a range [begin, end) of token. The features and unigram costs of
+  // tokens are cached for the ranges of the same sentence, and cleared when
+  // the serial of the sentence in `token_instance` changes
   void SegmentRange(TermInstance *term_instance,
                     TokenInstance *token_instance,
                     int begin,
                     int end);
 
+  // Clears the cached features of the previous sentence, and frees the
+  // buffers it grew beyond kDecodeBufferCap positions
+  void StartSentence() {
+    prepared_.clear();
+    prepared_serial_ = -1;
+    crf_tagger_->ClearUnigramCache();
+    crf_tagger_->ReleaseBuffers(kDecodeBufferCap);
+  }
+
   void Segment(TermInstance *term_instance, TokenInstance *token_instance) {
+    StartSentence();
     SegmentRange(term_instance, token_instance, 0, token_instance->size());
   }
 
@@ -57,10 +72,20 @@ class CRFSegmenter: public Segmenter {
   CRFTagger *crf_tagger_;
   SequenceFeatureSet *sequence_feature_set_;
 
+  // Whether the feature and lattice states of each token in current sentence
+  // are in `sequence_feature_set_` and the lattice of `crf_tagger_`. The
+  // serial of the sentence is `prepared_serial_`, or -1 if none is prepared
+  std::vector<bool> prepared_;
+  int64_t prepared_serial_;
+
   int S, B, B1, B2, M, E;
 
   CRFSegmenter();
 
+  // Puts the tokens in [begin, end) which are not prepared yet into
+  // `sequence_feature_set_` and the lattice
+  void PrepareRange(TokenInstance *token_instance, int begin, int end);
+
   DISALLOW_COPY_AND_ASSIGN(CRFSegmenter);
 };
 
@@ -73,8 +73,7 @@ OutOfVocabularyWordRecognition::OutOfVocabularyWordRecognition():
 
 void OutOfVocabularyWordRecognition::GetOOVProperties(
     TermInstance *term_instance) {
-  for (int i = 0; i < term_instance->size(); ++i) 
-    oov_properties_[i] = kNoRecognize;
+  oov_properties_.assign(term_instance->size(), kNoRecognize);
 
   for (int i = 0; i < term_instance->size(); ++i) {
     int token_number = term_instance->token_number_at(i);
@@ -84,8 +83,9 @@ void OutOfVocabularyWordRecognition::GetOOVProperties(
     } else if (term_type != Parser::kChineseWord) {
       continue;
     } else {
-      const char *term_text = term_instance->term_text_at(i);
-      int oov_property = oov_property_->Search(term_text);
+      int oov_property = oov_property_->Search(
+          term_instance->term_data_at(i),
+          term_instance->term_length_at(i));
       if (oov_property < 0) {
         oov_properties_[i] = kDoRecognize;
       } else {
@@ -124,6 +124,7 @@ void OutOfVocabularyWordRecognition::Recognize(
   int oov_token_num = 0;
 
   GetOOVProperties(in_term_instance);
+  crf_segmenter_->StartSentence();
 
   for (int i = 0; i < in_term_instance->size(); ++i) {
     term_token_number = in_term_instance->token_number_at(i);
@@ -178,12 +179,9 @@ void OutOfVocabularyWordRecognition::CopyTermValue(
     TermInstance *src_term_instance,
     int src_position)  {
 
-  dest_term_instance->set_value_at(
-      dest_postion,
-      src_term_instance->term_text_at(src_position),
-      src_term_instance->token_number_at(src_position),
-      src_term_instance->term_type_at(src_position),
-      src_term_instance->term_id_at(src_position));
+  dest_term_instance->CopyTermAt(dest_postion,
+                                 src_term_instance,
+                                 src_position);
 }
 
 void OutOfVocabularyWordRecognition::RecognizeRange(
@@ -31,6 +31,7 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <vector>
 #include "include/milkcat.h"
 #include "ml/crf_model.h"
 #include "segmenter/crf_segmenter.h"
@@ -63,7 +64,7 @@ class OutOfVocabularyWordRecognition {
   TermInstance *term_instance_;
   CRFSegmenter *crf_segmenter_;
   const TrieTree *oov_property_;
-  int8_t oov_properties_[kTokenMax];
+  std::vector<int8_t> oov_properties_;
 
   OutOfVocabularyWordRecognition();
 
@@ -30,11 +30,63 @@
 namespace milkcat {
 
 TermInstance::TermInstance() {
-  instance_data_ = new InstanceData(1, 3, kTokenMax);
+  instance_data_ = new InstanceData(0, 4);
 }
 
 TermInstance::~TermInstance() {
   delete instance_data_;
 }
 
+void TermInstance::Grow(int size) {
+  if (size < 2 * static_cast<int>(data_.size())) size = 2 * data_.size();
+  data_.resize(size, NULL);
+  texts_.resize(size);
+  materialized_.resize(size, false);
+}
+
+void TermInstance::set_tokens_at(int position,
+                                 const TokenInstance *token_instance,
+                                 int begin,
+                                 int end,
+                                 int term_type,
+                                 int term_id) {
+  const char *term = token_instance->token_data_at(begin);
+  int length = 0;
+  bool adjacent = true;
+  for (int i = begin; i < end; ++i) {
+    if (token_instance->token_data_at(i) != term + length) adjacent = false;
+    length += token_instance->token_length_at(i);
+  }
+
+  if (adjacent) {
+    set_span_at(position, term, length, end - begin, term_type, term_id);
+  } else {
+    // The scanner skips the invalid bytes between tokens
+    std::string buffer;
+    for (int i = begin; i < end; ++i) {
+      buffer.append(token_instance->token_data_at(i),
+                    token_instance->token_length_at(i));
+    }
+    set_value_at(position, buffer.c_str(), end - begin, term_type, term_id);
+  }
+}
+
+void TermInstance::CopyTermAt(int position,
+                              const TermInstance *src,
+                              int src_position) {
+  const char *term = src->term_data_at(src_position);
+  int length = src->term_length_at(src_position);
+  int token_number = src->token_number_at(src_position);
+  int term_type = src->term_type_at(src_position);
+  int term_id = src->term_id_at(src_position);
+
+  if (term == src->texts_[src_position].data()) {
+    // The string is owned by `src`
+    set_value_at(position, src->term_text_at(src_position), token_number,
+                 term_type, term_id);
+  } else {
+    set_span_at(position, term, length, token_number, term_type, term_id);
+  }
+}
+
 }  // namespace milkcat
@@ -29,6 +29,9 @@
 #define SRC_SEGMENTER_TERM_INSTANCE_H_
 
 #include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
 #include "common/instance_data.h"
 #include "include/milkcat.h"
 #include "tokenizer/token_instance.h"
@@ -43,17 +46,29 @@ class TermInstance {
   TermInstance();
   ~TermInstance();
 
-  static const int kTermTextS = 0;
   static const int kTermTokenNumberI = 0;
   static const int kTermTypeI = 1;
   static const int kTermIdI = 2;
+  static const int kTermLengthI = 3;
 
   static const int kTermIdNone = -2;
   static const int kTermIdOutOfVocabulary = -1;
 
-  // Get the term's string value at position
+  // Get the term's string value at position. A term set by `set_span_at` is
+  // copied from its text when its string value is needed at the first time
   const char *term_text_at(int position) const {
-    return instance_data_->string_at(position, kTermTextS);
+    if (!materialized_[position]) {
+      texts_[position].assign(data_[position], term_length_at(position));
+      materialized_[position] = true;
+    }
+    return texts_[position].c_str();
+  }
+
+  // Get the term at position which is not terminated by NUL, its length is
+  // term_length_at(position)
+  const char *term_data_at(int position) const { return data_[position]; }
+  int term_length_at(int position) const {
+    return instance_data_->integer_at(position, kTermLengthI);
   }
 
   // Get the term type at position
@@ -82,21 +97,66 @@ class TermInstance {
   // Get the size of this instance
   int size() const { return instance_data_->size(); }
 
-  // Set the value at position
+  // Set the value at position, the string of term is copied
   void set_value_at(int position,
                     const char *term,
                     int token_number,
                     int term_type,
                     int term_id = kTermIdNone) {
-    instance_data_->set_string_at(position, kTermTextS, term);
+    if (position >= static_cast<int>(data_.size())) Grow(position + 1);
+    texts_[position] = term;
+    set_span_at(position,
+                texts_[position].data(),
+                texts_[position].size(),
+                token_number,
+                term_type,
+                term_id);
+    materialized_[position] = true;
+  }
+
+  // Set the value at position to the `length` bytes at `term`, which are
+  // usually the tokens in TokenInstance. They are not copied and should be
+  // kept until the term is no longer used
+  void set_span_at(int position,
+                   const char *term,
+                   int length,
+                   int token_number,
+                   int term_type,
+                   int term_id = kTermIdNone) {
+    if (position >= static_cast<int>(data_.size())) Grow(position + 1);
+    data_[position] = term;
+    materialized_[position] = false;
+    instance_data_->set_integer_at(position, kTermLengthI, length);
     instance_data_->set_integer_at(position, kTermTokenNumberI, token_number);
     instance_data_->set_integer_at(position, kTermTypeI, term_type);
     instance_data_->set_integer_at(position, kTermIdI, term_id);
   }
 
+  // Set the value at position to the tokens in [begin, end) of
+  // `token_instance`. Usually they are adjacent in the text and the term is a
+  // span of them, otherwise they are copied
+  void set_tokens_at(int position,
+                     const TokenInstance *token_instance,
+                     int begin,
+                     int end,
+                     int term_type,
+                     int term_id = kTermIdNone);
+
+  // Copies the term at `src_position` of `src` to position. A span is shared
+  // instead of being copied
+  void CopyTermAt(int position, const TermInstance *src, int src_position);
+
  private:
   InstanceData *instance_data_;
 
+  // The terms and their string values copied by term_text_at or set_value_at
+  std::vector<const char *> data_;
+  mutable std::vector<std::string> texts_;
+  mutable std::vector<bool> materialized_;
+
+  // Grows data_, texts_ and materialized_ to at least `size` positions
+  void Grow(int size);
+
   DISALLOW_COPY_AND_ASSIGN(TermInstance);
 };
 
@@ -104,12 +104,16 @@ void CRFPartOfSpeechTagger::TagRange(
     int end) {
   char buff[kFeatureLengthMax];
 
+  // Frees the buffers the previous sentence grew beyond kDecodeBufferCap
+  // positions
+  crf_tagger_->ReleaseBuffers(kDecodeBufferCap);
+
   // Prepares the `sequence_feature_set_` for tagging
   sequence_feature_set_->set_size(term_instance->size());
   for (int idx = 0; idx < term_instance->size(); ++idx) {
     int type = term_instance->term_type_at(idx);
     const char *word = term_instance->term_text_at(idx);
-    int length = strlen(word);  
+    int length = term_instance->term_length_at(idx);
 
     FeatureSet *feature_set = sequence_feature_set_->at_index(idx);
     feature_set->Clear();
@@ -29,7 +29,9 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <algorithm>
+#include <map>
 #include <string>
+#include <vector>
 #include "libmilkcat.h"
 #include "common/model_impl.h"
 #include "common/reimu_trie.h"
@@ -64,7 +66,10 @@ class HMMPartOfSpeechTagger::NodeComparator {
   }
 };
 
-HMMPartOfSpeechTagger::HMMPartOfSpeechTagger(): node_pool_(NULL),
+HMMPartOfSpeechTagger::HMMPartOfSpeechTagger(): beams_(NULL),
+                                                node_pool_(NULL),
+                                                spare_node_pool_(NULL),
+                                                root_position_(0),
                                                 model_(NULL),
                                                 PU_emission_(NULL),
                                                 CD_emission_(NULL),
@@ -72,16 +77,20 @@ HMMPartOfSpeechTagger::HMMPartOfSpeechTagger(): node_pool_(NULL),
                                                 BOS_emission_(NULL),
                                                 term_instance_(NULL) {
   node_pool_ = new Pool<Node>(); 
+  spare_node_pool_ = new Pool<Node>();
 
-  for (int i = 0; i < kMaxBeams; ++i) {
-    beams_[i] = new Beam<Node, NodeComparator>(kBeamSize);
-  }
+  // Only the beams of current and previous position are used
+  beams_ = new BeamList<Node, NodeComparator>(kBeamSize);
+  beams_->Reserve(2);
 }
 
 HMMPartOfSpeechTagger::~HMMPartOfSpeechTagger() {
   delete node_pool_;
   node_pool_ = NULL;
 
+  delete spare_node_pool_;
+  spare_node_pool_ = NULL;
+
   delete PU_emission_;
   PU_emission_ = NULL;
 
@@ -94,11 +103,8 @@ HMMPartOfSpeechTagger::~HMMPartOfSpeechTagger() {
   delete BOS_emission_;
   BOS_emission_ = NULL;
 
-  for (int i = 0; i < kMaxBeams; ++i) {
-    if (beams_[i] != NULL)
-      delete beams_[i];
-    beams_[i] = NULL;
-  }
+  delete beams_;
+  beams_ = NULL;
 }
 
 namespace {
@@ -198,8 +204,9 @@ inline void HMMPartOfSpeechTagger::StoreResult(
   int beam_idx = term_instance_->size() + 1;
 
   // `beams_[beam_idx]` should have only one BOS node
-  ASSERT(beams_[beam_idx]->size() == 1, "Last node in beam should be -BOS-");
-  const Node *node = beams_[beam_idx]->at(0);
+  const Beam<Node, NodeComparator> *beam = beams_->at(beam_idx % 2);
+  ASSERT(beam->size() == 1, "Last node in beam should be -BOS-");
+  const Node *node = beam->at(0);
 
   int position = term_instance_->size() - 1;
 
@@ -221,8 +228,9 @@ void HMMPartOfSpeechTagger::Tag(
 
   Node *begin_node = node_pool_->Alloc();
   begin_node->set_value(HMMModel::kBeginOfSenetnceId, 0, NULL);
-  beams_[0]->Clear();
-  beams_[0]->Add(begin_node);
+  beams_->at(0)->Clear();
+  beams_->at(0)->Add(begin_node);
+  root_position_ = 0;
 
   // Viterbi algorithm
   const HMMModel::EmissionArray *emission = NULL;
@@ -230,6 +238,16 @@ void HMMPartOfSpeechTagger::Tag(
     emission = EmissionAt(idx);
     // beam_[0] is the BOS node, so use `idx + 1` for the word at `idx`
     Step(idx + 1, emission);
+
+    // Stores the tags which all paths agree to keep the nodes in about
+    // kDecodeWindow positions. If the paths still disagree after
+    // kDecodeWindowMax positions, the best path so far is stored instead
+    int window_size = idx + 1 - root_position_;
+    if (window_size % kDecodeWindow == 0) {
+      StoreConvergedResult(part_of_speech_tag_instance,
+                           idx + 1,
+                           window_size >= kDecodeWindowMax);
+    }
   }
 
   // The last BOS node
@@ -244,8 +262,8 @@ void HMMPartOfSpeechTagger::Tag(
 
 void HMMPartOfSpeechTagger::Step(int position,
                                  const HMMModel::EmissionArray *emission) {
-  Beam<Node, NodeComparator> *previous_beam = beams_[position - 1];
-  Beam<Node, NodeComparator> *beam = beams_[position];
+  Beam<Node, NodeComparator> *previous_beam = beams_->at((position - 1) % 2);
+  Beam<Node, NodeComparator> *beam = beams_->at(position % 2);
 
   previous_beam->Shrink();
   beam->Clear();
@@ -282,6 +300,81 @@ void HMMPartOfSpeechTagger::Step(int position,
   }
 }
 
+void HMMPartOfSpeechTagger::StoreConvergedResult(
+    PartOfSpeechTagInstance *tag_instance,
+    int position,
+    bool force) {
+  Beam<Node, NodeComparator> *beam = beams_->at(position % 2);
+  beam->Shrink();
+
+  // Keeps only the best node at `position`, so its path is the only one left.
+  // It may not be on the best path of the whole sentence, the result is
+  // approximate
+  if (force) {
+    Node *best_node = beam->at(0);
+    for (int i = 1; i < beam->size(); ++i) {
+      if (beam->at(i)->cost < best_node->cost) best_node = beam->at(i);
+    }
+    beam->Clear();
+    beam->Add(best_node);
+  }
+
+  // Traces all the paths to `position` back until they reach the same node
+  path_nodes_.clear();
+  for (int i = 0; i < beam->size(); ++i) path_nodes_.push_back(beam->at(i));
+  int converged_position = position;
+  while (path_nodes_.size() > 1 && converged_position > root_position_) {
+    for (size_t i = 0; i < path_nodes_.size(); ++i) {
+      path_nodes_[i] = path_nodes_[i]->prevoius_node;
+    }
+    std::sort(path_nodes_.begin(), path_nodes_.end());
+    path_nodes_.erase(std::unique(path_nodes_.begin(), path_nodes_.end()),
+                      path_nodes_.end());
+    --converged_position;
+  }
+  if (path_nodes_.size() != 1 || converged_position == root_position_) return;
+
+  // Stores the tags until the converged node
+  const Node *converged_node = path_nodes_[0];
+  const Node *node = converged_node;
+  for (int i = converged_position - 1; node->prevoius_node != NULL; --i) {
+    tag_instance->set_value_at(i, model_->yname(node->tag));
+    node = node->prevoius_node;
+  }
+
+  // Copies the paths from the converged node into `spare_node_pool_`, the
+  // converged node becomes the new root. Then releases the other nodes
+  std::map<const Node *, Node *> copied_nodes;
+  copied_nodes[converged_node] = spare_node_pool_->Alloc();
+  *copied_nodes[converged_node] = *converged_node;
+  copied_nodes[converged_node]->prevoius_node = NULL;
+  std::vector<const Node *> path;
+  for (int i = 0; i < beam->size(); ++i) {
+    path.clear();
+    for (node = beam->at(i);
+         copied_nodes.find(node) == copied_nodes.end();
+         node = node->prevoius_node) {
+      path.push_back(node);
+    }
+    for (int j = static_cast<int>(path.size()) - 1; j >= 0; --j) {
+      Node *copied_node = spare_node_pool_->Alloc();
+      *copied_node = *path[j];
+      copied_node->prevoius_node = copied_nodes[path[j]->prevoius_node];
+      copied_nodes[path[j]] = copied_node;
+    }
+  }
+  path_nodes_.clear();
+  for (int i = 0; i < beam->size(); ++i) path_nodes_.push_back(beam->at(i));
+  beam->Clear();
+  for (size_t i = 0; i < path_nodes_.size(); ++i) {
+    beam->Add(copied_nodes[path_nodes_[i]]);
+  }
+
+  std::swap(node_pool_, spare_node_pool_);
+  spare_node_pool_->ReleaseAll();
+  root_position_ = converged_position;
+}
+
 void HMMPartOfSpeechTagger::Train(
     const char *training_corpus,
     const char *model_filename,
@@ -27,6 +27,7 @@
 #ifndef SRC_TAGGER_HMM_PART_OF_SPEECH_TAGGER_H_
 #define SRC_TAGGER_HMM_PART_OF_SPEECH_TAGGER_H_
 
+#include <vector>
 #include "common/milkcat_config.h"
 #include "common/model_impl.h"
 #include "ml/hmm_model.h"
@@ -36,7 +37,7 @@ namespace milkcat {
 
 class PartOfSpeechTagInstance;
 class TermInstance;
-template<class T, class Comparator> class Beam;
+template<class T, class Comparator> class BeamList;
 
 // HMMPartOfSpeechTagger uses Hidden Markov Model to predict the part-of-speech
 // tag of given TermInstance
@@ -44,8 +45,6 @@ class HMMPartOfSpeechTagger: public PartOfSpeechTagger {
  public:
   struct Node;
 
-  // Beam size, two position for BOS node
-  static const int kMaxBeams = kTokenMax + 2;
   static const int kBeamSize = 3;
 
   ~HMMPartOfSpeechTagger();
@@ -64,9 +63,15 @@ class HMMPartOfSpeechTagger: public PartOfSpeechTagger {
  private:
   class NodeComparator;
 
-  Beam<Node, NodeComparator> *beams_[kMaxBeams];
+  BeamList<Node, NodeComparator> *beams_;
   Pool<Node> *node_pool_;
 
+  // The nodes before `root_position_` are removed once all paths agree on
+  // their tags. `spare_node_pool_` keeps the remaining nodes meanwhile
+  Pool<Node> *spare_node_pool_;
+  int root_position_;
+  std::vector<const Node *> path_nodes_;
+
   const HMMModel *model_;
 
   HMMModel::EmissionArray *PU_emission_;
@@ -84,6 +89,14 @@ class HMMPartOfSpeechTagger: public PartOfSpeechTagger {
   // Stores result into `part_of_speech_tag_instance`
   void StoreResult(PartOfSpeechTagInstance *part_of_speech_tag_instance);
 
+  // Stores the tags until the node where all paths to `position` converge,
+  // and removes the nodes before it. If `force` is true, the paths are first
+  // cut down to the one of the best node at `position`
+  void StoreConvergedResult(
+      PartOfSpeechTagInstance *part_of_speech_tag_instance,
+      int position,
+      bool force);
+
   // Gets the emission of word at `position` of `term_instance_`
   const HMMModel::EmissionArray *EmissionAt(int position);
 
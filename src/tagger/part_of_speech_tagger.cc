@@ -57,11 +57,9 @@ void PartOfSpeechTagger::ReadInstance(
       if (splitter != NULL) {
         strlcpy(word, tok, splitter - tok + 1);
         strcpy(tag, splitter + 1);
-        if (kTokenMax > size) {
-          term_instance->set_value_at(size, word, 0, Parser::kChineseWord);
-          tag_instance->set_value_at(size, tag);
-          size++;            
-        }
+        term_instance->set_value_at(size, word, 0, Parser::kChineseWord);
+        tag_instance->set_value_at(size, tag);
+        size++;
       }
       tok = strtok_r(NULL, " ", &saveptr);
     }
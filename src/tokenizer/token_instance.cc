@@ -26,15 +26,34 @@
 
 #include "common/milkcat_config.h"
 #include "tokenizer/token_instance.h"
+#include "utils/atomic.h"
 
 namespace milkcat {
 
-TokenInstance::TokenInstance() {
-  instance_data_ = new InstanceData(1, 1, kTokenMax);
+namespace {
+
+// The serial of the last sentence ended in any TokenInstance
+int64_t last_serial = 0;
+
+}  // namespace
+
+TokenInstance::TokenInstance(): text_(NULL), serial_(0) {
+  instance_data_ = new InstanceData(0, 3);
 }
 
 TokenInstance::~TokenInstance() {
   delete instance_data_;
 }
 
+void TokenInstance::set_size(int size) {
+  instance_data_->set_size(size);
+  serial_ = AtomicAdd(&last_serial, static_cast<int64_t>(1));
+}
+
+void TokenInstance::Grow(int size) {
+  if (size < 2 * static_cast<int>(texts_.size())) size = 2 * texts_.size();
+  texts_.resize(size);
+  materialized_.resize(size, false);
+}
+
 }  // namespace milkcat
@@ -28,6 +28,9 @@
 #define SRC_TOKENIZER_TOKEN_INSTANCE_H_
 
 #include <assert.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
 #include "common/instance_data.h"
 #include "common/milkcat_config.h"
 #include "utils/utils.h"
@@ -54,11 +57,27 @@ class TokenInstance {
 
 
   static const int kTokenTypeI = 0;
-  static const int kTokenUTF8S = 0;
+  static const int kTokenOffsetI = 1;
+  static const int kTokenLengthI = 2;
 
-  // Get the token's string value at position
+  // Get the token's string value at position. The tokens are not copied from
+  // the text until their string values are needed
   const char *token_text_at(int position) const {
-    return instance_data_->string_at(position, kTokenUTF8S);
+    if (!materialized_[position]) {
+      texts_[position].assign(token_data_at(position),
+                              token_length_at(position));
+      materialized_[position] = true;
+    }
+    return texts_[position].c_str();
+  }
+
+  // Get the token at position in the scanned text, which is not terminated
+  // by NUL. Its length is token_length_at(position)
+  const char *token_data_at(int position) const {
+    return text_ + instance_data_->integer_at(position, kTokenOffsetI);
+  }
+  int token_length_at(int position) const {
+    return instance_data_->integer_at(position, kTokenLengthI);
   }
 
   // Get the token type at position
@@ -66,20 +85,44 @@ class TokenInstance {
     return instance_data_->integer_at(position, kTokenTypeI);
   }
 
-  // Set the size of this instance
-  void set_size(int size) { instance_data_->set_size(size); }
+  // Set the size of this instance. It ends the sentence in this instance and
+  // gives it a new serial
+  void set_size(int size);
+
+  // Get the serial of the sentence in this instance. Each sentence ended by
+  // set_size has a serial different from all sentences before it, in any
+  // instance, so the caches of a sentence could be checked with it
+  int64_t serial() const { return serial_; }
 
   // Get the size of this instance
   int size() const { return instance_data_->size(); }
 
-  // Set the value at position
-  void set_value_at(int position, const char *token_text, int token_type) {
-    instance_data_->set_string_at(position, kTokenUTF8S, token_text);
+  // Set the text which the tokens are in, it should be kept until the tokens
+  // are no longer used
+  void set_text(const char *text) { text_ = text; }
+
+  // Set the value at position, the token is `length` bytes at `offset` of the
+  // text
+  void set_value_at(int position, int offset, int length, int token_type) {
+    if (position >= static_cast<int>(texts_.size())) Grow(position + 1);
+    instance_data_->set_integer_at(position, kTokenOffsetI, offset);
+    instance_data_->set_integer_at(position, kTokenLengthI, length);
     instance_data_->set_integer_at(position, kTokenTypeI, token_type);
+    materialized_[position] = false;
   }
 
  private:
   InstanceData *instance_data_;
+  const char *text_;
+  int64_t serial_;
+
+  // The string values of tokens copied by token_text_at
+  mutable std::vector<std::string> texts_;
+  mutable std::vector<bool> materialized_;
+
+  // Grows texts_ and materialized_ to at least `size` positions
+  void Grow(int size);
+
   DISALLOW_COPY_AND_ASSIGN(TokenInstance);
 };
 
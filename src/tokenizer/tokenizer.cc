@@ -58,13 +58,19 @@ bool Tokenization::GetSentence(TokenInstance *token_instance) {
   int token_type;
   int token_count = 0;
 
-  while (token_count < kTokenMax - 1) {
+  // The tokens point into the copy of text in the scanner buffer, which is
+  // kept until the next Scan
+  const char *text = yy_buffer_state_->yy_ch_buf;
+  token_instance->set_text(text);
+
+  for (; ; ) {
     token_type = milkcat_yylex(yyscanner);
 
     if (token_type == TokenInstance::kEnd) break;
 
     token_instance->set_value_at(token_count,
-                                 milkcat_yyget_text(yyscanner),
+                                 milkcat_yyget_text(yyscanner) - text,
+                                 milkcat_yyget_leng(yyscanner),
                                  token_type);
     token_count++;
 
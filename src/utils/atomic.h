@@ -0,0 +1,69 @@
+//
+// The MIT License (MIT)
+//
+// Copyright 2013-2014 The MilkCat Project Developers
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// atomic.h --- Created at 2015-01-12
+//
+
+#ifndef SRC_UTILS_ATOMIC_H_
+#define SRC_UTILS_ATOMIC_H_
+
+namespace milkcat {
+
+// Loads the value of `*ptr` with acquire semantics, which means all the
+// writes before the corresponding `ReleaseStore` are visible after it
+template<typename T>
+inline T AcquireLoad(T const *ptr) {
+#if defined(__ATOMIC_ACQUIRE)
+  return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+#else
+  T value = *const_cast<T const volatile *>(ptr);
+  __sync_synchronize();
+  return value;
+#endif  // defined(__ATOMIC_ACQUIRE)
+}
+
+// Stores `value` into `*ptr` with release semantics
+template<typename T>
+inline void ReleaseStore(T *ptr, T value) {
+#if defined(__ATOMIC_RELEASE)
+  __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+#else
+  __sync_synchronize();
+  *const_cast<T volatile *>(ptr) = value;
+#endif  // defined(__ATOMIC_RELEASE)
+}
+
+// Adds `delta` to `*ptr` atomically and returns the new value. It is a full
+// barrier
+template<typename T>
+inline T AtomicAdd(T *ptr, T delta) {
+#if defined(__ATOMIC_ACQ_REL)
+  return __atomic_add_fetch(ptr, delta, __ATOMIC_ACQ_REL);
+#else
+  return __sync_add_and_fetch(ptr, delta);
+#endif  // defined(__ATOMIC_ACQ_REL)
+}
+
+}  // namespace milkcat
+
+#endif  // SRC_UTILS_ATOMIC_H_
@@ -0,0 +1,87 @@
+//
+// The MIT License (MIT)
+//
+// Copyright 2013-2014 The MilkCat Project Developers
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// mapped_file.h --- Created at 2014-12-02
+//
+
+#ifndef SRC_UTILS_MAPPED_FILE_H_
+#define SRC_UTILS_MAPPED_FILE_H_
+
+#include <stdint.h>
+#include <string>
+#include "utils/status.h"
+#include "utils/utils.h"
+
+namespace milkcat {
+
+// A read-only memory mapping of a whole file. Pages are shared with the page
+// cache so that processes loading the same model file share one physical copy
+// of the data
+class MappedFile {
+ public:
+  // Flags to load a model file. kMmap maps the file instead of reading it into
+  // the heap. kMmapWillNeed and kMmapHugePage are hints passed to madvise(),
+  // to read ahead the whole file and to back the mapping with huge pages
+  enum {
+    kMmap = 1,
+    kMmapWillNeed = 2,
+    kMmapHugePage = 4
+  };
+
+  // The flags used to load the model files in Model
+  static const int kDefaultModelFlags = kMmap | kMmapWillNeed;
+
+  static MappedFile *New(const char *file_path, Status *status);
+
+  // Maps `file_path` and applies the kMmapWillNeed and kMmapHugePage hints in
+  // `flags`. The hints are advisory, failing to apply them is not an error
+  static MappedFile *New(const char *file_path, int flags, Status *status);
+
+  // Wraps a range of memory owned by others, such as a section of a mapped
+  // bundle, so that it could be used like a mapped file. The memory should be
+  // alive during the lifetime of the returned object
+  static MappedFile *NewView(const char *name, const void *data, int64_t size);
+  ~MappedFile();
+
+  // Pointer to the first byte of the mapping
+  const void *data() const { return data_; }
+
+  // Size of the mapped file in bytes
+  int64_t size() const { return size_; }
+
+  const char *file_path() const { return file_path_.c_str(); }
+
+ private:
+  void *data_;
+  int64_t size_;
+  bool owned_;
+  std::string file_path_;
+
+  MappedFile();
+
+  DISALLOW_COPY_AND_ASSIGN(MappedFile);
+};
+
+}  // namespace milkcat
+
+#endif  // SRC_UTILS_MAPPED_FILE_H_
@@ -0,0 +1,116 @@
+//
+// The MIT License (MIT)
+//
+// Copyright 2013-2014 The MilkCat Project Developers
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// mapped_file_posix.cc --- Created at 2014-12-02
+//
+
+#include "utils/mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+#include "utils/status.h"
+
+namespace milkcat {
+
+MappedFile::MappedFile(): data_(NULL), size_(0), owned_(true) {}
+
+MappedFile *MappedFile::New(const char *file_path, Status *status) {
+  MappedFile *self = new MappedFile();
+  self->file_path_ = file_path;
+
+  int fd = open(file_path, O_RDONLY);
+  if (fd < 0) {
+    std::string msg("failed to open ");
+    msg += file_path;
+    *status = Status::IOError(msg.c_str());
+  }
+
+  struct stat file_stat;
+  if (status->ok()) {
+    if (fstat(fd, &file_stat) != 0) {
+      std::string msg("failed to stat ");
+      msg += file_path;
+      *status = Status::IOError(msg.c_str());
+    }
+  }
+
+  // mmap() refuses zero-length mappings, an empty file just has no data
+  if (status->ok() && file_stat.st_size > 0) {
+    void *data = mmap(NULL, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+      std::string msg("failed to mmap ");
+      msg += file_path;
+      *status = Status::IOError(msg.c_str());
+    } else {
+      self->data_ = data;
+      self->size_ = file_stat.st_size;
+    }
+  }
+
+  if (fd >= 0) close(fd);
+
+  if (status->ok()) {
+    return self;
+  } else {
+    delete self;
+    return NULL;
+  }
+}
+
+MappedFile *MappedFile::New(const char *file_path,
+                            int flags,
+                            Status *status) {
+  MappedFile *self = New(file_path, status);
+  if (self == NULL || self->data_ == NULL) return self;
+
+#if defined(MADV_WILLNEED)
+  if (flags & kMmapWillNeed) madvise(self->data_, self->size_, MADV_WILLNEED);
+#endif  // defined(MADV_WILLNEED)
+#if defined(MADV_HUGEPAGE)
+  if (flags & kMmapHugePage) madvise(self->data_, self->size_, MADV_HUGEPAGE);
+#endif  // defined(MADV_HUGEPAGE)
+
+  return self;
+}
+
+MappedFile *MappedFile::NewView(const char *name,
+                                const void *data,
+                                int64_t size) {
+  MappedFile *self = new MappedFile();
+  self->file_path_ = name;
+  self->data_ = const_cast<void *>(data);
+  self->size_ = size;
+  self->owned_ = false;
+  return self;
+}
+
+MappedFile::~MappedFile() {
+  if (owned_ && data_ != NULL) munmap(data_, size_);
+  data_ = NULL;
+  size_ = 0;
+}
+
+}  // namespace milkcat
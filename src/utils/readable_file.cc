@@ -51,6 +51,29 @@ ReadableFile *ReadableFile::New(const char *file_path, Status *status) {
   }
 }
 
+ReadableFile *ReadableFile::NewFromMemory(const char *name,
+                                          const void *data,
+                                          int64_t size,
+                                          Status *status) {
+  ReadableFile *self = new ReadableFile();
+  self->file_path_ = name;
+  self->size_ = size;
+
+  // fmemopen() refuses a zero-length buffer, so an empty file is opened on a
+  // dummy buffer
+  static char empty_buffer[1];
+  void *buffer = size > 0? const_cast<void *>(data): empty_buffer;
+  if ((self->fd_ = fmemopen(buffer, size > 0? size: 1, "rb")) != NULL) {
+    return self;
+  } else {
+    std::string msg("failed to open ");
+    msg += name;
+    *status = Status::IOError(msg.c_str());
+    delete self;
+    return NULL;
+  }
+}
+
 ReadableFile::ReadableFile(): fd_(NULL), size_(0) {}
 
 bool ReadableFile::Read(void *ptr, int size, Status *status) {
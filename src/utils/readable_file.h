@@ -39,6 +39,14 @@ namespace milkcat {
 class ReadableFile {
  public:
   static ReadableFile *New(const char *file_path, Status *status);
+
+  // Reads from the `size` bytes of memory in `data` instead of a file. `name`
+  // is used in the error messages. `data` should be kept alive until the
+  // ReadableFile is deleted
+  static ReadableFile *NewFromMemory(const char *name,
+                                     const void *data,
+                                     int64_t size,
+                                     Status *status);
   ~ReadableFile();
 
   // Read n bytes (size) from file and put to *ptr
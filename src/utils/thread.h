@@ -0,0 +1,58 @@
+//
+// The MIT License (MIT)
+//
+// Copyright 2013-2014 The MilkCat Project Developers
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// thread.h --- Created at 2015-01-13
+//
+
+#ifndef SRC_UTILS_THREAD_H_
+#define SRC_UTILS_THREAD_H_
+
+#include "utils/utils.h"
+
+namespace milkcat {
+
+// A thread executes the `Run` method of its subclass. Use `Start` to start
+// the thread and `Join` to wait until it is finished
+class Thread {
+ public:
+  Thread();
+  virtual ~Thread();
+
+  // Returns false if the thread could not be created, `Run` is not called
+  // then
+  bool Start();
+  void Join();
+
+ protected:
+  virtual void Run() = 0;
+
+ private:
+  class ThreadImpl;
+  ThreadImpl *impl_;
+
+  DISALLOW_COPY_AND_ASSIGN(Thread);
+};
+
+}  // namespace milkcat
+
+#endif  // SRC_UTILS_THREAD_H_
@@ -0,0 +1,74 @@
+//
+// The MIT License (MIT)
+//
+// Copyright 2013-2014 The MilkCat Project Developers
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// thread_posix.cc --- Created at 2015-01-13
+//
+
+#include "utils/thread.h"
+#include <assert.h>
+#include <pthread.h>
+
+namespace milkcat {
+
+class Thread::ThreadImpl {
+ public:
+  explicit ThreadImpl(Thread *thread): thread_(thread), started_(false) {}
+
+  bool Start() {
+    assert(started_ == false);
+    started_ = pthread_create(&pthread_, NULL, ThreadMain, thread_) == 0;
+    return started_;
+  }
+
+  void Join() {
+    if (started_) pthread_join(pthread_, NULL);
+    started_ = false;
+  }
+
+ private:
+  Thread *thread_;
+  pthread_t pthread_;
+  bool started_;
+
+  static void *ThreadMain(void *thread) {
+    static_cast<Thread *>(thread)->Run();
+    return NULL;
+  }
+};
+
+Thread::Thread(): impl_(new ThreadImpl(this)) {}
+Thread::~Thread() {
+  impl_->Join();
+  delete impl_;
+  impl_ = NULL;
+}
+
+bool Thread::Start() {
+  return impl_->Start();
+}
+
+void Thread::Join() {
+  impl_->Join();
+}
+
+}  // namespace milkcat
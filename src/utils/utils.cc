@@ -43,6 +43,36 @@ char *trim(char *s) {
   return s;
 }
 
+// Lookup table of the CRC-32 (IEEE 802.3) polynomial
+class Crc32Table {
+ public:
+  Crc32Table() {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t c = i;
+      for (int bit = 0; bit < 8; ++bit) {
+        c = (c & 1)? 0xedb88320 ^ (c >> 1): c >> 1;
+      }
+      table_[i] = c;
+    }
+  }
+
+  uint32_t operator[](int i) const { return table_[i]; }
+
+ private:
+  uint32_t table_[256];
+};
+
+static const Crc32Table crc32_table;
+
+uint32_t Crc32(const void *data, int64_t size, uint32_t crc) {
+  const uint8_t *p = reinterpret_cast<const uint8_t *>(data);
+  crc = ~crc;
+  for (int64_t i = 0; i < size; ++i) {
+    crc = crc32_table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
 const char *_filename(const char *path) {
   int len = strlen(path);
   const char *p = path + len;
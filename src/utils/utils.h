@@ -31,7 +31,9 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
+#include <vector>
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
@@ -63,6 +65,23 @@ void Sleep(double seconds);
 // Get number of processors/cores in current machine
 int HardwareConcurrency();
 
+// Get the current time of a monotonic clock in seconds. It is only useful to
+// measure the elapsed time
+double Now();
+
+// Calculates the CRC-32 checksum of `size` bytes in `data`. To checksum data
+// in pieces, pass the result of previous piece as `crc`
+uint32_t Crc32(const void *data, int64_t size, uint32_t crc = 0);
+
+// Frees the memory of `vector` if it can hold more than `size` elements. It
+// keeps at most the first `size` elements
+template<typename T>
+void ReleaseVector(std::vector<T> *vector, size_t size) {
+  if (vector->capacity() <= size) return;
+  if (size > vector->size()) size = vector->size();
+  std::vector<T>(vector->begin(), vector->begin() + size).swap(*vector);
+}
+
 #if defined(HAVE_UNORDERED_MAP)
 using std::unordered_map;
 #elif defined(HAVE_TR1_UNORDERED_MAP)
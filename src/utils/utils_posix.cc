@@ -24,6 +24,8 @@
 // utils_posix.cc --- Created at 2014-03-18
 //
 
+#include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 #include "utils.h"
 
@@ -38,5 +40,17 @@ int HardwareConcurrency() {
   return sysconf(_SC_NPROCESSORS_ONLN);
 }
 
+double Now() {
+#if defined(CLOCK_MONOTONIC)
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+#else
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  return now.tv_sec + now.tv_usec * 1e-6;
+#endif  // defined(CLOCK_MONOTONIC)
+}
+
 }  // namespace milkcat
 
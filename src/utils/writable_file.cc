@@ -75,4 +75,13 @@ void WritableFile::Write(const void *data, int size, Status *status) {
   }
 }
 
+void WritableFile::Seek(int64_t offset, Status *status) {
+  std::string error_message;
+
+  if (fseeko(fd_, offset, SEEK_SET) != 0) {
+    error_message = std::string("Failed to seek in ") + file_path_;
+    *status = Status::IOError(error_message.c_str());
+  }
+}
+
 }  // namespace milkcat
@@ -27,6 +27,7 @@
 #ifndef SRC_UTILS_WRITABLE_FILE_H_
 #define SRC_UTILS_WRITABLE_FILE_H_
 
+#include <stdint.h>
 #include <stdio.h>
 #include <string>
 #include "utils/status.h"
@@ -52,6 +53,9 @@ class WritableFile {
     Write(&data, sizeof(data), status);
   }
 
+  // Moves the write position to `offset` from the beginning of file
+  void Seek(int64_t offset, Status *status);
+
  private:
   FILE *fd_;
   std::string file_path_;
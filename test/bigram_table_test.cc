@@ -0,0 +1,369 @@
+//
+// The MIT License (MIT)
+//
+// Copyright 2013-2014 The MilkCat Project Developers
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// bigram_table_test.cc --- Created at 2015-01-15
+//
+
+#include "common/bigram_table.h"
+#include "common/compressed_bigram_table.h"
+#include "common/elias_fano_bigram_table.h"
+#include "common/static_hashtable.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <vector>
+#include "utils/status.h"
+
+#define N 20000
+
+using milkcat::BigramTable;
+using milkcat::CompressedBigramTable;
+using milkcat::EliasFanoBigramTable;
+using milkcat::StaticHashTable;
+using milkcat::Status;
+
+std::map<int64_t, float> bigrams;
+std::vector<int64_t> keys;
+std::vector<float> costs;
+
+int64_t make_key(int left_id, int right_id) {
+  return (static_cast<int64_t>(left_id) << 32) + right_id;
+}
+
+void generate_test_data() {
+  // A long row to cross many blocks
+  for (int right_id = 1; right_id < 3000; right_id += 3) {
+    bigrams[make_key(7, right_id)] = 2.0f + (right_id % 100) / 10.0f;
+  }
+  while (bigrams.size() < N) {
+    int left_id = rand() % 1000 + 1;
+    int right_id = rand() % 100000 + 1;
+    bigrams[make_key(left_id, right_id)] = 2.0f + (rand() % 1000) / 50.0f;
+  }
+
+  for (std::map<int64_t, float>::iterator
+       it = bigrams.begin(); it != bigrams.end(); ++it) {
+    keys.push_back(it->first);
+    costs.push_back(it->second);
+  }
+}
+
+// Checks the costs from FindPairs of `table` with some left ids and right ids
+// in and not in the table. The costs should be in `tolerance`
+void check_table(const BigramTable *table, float tolerance) {
+  assert(table->size() == N);
+
+  std::vector<int> left_ids, right_ids;
+  std::vector<float> result;
+  for (int round = 0; round < 200; ++round) {
+    left_ids.clear();
+    right_ids.clear();
+    left_ids.push_back(7);
+    left_ids.push_back(rand() % 1200);
+    left_ids.push_back(keys[rand() % N] >> 32);
+
+    // Right ids in the table, out of the table and duplicated, more than the
+    // batch size of CompressedBigramTable
+    int right_number = round % 2 == 0? 5: 150;
+    for (int i = 0; i < right_number; ++i) {
+      if (i % 3 == 0) {
+        right_ids.push_back(keys[rand() % N] & 0xffffffff);
+      } else if (i % 3 == 1) {
+        right_ids.push_back(rand() % 3100);
+      } else {
+        right_ids.push_back(right_ids[rand() % right_ids.size()]);
+      }
+    }
+
+    result.resize(left_ids.size() * right_ids.size());
+    table->FindPairs(left_ids.data(),
+                     left_ids.size(),
+                     right_ids.data(),
+                     right_ids.size(),
+                     result.data());
+    for (int j = 0; j < right_ids.size(); ++j) {
+      for (int i = 0; i < left_ids.size(); ++i) {
+        float cost = result[j * left_ids.size() + i];
+        std::map<int64_t, float>::iterator
+        it = bigrams.find(make_key(left_ids[i], right_ids[j]));
+        if (it == bigrams.end()) {
+          assert(cost == BigramTable::kNoCost);
+        } else {
+          assert(fabs(cost - it->second) <= tolerance);
+        }
+      }
+    }
+  }
+}
+
+// Copies the file `file_path` into `corrupted_path` with `size` bytes at
+// `offset` replaced by `data`. A negative `offset` counts from the end
+void write_corrupted_file(const char *file_path,
+                          const char *corrupted_path,
+                          long offset,
+                          const void *data,
+                          int size) {
+  FILE *fd = fopen(file_path, "rb");
+  assert(fd != NULL);
+  std::vector<char> buffer;
+  int c;
+  while ((c = fgetc(fd)) != EOF) buffer.push_back(static_cast<char>(c));
+  fclose(fd);
+
+  if (offset < 0) offset += buffer.size();
+  memcpy(buffer.data() + offset, data, size);
+  fd = fopen(corrupted_path, "wb");
+  assert(fd != NULL);
+  fwrite(buffer.data(), 1, buffer.size(), fd);
+  fclose(fd);
+}
+
+// Reads the int32 at `offset` of the file `file_path`
+int32_t read_int32(const char *file_path, long offset) {
+  FILE *fd = fopen(file_path, "rb");
+  assert(fd != NULL);
+  int32_t value = 0;
+  fseek(fd, offset, SEEK_SET);
+  assert(fread(&value, sizeof(value), 1, fd) == 1);
+  fclose(fd);
+  return value;
+}
+
+// Loading the corrupted file should fail
+void check_corrupted(const char *corrupted_path) {
+  Status status;
+  const BigramTable *table = BigramTable::New(corrupted_path, &status);
+  assert(table == NULL && !status.ok());
+}
+
+void compressed_table_test() {
+  Status status;
+  const CompressedBigramTable *table = CompressedBigramTable::Build(
+      keys.data(),
+      costs.data(),
+      N);
+
+  // The costs are in [2, 22) and quantized into 256 levels
+  float tolerance = 20.0f / 255 / 2 + 1e-4f;
+  check_table(table, tolerance);
+  table->Save("compressed.test.bigram_table", &status);
+  assert(status.ok());
+  delete table;
+
+  const BigramTable *loaded_table = BigramTable::New(
+      "compressed.test.bigram_table",
+      &status);
+  assert(status.ok());
+  check_table(loaded_table, tolerance);
+  delete loaded_table;
+
+  // The header is 8 int32s, followed by `left_number + 1` row offsets and
+  // then the block offsets. The row offsets are not ascending, a block
+  // offset is out of the data, and the last varint runs off the end
+  const char *file_path = "compressed.test.bigram_table";
+  const char *corrupted_path = "compressed.corrupted.test.bigram_table";
+  int32_t left_number = read_int32(file_path, 4);
+  long row_offsets = 8 * sizeof(int32_t);
+  long block_offsets = row_offsets + (left_number + 1) * sizeof(int32_t);
+  uint32_t large_offset = 0x7fffffff;
+  uint8_t continued_byte = 0x80;
+  write_corrupted_file(file_path,
+                       corrupted_path,
+                       row_offsets + 8 * sizeof(int32_t),
+                       &large_offset,
+                       sizeof(large_offset));
+  check_corrupted(corrupted_path);
+  write_corrupted_file(file_path,
+                       corrupted_path,
+                       block_offsets + sizeof(int32_t),
+                       &large_offset,
+                       sizeof(large_offset));
+  check_corrupted(corrupted_path);
+  write_corrupted_file(file_path,
+                       corrupted_path,
+                       -1,
+                       &continued_byte,
+                       sizeof(continued_byte));
+  check_corrupted(corrupted_path);
+
+  puts("compressed_table_test OK");
+}
+
+void elias_fano_table_test() {
+  Status status;
+  const EliasFanoBigramTable *table = EliasFanoBigramTable::Build(
+      keys.data(),
+      costs.data(),
+      N);
+
+  float tolerance = 20.0f / 255 / 2 + 1e-4f;
+  check_table(table, tolerance);
+  table->Save("elias_fano.test.bigram_table", &status);
+  assert(status.ok());
+  delete table;
+
+  const BigramTable *loaded_table = BigramTable::New(
+      "elias_fano.test.bigram_table",
+      &status);
+  assert(status.ok());
+  check_table(loaded_table, tolerance);
+  delete loaded_table;
+
+  // The header is 10 int32s, followed by the high words, the low words and
+  // `left_number + 1` rows of 4 int32s and the high window, then the zero
+  // samples. A row has 64 low bits, the row offsets are not ascending, the
+  // high window of a row is changed and a sample is not a zero
+  const char *file_path = "elias_fano.test.bigram_table";
+  const char *corrupted_path = "elias_fano.corrupted.test.bigram_table";
+  int32_t left_number = read_int32(file_path, 4);
+  int32_t high_words = read_int32(file_path, 16);
+  int32_t low_words = read_int32(file_path, 20);
+  long row_size = 4 * sizeof(int32_t) + sizeof(uint64_t);
+  long rows = 10 * sizeof(int32_t) + (high_words + low_words) * sizeof(int64_t);
+  long samples = rows + (left_number + 1) * row_size;
+  uint32_t low_bits = 64;
+  uint32_t zero_offset = 0;
+  uint64_t high_window = 0x5555555555555555ULL;
+  uint32_t sample = read_int32(file_path, samples + sizeof(int32_t)) + 1;
+  write_corrupted_file(file_path,
+                       corrupted_path,
+                       rows + 7 * row_size + 3 * sizeof(int32_t),
+                       &low_bits,
+                       sizeof(low_bits));
+  check_corrupted(corrupted_path);
+  write_corrupted_file(file_path,
+                       corrupted_path,
+                       rows + 8 * row_size,
+                       &zero_offset,
+                       sizeof(zero_offset));
+  check_corrupted(corrupted_path);
+  write_corrupted_file(file_path,
+                       corrupted_path,
+                       rows + 7 * row_size + 4 * sizeof(int32_t),
+                       &high_window,
+                       sizeof(high_window));
+  check_corrupted(corrupted_path);
+  write_corrupted_file(file_path,
+                       corrupted_path,
+                       samples + sizeof(int32_t),
+                       &sample,
+                       sizeof(sample));
+  check_corrupted(corrupted_path);
+
+  // Tables with one bigram and without any bigram
+  int64_t key = make_key(3, 5);
+  float cost = 1.5f;
+  float result[2];
+  int left_ids[] = {3, 4};
+  int right_ids[] = {5};
+  table = EliasFanoBigramTable::Build(&key, &cost, 1);
+  table->FindPairs(left_ids, 2, right_ids, 1, result);
+  assert(result[0] == cost && result[1] == BigramTable::kNoCost);
+  delete table;
+
+  // A dense row whose right ids have no low bits
+  int64_t dense_keys[8];
+  float dense_costs[8];
+  for (int i = 0; i < 8; ++i) {
+    dense_keys[i] = make_key(2, i + (i > 3));
+    dense_costs[i] = i;
+  }
+  // The right ids are unsorted, duplicated and out of the row
+  int dense_left_ids[] = {2, 1};
+  int dense_right_ids[] = {8, 3, -1, 0, 4, 9, 3};
+  float dense_expected[] = {7.0f, 3.0f, -1.0f, 0.0f, -1.0f, -1.0f, 3.0f};
+  float dense_result[14];
+  tolerance = 7.0f / 255 / 2 + 1e-4f;
+  table = EliasFanoBigramTable::Build(dense_keys, dense_costs, 8);
+  table->FindPairs(dense_left_ids, 2, dense_right_ids, 7, dense_result);
+  for (int j = 0; j < 7; ++j) {
+    if (dense_expected[j] < 0) {
+      assert(dense_result[j * 2] == BigramTable::kNoCost);
+    } else {
+      assert(fabs(dense_result[j * 2] - dense_expected[j]) <= tolerance);
+    }
+    assert(dense_result[j * 2 + 1] == BigramTable::kNoCost);
+  }
+  delete table;
+
+  // A short row whose first bucket has five right ids, the right ids after
+  // the second one in a bucket are compared one by one
+  int64_t bucket_keys[] = {
+    make_key(2, 0), make_key(2, 1), make_key(2, 2), make_key(2, 3),
+    make_key(2, 4), make_key(2, 1000)
+  };
+  float bucket_costs[] = {0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f};
+  int bucket_right_ids[] = {4, 3, 5, 1000, 999, 0};
+  float bucket_expected[] = {4.0f, 3.0f, -1.0f, 5.0f, -1.0f, 0.0f};
+  float bucket_result[6];
+  tolerance = 5.0f / 255 / 2 + 1e-4f;
+  table = EliasFanoBigramTable::Build(bucket_keys, bucket_costs, 6);
+  table->FindPairs(dense_left_ids, 1, bucket_right_ids, 6, bucket_result);
+  for (int j = 0; j < 6; ++j) {
+    if (bucket_expected[j] < 0) {
+      assert(bucket_result[j] == BigramTable::kNoCost);
+    } else {
+      assert(fabs(bucket_result[j] - bucket_expected[j]) <= tolerance);
+    }
+  }
+  delete table;
+
+  table = EliasFanoBigramTable::Build(NULL, NULL, 0);
+  table->FindPairs(left_ids, 2, right_ids, 1, result);
+  assert(result[0] == BigramTable::kNoCost);
+  assert(result[1] == BigramTable::kNoCost);
+  delete table;
+
+  puts("elias_fano_table_test OK");
+}
+
+void hash_table_test() {
+  Status status;
+  const StaticHashTable<int64_t, float> *
+  hashtable = StaticHashTable<int64_t, float>::Build(keys.data(),
+                                                     costs.data(),
+                                                     N);
+  hashtable->Save("hash.test.bigram_table", &status);
+  assert(status.ok());
+  delete hashtable;
+
+  const BigramTable *table = BigramTable::New("hash.test.bigram_table",
+                                              &status);
+  assert(status.ok());
+  check_table(table, 0.0f);
+  delete table;
+
+  puts("hash_table_test OK");
+}
+
+int main() {
+  generate_test_data();
+  compressed_table_test();
+  elias_fano_table_test();
+  hash_table_test();
+  return 0;
+}
@@ -0,0 +1,108 @@
+//
+// The MIT License (MIT)
+//
+// Copyright 2013-2014 The MilkCat Project Developers
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// bundle_test.cc --- Created at 2015-01-09
+//
+
+#include "common/bundle.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "utils/readable_file.h"
+#include "utils/status.h"
+#include "utils/writable_file.h"
+
+using milkcat::Bundle;
+using milkcat::ReadableFile;
+using milkcat::Status;
+using milkcat::WritableFile;
+
+const char *kBundleFile = "bundle.test.bundle";
+
+void write_file(const char *path, const std::string &data) {
+  Status status;
+  WritableFile *fd = WritableFile::New(path, &status);
+  assert(status.ok());
+  if (data.size() > 0) fd->Write(data.data(), data.size(), &status);
+  assert(status.ok());
+  delete fd;
+}
+
+void create_and_open_test() {
+  std::vector<std::string> names, paths;
+  std::string first_data(10000, 'a');
+  write_file("bundle.test.first", first_data);
+  names.push_back("first");
+  paths.push_back("bundle.test.first");
+  write_file("bundle.test.second", "line 1\nline 2\n");
+  names.push_back("second");
+  paths.push_back("bundle.test.second");
+  write_file("bundle.test.empty", "");
+  names.push_back("empty");
+  paths.push_back("bundle.test.empty");
+
+  Status status;
+  Bundle::Create(kBundleFile, names, paths, &status);
+  assert(status.ok());
+  assert(Bundle::IsBundle(kBundleFile));
+  assert(!Bundle::IsBundle("bundle.test.first"));
+
+  Bundle *bundle = Bundle::Open(kBundleFile, &status);
+  assert(status.ok());
+  bundle->Verify(&status);
+  assert(status.ok());
+  assert(bundle->section_number() == 3);
+  assert(bundle->Has("first") && !bundle->Has("third"));
+
+  int64_t size = 0;
+  const void *data = bundle->Section("first", &size, &status);
+  assert(status.ok() && size == first_data.size());
+  assert(memcmp(data, first_data.data(), size) == 0);
+
+  data = bundle->Section("empty", &size, &status);
+  assert(status.ok() && size == 0);
+
+  char line[1024];
+  ReadableFile *fd = bundle->OpenSection("second", &status);
+  assert(status.ok());
+  fd->ReadLine(line, sizeof(line), &status);
+  assert(status.ok() && strcmp(line, "line 1\n") == 0);
+  fd->ReadLine(line, sizeof(line), &status);
+  assert(status.ok() && strcmp(line, "line 2\n") == 0);
+  assert(fd->Eof());
+  delete fd;
+
+  bundle->Section("third", &size, &status);
+  assert(!status.ok());
+  delete bundle;
+
+  puts("create_and_open_test OK");
+}
+
+int main() {
+  create_and_open_test();
+  return 0;
+}
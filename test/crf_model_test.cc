@@ -0,0 +1,259 @@
+//
+// The MIT License (MIT)
+//
+// Copyright 2013-2014 The MilkCat Project Developers
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// crf_model_test.cc --- Created at 2015-01-15
+//
+
+#include "ml/crf_model.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "ml/character_score_table.h"
+#include "ml/crf_tagger.h"
+#include "ml/sequence_feature_set.h"
+#include "utils/status.h"
+
+using milkcat::CharacterScoreTable;
+using milkcat::CRFModel;
+using milkcat::CRFTagger;
+using milkcat::SequenceFeatureSet;
+using milkcat::Status;
+
+// Encodes `code_point` into UTF-8
+std::string EncodeCharacter(int code_point) {
+  std::string character;
+  if (code_point < 0x80) {
+    character.push_back(code_point);
+  } else if (code_point < 0x800) {
+    character.push_back(0xc0 | (code_point >> 6));
+    character.push_back(0x80 | (code_point & 0x3f));
+  } else if (code_point < 0x10000) {
+    character.push_back(0xe0 | (code_point >> 12));
+    character.push_back(0x80 | ((code_point >> 6) & 0x3f));
+    character.push_back(0x80 | (code_point & 0x3f));
+  } else {
+    character.push_back(0xf0 | (code_point >> 18));
+    character.push_back(0x80 | ((code_point >> 12) & 0x3f));
+    character.push_back(0x80 | ((code_point >> 6) & 0x3f));
+    character.push_back(0x80 | (code_point & 0x3f));
+  }
+  return character;
+}
+
+// Checks the scores of `character` in `table` are the same as the unigram
+// costs from the feature index of `model`
+void CheckCharacter(const CRFModel *model,
+                    const CharacterScoreTable *table,
+                    const std::string &character) {
+  int character_id = table->CharacterId(character.c_str());
+  assert(character_id != CharacterScoreTable::kNotCharacter);
+
+  for (int i = 0; i < model->unigram_template_num(); ++i) {
+    if (!table->has_template(i)) continue;
+
+    const CRFModel::Template &tmpl = model->compiled_unigram_template(i);
+    std::string feature = tmpl.prefix + character;
+    int xid = model->xid(feature.c_str());
+    const float *scores = table->scores(i, character_id);
+    for (int yid = 0; yid < model->ysize(); ++yid) {
+      if (xid < 0) {
+        assert(scores[yid] == 0.0f);
+      } else {
+        assert(scores[yid] == model->unigram_cost(xid, yid));
+      }
+    }
+  }
+}
+
+void character_table_test() {
+  Status status;
+  std::string model_path = MODEL_DIR "ctb_seg.crf";
+  CRFModel *model = CRFModel::New(model_path.c_str(), &status);
+  assert(status.ok());
+  assert(model->character_table() == NULL);
+  model->BuildCharacterTable();
+  const CharacterScoreTable *table = model->character_table();
+  assert(table != NULL);
+
+  // Only the templates of one character are in the table
+  for (int i = 0; i < model->unigram_template_num(); ++i) {
+    const CRFModel::Template &tmpl = model->compiled_unigram_template(i);
+    assert(table->has_template(i) == (tmpl.fields.size() == 1));
+  }
+  assert(table->character_number() > 1);
+
+  // Compares the table with the feature index for CJK, ASCII and some rare
+  // characters
+  for (int code_point = 0x4e00; code_point < 0xa000; ++code_point) {
+    CheckCharacter(model, table, EncodeCharacter(code_point));
+  }
+  for (int code_point = 0x20; code_point < 0x80; ++code_point) {
+    CheckCharacter(model, table, EncodeCharacter(code_point));
+  }
+  for (int code_point = 0x20000; code_point < 0x20100; ++code_point) {
+    CheckCharacter(model, table, EncodeCharacter(code_point));
+  }
+
+  // Words, broken and overlong characters are not single characters
+  const char *not_characters[] = {
+    "", "今天", "ab", "\xe4\xbb", "\xe4\xbb\x8a\x80", "\xc0\xae", "\x80"
+  };
+  for (size_t i = 0; i < sizeof(not_characters) / sizeof(char *); ++i) {
+    assert(table->CharacterId(not_characters[i]) ==
+           CharacterScoreTable::kNotCharacter);
+  }
+
+  delete model;
+  puts("character_table_test OK");
+}
+
+void static_bigram_test() {
+  Status status;
+  std::string model_path = MODEL_DIR "ctb_seg.crf";
+  CRFModel *model = CRFModel::New(model_path.c_str(), &status);
+  assert(status.ok());
+
+  // Sums the costs of bigram templates without fields
+  int ysize = model->ysize();
+  std::vector<float> expected(ysize * ysize, 0.0f);
+  int static_template_num = 0;
+  for (int i = 0; i < model->bigram_template_num(); ++i) {
+    const CRFModel::Template &tmpl = model->compiled_bigram_template(i);
+    if (!tmpl.fields.empty()) continue;
+
+    ++static_template_num;
+    int xid = model->xid(tmpl.prefix.c_str());
+    assert(xid >= 0);
+    for (int left = 0; left < ysize; ++left) {
+      for (int right = 0; right < ysize; ++right) {
+        expected[right * ysize + left] += model->bigram_cost(xid, left, right);
+      }
+    }
+  }
+  assert(static_template_num > 0);
+
+  for (int right = 0; right < ysize; ++right) {
+    const float *costs = model->static_bigram_costs(right);
+    for (int left = 0; left < model->aligned_ysize(); ++left) {
+      if (left < ysize) {
+        assert(costs[left] == expected[right * ysize + left]);
+      } else {
+        assert(costs[left] == 0.0f);
+      }
+    }
+  }
+
+  delete model;
+  puts("static_bigram_test OK");
+}
+
+// Puts the characters of `text` into `sequence`, one for each position
+void SetSequence(SequenceFeatureSet *sequence, const std::string &text) {
+  std::vector<std::string> characters;
+  for (size_t i = 0; i < text.size(); ) {
+    size_t length = 1;
+    while (i + length < text.size() && (text[i + length] & 0xc0) == 0x80) {
+      ++length;
+    }
+    characters.push_back(text.substr(i, length));
+    i += length;
+  }
+
+  sequence->set_size(characters.size());
+  for (size_t i = 0; i < characters.size(); ++i) {
+    sequence->at_index(i)->Clear();
+    sequence->at_index(i)->Add(characters[i].c_str());
+  }
+}
+
+// Tags [begin, end) of `sequence` by both taggers and compares the results
+void CompareRange(CRFTagger *tagger,
+                  CRFTagger *cached_tagger,
+                  SequenceFeatureSet *sequence,
+                  int begin,
+                  int end) {
+  tagger->TagRange(sequence, begin, end, 0, 0);
+  cached_tagger->TagRange(sequence, begin, end, 0, 0);
+  for (int i = 0; i < end - begin; ++i) {
+    assert(tagger->y(i) == cached_tagger->y(i));
+  }
+}
+
+void unigram_cache_test() {
+  Status status;
+  std::string model_path = MODEL_DIR "ctb_seg.crf";
+  CRFModel *model = CRFModel::New(model_path.c_str(), &status);
+  assert(status.ok());
+  model->BuildCharacterTable();
+
+  CRFTagger *tagger = new CRFTagger(model);
+  CRFTagger *cached_tagger = new CRFTagger(model);
+  cached_tagger->EnableUnigramCache();
+  SequenceFeatureSet *sequence = new SequenceFeatureSet();
+
+  // The ranges of a sentence, and the cached costs are used again
+  SetSequence(sequence, "我们中出了一个叛徒，MilkCat是一个中文分词工具。");
+  CompareRange(tagger, cached_tagger, sequence, 2, 9);
+  CompareRange(tagger, cached_tagger, sequence, 12, 19);
+  CompareRange(tagger, cached_tagger, sequence, 0, sequence->size());
+
+  // A new sentence after clearing the cache
+  cached_tagger->ClearUnigramCache();
+  SetSequence(sequence, "今天天气不错，我们去公园散步吧。");
+  CompareRange(tagger, cached_tagger, sequence, 0, sequence->size());
+  CompareRange(tagger, cached_tagger, sequence, 3, 8);
+
+  // The buffers are released below the length of the sentence, they grow
+  // again and the lattice allows all states
+  cached_tagger->ClearUnigramCache();
+  cached_tagger->ReleaseBuffers(4);
+  CompareRange(tagger, cached_tagger, sequence, 0, sequence->size());
+
+  delete sequence;
+  delete cached_tagger;
+  delete tagger;
+  delete model;
+  puts("unigram_cache_test OK");
+}
+
+// The model files are installed into MODEL_DIR separately, returns false if
+// they are not there
+bool has_model() {
+  FILE *fd = fopen(MODEL_DIR "unigram.idx", "rb");
+  if (fd == NULL) return false;
+  fclose(fd);
+  return true;
+}
+
+int main() {
+  if (!has_model()) {
+    puts("crf_model_test SKIP: no model in " MODEL_DIR);
+    return 77;
+  }
+  character_table_test();
+  static_bigram_test();
+  unigram_cache_test();
+  return 0;
+}
@@ -0,0 +1,105 @@
+//
+// The MIT License (MIT)
+//
+// Copyright 2013-2014 The MilkCat Project Developers
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// long_sentence_test.cc --- Created at 2015-01-16
+//
+
+#include <assert.h>
+#include <stdio.h>
+#include <string>
+#include "include/milkcat.h"
+
+using milkcat::Model;
+using milkcat::Parser;
+
+Parser::Options GetOptions(int options_type) {
+  Parser::Options options;
+  switch (options_type % 4) {
+    case 0:
+      options.UseMixedSegmenter();
+      options.UseMixedPOSTagger();
+      break;
+    case 1:
+      options.UseCrfSegmenter();
+      options.UseCrfPOSTagger();
+      break;
+    case 2:
+      options.UseBigramSegmenter();
+      options.UseHmmPOSTagger();
+      break;
+    case 3:
+      options.UseUnigramSegmenter();
+      options.NoPOSTagger();
+      break;
+  }
+  return options;
+}
+
+void long_sentence_test() {
+  // A sentence much longer than the decoding window is not split
+  std::string text;
+  for (int i = 0; i < 2000; ++i) text += "今天的天气不错";
+
+  Model *model = Model::New(MODEL_DIR);
+  assert(model);
+  for (int options_type = 0; options_type < 4; ++options_type) {
+    Parser *parser = Parser::New(GetOptions(options_type), model);
+    assert(parser);
+
+    Parser::Iterator *it = new Parser::Iterator();
+    std::string result;
+    int sentence_number = 0;
+    parser->Parse(text.c_str(), it);
+    while (!it->End()) {
+      if (it->is_begin_of_sentence()) ++sentence_number;
+      if (options_type % 4 != 3) assert(*it->part_of_speech_tag() != '\0');
+      result += it->word();
+      it->Next();
+    }
+    assert(result == text);
+    assert(sentence_number == 1);
+
+    delete it;
+    delete parser;
+  }
+  delete model;
+  puts("long_sentence_test OK");
+}
+
+// The model files are installed into MODEL_DIR separately, returns false if
+// they are not there
+bool has_model() {
+  FILE *fd = fopen(MODEL_DIR "unigram.idx", "rb");
+  if (fd == NULL) return false;
+  fclose(fd);
+  return true;
+}
+
+int main() {
+  if (!has_model()) {
+    puts("long_sentence_test SKIP: no model in " MODEL_DIR);
+    return 77;
+  }
+  long_sentence_test();
+  return 0;
+}
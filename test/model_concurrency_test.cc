@@ -0,0 +1,159 @@
+//
+// The MIT License (MIT)
+//
+// Copyright 2013-2014 The MilkCat Project Developers
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// model_concurrency_test.cc --- Created at 2015-01-12
+//
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "include/milkcat.h"
+
+using milkcat::Model;
+using milkcat::Parser;
+
+#define THREAD_NUMBER 16
+#define ROUND_NUMBER 20
+
+const char *kText = "今天的天气不错。MilkCat 是一个中文分词和词性标注工具。";
+
+// The thread number to wait for before starting to create the parsers
+int waiting_threads = 0;
+pthread_mutex_t waiting_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t waiting_cond = PTHREAD_COND_INITIALIZER;
+
+struct ThreadArgs {
+  Model *model;
+  int options_type;
+  std::string result;
+};
+
+Parser::Options GetOptions(int options_type) {
+  Parser::Options options;
+  switch (options_type % 4) {
+    case 0:
+      options.UseMixedSegmenter();
+      options.UseMixedPOSTagger();
+      break;
+    case 1:
+      options.UseCrfSegmenter();
+      options.UseCrfPOSTagger();
+      break;
+    case 2:
+      options.UseBigramSegmenter();
+      options.UseHmmPOSTagger();
+      break;
+    case 3:
+      options.UseUnigramSegmenter();
+      options.NoPOSTagger();
+      break;
+  }
+  return options;
+}
+
+// Parses kText with a new Parser created from `model` and returns the result
+std::string Parse(Model *model, int options_type) {
+  Parser *parser = Parser::New(GetOptions(options_type), model);
+  assert(parser);
+
+  std::string result;
+  Parser::Iterator *it = new Parser::Iterator();
+  parser->Parse(kText, it);
+  while (!it->End()) {
+    result += it->word();
+    result += "/";
+    if (options_type % 4 != 3) result += it->part_of_speech_tag();
+    result += " ";
+    it->Next();
+  }
+
+  delete it;
+  delete parser;
+  return result;
+}
+
+void *ParserThread(void *args) {
+  ThreadArgs *thread_args = static_cast<ThreadArgs *>(args);
+
+  // Waits for all threads, then creates the parsers at the same time
+  pthread_mutex_lock(&waiting_mutex);
+  --waiting_threads;
+  if (waiting_threads == 0) pthread_cond_broadcast(&waiting_cond);
+  while (waiting_threads > 0) pthread_cond_wait(&waiting_cond, &waiting_mutex);
+  pthread_mutex_unlock(&waiting_mutex);
+
+  for (int i = 0; i < ROUND_NUMBER; ++i) {
+    std::string result = Parse(thread_args->model, thread_args->options_type);
+    assert(i == 0 || result == thread_args->result);
+    thread_args->result = result;
+  }
+  return NULL;
+}
+
+void concurrent_new_parser_test() {
+  // The expected results from a model used by only one thread
+  std::vector<std::string> expected;
+  Model *model = Model::New(MODEL_DIR);
+  assert(model);
+  for (int i = 0; i < 4; ++i) expected.push_back(Parse(model, i));
+  delete model;
+
+  model = Model::New(MODEL_DIR);
+  assert(model);
+  pthread_t threads[THREAD_NUMBER];
+  ThreadArgs args[THREAD_NUMBER];
+  waiting_threads = THREAD_NUMBER;
+  for (int i = 0; i < THREAD_NUMBER; ++i) {
+    args[i].model = model;
+    args[i].options_type = i;
+    pthread_create(&threads[i], NULL, ParserThread, &args[i]);
+  }
+
+  for (int i = 0; i < THREAD_NUMBER; ++i) {
+    pthread_join(threads[i], NULL);
+    assert(args[i].result == expected[i % 4]);
+  }
+  delete model;
+
+  puts("concurrent_new_parser_test OK");
+}
+
+// The model files are installed into MODEL_DIR separately, returns false if
+// they are not there
+bool has_model() {
+  FILE *fd = fopen(MODEL_DIR "unigram.idx", "rb");
+  if (fd == NULL) return false;
+  fclose(fd);
+  return true;
+}
+
+int main() {
+  if (!has_model()) {
+    puts("model_concurrency_test SKIP: no model in " MODEL_DIR);
+    return 77;
+  }
+  concurrent_new_parser_test();
+  return 0;
+}
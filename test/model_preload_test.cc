@@ -0,0 +1,143 @@
+//
+// The MIT License (MIT)
+//
+// Copyright 2013-2014 The MilkCat Project Developers
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// model_preload_test.cc --- Created at 2015-01-16
+//
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include "include/milkcat.h"
+#include "utils/atomic.h"
+
+using milkcat::Model;
+using milkcat::Parser;
+
+#define THREAD_NUMBER 16
+#define ROUND_NUMBER 20
+
+Parser::Options GetOptions(int options_type) {
+  Parser::Options options;
+  switch (options_type % 4) {
+    case 0:
+      options.UseMixedSegmenter();
+      options.UseMixedPOSTagger();
+      break;
+    case 1:
+      options.UseCrfSegmenter();
+      options.UseCrfPOSTagger();
+      break;
+    case 2:
+      options.UseBigramSegmenter();
+      options.UseHmmPOSTagger();
+      break;
+    case 3:
+      options.UseUnigramSegmenter();
+      options.NoPOSTagger();
+      break;
+  }
+  return options;
+}
+
+void preload_test() {
+  Model *model = Model::New(MODEL_DIR);
+  assert(model);
+
+  // Loads the components of the mixed segmenter and the mixed tagger
+  bool success = model->Preload(GetOptions(0), 4);
+  assert(success);
+  assert(model->preload_number() == 7);
+  for (int i = 0; i < model->preload_number(); ++i) {
+    assert(strlen(model->preload_name(i)) > 0);
+    assert(model->preload_time(i) >= 0.0);
+  }
+
+  // Components already loaded are still reported
+  model->Preload(GetOptions(1), 0);
+  assert(model->preload_number() == 2);
+  delete model;
+
+  puts("preload_test OK");
+}
+
+struct PreloadPollArgs {
+  Model *model;
+  bool *stop;
+};
+
+// Polls the result of Preload like a readiness probe
+void *PreloadPollThread(void *args) {
+  PreloadPollArgs *thread_args = static_cast<PreloadPollArgs *>(args);
+  Model *model = thread_args->model;
+  while (!milkcat::AcquireLoad(thread_args->stop)) {
+    int preload_number = model->preload_number();
+    assert(preload_number == 0 || preload_number == 2 || preload_number == 7);
+    for (int i = 0; i < preload_number; ++i) {
+      assert(model->preload_name(i) != NULL);
+      assert(model->preload_time(i) >= 0.0);
+    }
+  }
+  return NULL;
+}
+
+void concurrent_preload_test() {
+  Model *model = Model::New(MODEL_DIR);
+  assert(model);
+
+  bool stop = false;
+  pthread_t threads[THREAD_NUMBER];
+  PreloadPollArgs args;
+  args.model = model;
+  args.stop = &stop;
+  for (int i = 0; i < THREAD_NUMBER; ++i) {
+    pthread_create(&threads[i], NULL, PreloadPollThread, &args);
+  }
+  for (int i = 0; i < ROUND_NUMBER; ++i) {
+    assert(model->Preload(GetOptions(i % 2), 2));
+  }
+  milkcat::ReleaseStore(&stop, true);
+  for (int i = 0; i < THREAD_NUMBER; ++i) pthread_join(threads[i], NULL);
+  delete model;
+
+  puts("concurrent_preload_test OK");
+}
+
+// The model files are installed into MODEL_DIR separately, returns false if
+// they are not there
+bool has_model() {
+  FILE *fd = fopen(MODEL_DIR "unigram.idx", "rb");
+  if (fd == NULL) return false;
+  fclose(fd);
+  return true;
+}
+
+int main() {
+  if (!has_model()) {
+    puts("model_preload_test SKIP: no model in " MODEL_DIR);
+    return 77;
+  }
+  preload_test();
+  concurrent_preload_test();
+  return 0;
+}
@@ -26,8 +26,11 @@
 //
 
 #include "common/reimu_trie.h"
+#include "common/trie_tree.h"
+#include "utils/mapped_file.h"
 
 #include <assert.h>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -40,7 +43,9 @@
 #define N 10000
 #define HALF_N 5000
 
+using milkcat::DoubleArrayTrieTree;
 using milkcat::ReimuTrie;
+using milkcat::MappedFile;
 
 std::vector<std::string> putset;
 std::vector<std::string> unputset;
@@ -200,6 +205,28 @@ void save_and_open_test() {
   puts("save_and_open_test OK");
 }
 
+void mmap_open_test() {
+  ReimuTrie *trie = new ReimuTrie();
+  for (int i = 0; i < putset.size(); ++i) {
+    trie->Put(putset[i].c_str(), i);
+  }
+  assert(trie->Save("save.and.open.test.reimu_trie"));
+  int size = trie->size();
+  delete trie;
+
+  trie = ReimuTrie::Open("save.and.open.test.reimu_trie",
+                         MappedFile::kMmap | MappedFile::kMmapWillNeed);
+  assert(trie);
+  assert(trie->size() == size);
+  for (int i = 0; i < putset.size(); ++i) {
+    assert(trie->Get(putset[i].c_str(), -1) == i);
+    assert(trie->Get(unputset[i].c_str(), -1) == -1);
+  }
+  delete trie;
+
+  puts("mmap_open_test OK");
+}
+
 void restore_test() {
   ReimuTrie *trie = new ReimuTrie();
   for (int i = 0; i < HALF_N; ++i) {
@@ -267,12 +294,59 @@ void traverse_test() {
   puts("traverse_test OK");
 }
 
+void common_prefix_search_test() {
+  std::map<std::string, int> words;
+  words["Bad"] = 0;
+  words["Bad Apple"] = 1;
+  words["Bad Apple~!!"] = 2;
+  words["Bad App"] = 3;
+  words["Bad Alice"] = 4;
+
+  ReimuTrie *trie = new ReimuTrie();
+  for (std::map<std::string, int>::iterator
+       it = words.begin(); it != words.end(); ++it) {
+    trie->Put(it->first.c_str(), it->second);
+  }
+  DoubleArrayTrieTree *double_array = DoubleArrayTrieTree::NewFromMap(words);
+
+  // "Bad App" is not formed by the tokens
+  const char *tokens[] = {"Bad", " ", "Apple", "~!", "!", "Touhou"};
+  int lengths[] = {3, 1, 5, 2, 1, 6};
+  std::vector<std::pair<int, int> > matches, expected;
+  expected.push_back(std::make_pair(0, 0));
+  expected.push_back(std::make_pair(2, 1));
+  expected.push_back(std::make_pair(4, 2));
+
+  trie->CommonPrefixSearch(tokens, lengths, 6, &matches);
+  assert(matches == expected);
+  double_array->CommonPrefixSearch(tokens, lengths, 6, &matches);
+  assert(matches == expected);
+
+  // Only the first `token_number` tokens are searched
+  expected.pop_back();
+  trie->CommonPrefixSearch(tokens, lengths, 4, &matches);
+  assert(matches == expected);
+  double_array->CommonPrefixSearch(tokens, lengths, 4, &matches);
+  assert(matches == expected);
+
+  trie->CommonPrefixSearch(tokens + 1, lengths + 1, 5, &matches);
+  assert(matches.empty());
+  double_array->CommonPrefixSearch(tokens + 1, lengths + 1, 5, &matches);
+  assert(matches.empty());
+
+  delete double_array;
+  delete trie;
+  puts("common_prefix_search_test OK");
+}
+
 int main() {
   generate_test_data();
   simple_get_put_test();
   save_and_open_test();
+  mmap_open_test();
   restore_test();
   traverse_test();
+  common_prefix_search_test();
   // set_array_test();
 
 #ifdef BENCHMARK
@@ -0,0 +1,232 @@
+//
+// The MIT License (MIT)
+//
+// Copyright 2013-2014 The MilkCat Project Developers
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// static_hashtable_test.cc --- Created at 2014-12-04
+//
+
+#include "common/static_hashtable.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <set>
+#include <vector>
+
+#define N 20000
+
+using milkcat::StaticHashTable;
+using milkcat::Status;
+
+typedef StaticHashTable<int64_t, float> Table;
+
+std::vector<int64_t> keys;
+std::vector<float> values;
+std::vector<int64_t> absent_keys;
+
+int64_t gen_key() {
+  int64_t left = rand() % 100000 + 1;
+  int64_t right = rand() % 100000 + 1;
+  return (left << 32) + right;
+}
+
+void generate_test_data() {
+  std::set<int64_t> key_set;
+  while (key_set.size() < 2 * N) key_set.insert(gen_key());
+
+  int i = 0;
+  for (std::set<int64_t>::iterator
+       it = key_set.begin(); it != key_set.end(); ++it, ++i) {
+    if (i % 2 == 0) {
+      keys.push_back(*it);
+      values.push_back(static_cast<float>(i));
+    } else {
+      absent_keys.push_back(*it);
+    }
+  }
+}
+
+void check_table(const Table *table) {
+  assert(table->size() == N);
+  for (int i = 0; i < N; ++i) {
+    const float *value = table->Find(keys[i]);
+    assert(value != NULL && *value == values[i]);
+    assert(table->Find(absent_keys[i]) == NULL);
+  }
+}
+
+void build_and_find_test() {
+  const Table *table = Table::Build(keys.data(), values.data(), N);
+  check_table(table);
+  delete table;
+
+  puts("build_and_find_test OK");
+}
+
+void find_batch_test() {
+  const Table *table = Table::Build(keys.data(), values.data(), N);
+
+  // Mixes the keys exist and not exist in table
+  std::vector<int64_t> query;
+  for (int i = 0; i < N; ++i) {
+    query.push_back(keys[i]);
+    if (i % 3 == 0) query.push_back(absent_keys[i]);
+  }
+
+  std::vector<const float *> result(query.size());
+  table->FindBatch(query.data(), query.size(), result.data());
+  for (int i = 0; i < query.size(); ++i) {
+    assert(result[i] == table->Find(query[i]));
+  }
+  delete table;
+
+  puts("find_batch_test OK");
+}
+
+void save_and_open_test() {
+  Status status;
+  const Table *table = Table::Build(keys.data(), values.data(), N);
+  table->Save("save.and.open.test.static_hashtable", &status);
+  assert(status.ok());
+  delete table;
+
+  table = Table::New("save.and.open.test.static_hashtable", &status);
+  assert(status.ok());
+  check_table(table);
+  delete table;
+
+  puts("save_and_open_test OK");
+}
+
+// Reads or overwrites the int32 field at `offset` of the file header
+int32_t read_header(const char *file_path, long offset) {
+  FILE *fd = fopen(file_path, "rb");
+  assert(fd != NULL);
+  int32_t value = 0;
+  fseek(fd, offset, SEEK_SET);
+  assert(fread(&value, sizeof(value), 1, fd) == 1);
+  fclose(fd);
+  return value;
+}
+
+void patch_header(const char *file_path, long offset, int32_t value) {
+  FILE *fd = fopen(file_path, "r+b");
+  assert(fd != NULL);
+  fseek(fd, offset, SEEK_SET);
+  fwrite(&value, sizeof(value), 1, fd);
+  fclose(fd);
+}
+
+void corrupted_header_test() {
+  Status status;
+  const Table *table = Table::Build(keys.data(), values.data(), N);
+  table->Save("corrupted.test.static_hashtable", &status);
+  assert(status.ok());
+  delete table;
+
+  // A full table or a negative size. The bucket size and data size are the
+  // fourth and fifth fields of the header
+  int32_t capacity = read_header("corrupted.test.static_hashtable",
+                                 3 * sizeof(int32_t));
+  int32_t corrupted_data_sizes[] = {capacity, capacity + 1, -1};
+  for (int i = 0; i < 3; ++i) {
+    patch_header("corrupted.test.static_hashtable",
+                 4 * sizeof(int32_t),
+                 corrupted_data_sizes[i]);
+    table = Table::New("corrupted.test.static_hashtable", &status);
+    assert(table == NULL && !status.ok());
+    status = Status::OK();
+  }
+
+  puts("corrupted_header_test OK");
+}
+
+// Writes `data_size` pairs of the test data into a version 1 file, which
+// stores a (position, key, value) record for each non-empty bucket
+void write_version1_file(const char *file_path,
+                         int32_t bucket_size,
+                         int32_t data_size) {
+  FILE *fd = fopen(file_path, "wb");
+  assert(fd != NULL);
+  int32_t header[] = {
+    0x3321,
+    bucket_size,
+    data_size,
+    sizeof(int32_t) + sizeof(int64_t) + sizeof(float)
+  };
+  fwrite(header, sizeof(header), 1, fd);
+  for (int32_t i = 0; i < data_size; ++i) {
+    fwrite(&i, sizeof(i), 1, fd);
+    fwrite(&keys[i], sizeof(keys[i]), 1, fd);
+    fwrite(&values[i], sizeof(values[i]), 1, fd);
+  }
+  fclose(fd);
+}
+
+void load_version1_test() {
+  Status status;
+  write_version1_file("version1.test.static_hashtable", 4 * N, N);
+  const Table *table = Table::New("version1.test.static_hashtable", &status);
+  assert(status.ok());
+  check_table(table);
+
+  // Converts it into the current format
+  table->Save("version1.test.static_hashtable", &status);
+  assert(status.ok());
+  delete table;
+
+  table = Table::New("version1.test.static_hashtable", &status);
+  assert(status.ok());
+  check_table(table);
+  delete table;
+
+  // An empty table
+  write_version1_file("version1.test.static_hashtable", 1, 0);
+  table = Table::New("version1.test.static_hashtable", &status);
+  assert(status.ok() && table->size() == 0);
+  assert(table->Find(keys[0]) == NULL);
+  delete table;
+
+  // Sizes that could not come from a table
+  int32_t corrupted_sizes[][2] = {{N, -1}, {0, 0}, {-N, N}, {N - 1, N}};
+  for (int i = 0; i < 4; ++i) {
+    write_version1_file("version1.test.static_hashtable",
+                        corrupted_sizes[i][0],
+                        corrupted_sizes[i][1]);
+    table = Table::New("version1.test.static_hashtable", &status);
+    assert(table == NULL && !status.ok());
+    status = Status::OK();
+  }
+
+  puts("load_version1_test OK");
+}
+
+int main() {
+  generate_test_data();
+  build_and_find_test();
+  find_batch_test();
+  save_and_open_test();
+  corrupted_header_test();
+  load_version1_test();
+  return 0;
+}
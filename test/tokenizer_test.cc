@@ -0,0 +1,141 @@
+//
+// The MIT License (MIT)
+//
+// Copyright 2013-2014 The MilkCat Project Developers
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// tokenizer_test.cc --- Created at 2015-01-15
+//
+
+#include "tokenizer/tokenizer.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "include/milkcat.h"
+#include "segmenter/term_instance.h"
+#include "tagger/part_of_speech_tag_instance.h"
+#include "tokenizer/token_instance.h"
+
+using milkcat::Parser;
+using milkcat::PartOfSpeechTagInstance;
+using milkcat::TermInstance;
+using milkcat::TokenInstance;
+using milkcat::Tokenization;
+
+void long_token_test() {
+  std::string long_word(300, 'a');
+  std::string text = "今天" + long_word + " http://milkcat.org/" +
+                     long_word + "。";
+
+  Tokenization *tokenizer = new Tokenization();
+  TokenInstance *token_instance = new TokenInstance();
+  tokenizer->Scan(text.c_str());
+  assert(tokenizer->GetSentence(token_instance));
+  assert(token_instance->size() == 6);
+
+  // Tokens are not truncated
+  assert(token_instance->token_length_at(2) == 300);
+  assert(long_word == token_instance->token_text_at(2));
+  std::string url = "http://milkcat.org/" + long_word;
+  assert(url == token_instance->token_text_at(4));
+  assert(strncmp(token_instance->token_data_at(0), "今", 3) == 0);
+
+  // Each sentence has a new serial, even with the same size in another
+  // instance
+  int64_t serial = token_instance->serial();
+  TokenInstance *other_instance = new TokenInstance();
+  tokenizer->Scan(text.c_str());
+  assert(tokenizer->GetSentence(other_instance));
+  assert(other_instance->size() == 6 && other_instance->serial() > serial);
+  serial = other_instance->serial();
+  tokenizer->Scan(text.c_str());
+  assert(tokenizer->GetSentence(token_instance));
+  assert(token_instance->serial() > serial);
+  delete other_instance;
+
+  // A term is the span of its tokens
+  TermInstance *term_instance = new TermInstance();
+  term_instance->set_tokens_at(0, token_instance, 0, 2, Parser::kChineseWord);
+  term_instance->set_tokens_at(1, token_instance, 2, 3, Parser::kEnglishWord);
+  term_instance->set_value_at(2, "copied", 1, Parser::kOther);
+  term_instance->set_size(3);
+  assert(term_instance->term_data_at(0) == token_instance->token_data_at(0));
+  assert(strcmp(term_instance->term_text_at(0), "今天") == 0);
+  assert(long_word == term_instance->term_text_at(1));
+  assert(term_instance->token_number_at(0) == 2);
+  assert(strcmp(term_instance->term_text_at(2), "copied") == 0);
+
+  TermInstance *copied_instance = new TermInstance();
+  copied_instance->CopyTermAt(0, term_instance, 1);
+  copied_instance->CopyTermAt(1, term_instance, 2);
+  term_instance->set_value_at(2, "changed", 1, Parser::kOther);
+  assert(copied_instance->term_data_at(0) == term_instance->term_data_at(1));
+  assert(strcmp(copied_instance->term_text_at(1), "copied") == 0);
+
+  delete copied_instance;
+  delete term_instance;
+  delete token_instance;
+  delete tokenizer;
+  puts("long_token_test OK");
+}
+
+void instance_grow_test() {
+  // Instances grow on demand and the strings are not truncated
+  int size = 8192;
+  std::string long_tag(200, 'N');
+  PartOfSpeechTagInstance *tag_instance = new PartOfSpeechTagInstance();
+  TermInstance *term_instance = new TermInstance();
+  for (int i = 0; i < size; ++i) {
+    tag_instance->set_value_at(i, i % 2 ? "NN" : long_tag.c_str(), i % 3);
+    term_instance->set_value_at(i, "term", 1, Parser::kChineseWord, i);
+  }
+  tag_instance->set_size(size);
+  term_instance->set_size(size);
+
+  // Reuses the slot of a string
+  tag_instance->set_value_at(1, "VV", false);
+  tag_instance->set_value_at(2, "P", false);
+  for (int i = 0; i < size; ++i) {
+    if (i == 1) {
+      assert(strcmp(tag_instance->part_of_speech_tag_at(i), "VV") == 0);
+    } else if (i == 2) {
+      assert(strcmp(tag_instance->part_of_speech_tag_at(i), "P") == 0);
+    } else {
+      assert(tag_instance->part_of_speech_tag_at(i) ==
+             (i % 2 ? std::string("NN") : long_tag));
+      assert(tag_instance->is_out_of_vocabulary_word_at(i) == (i % 3 != 0));
+    }
+    assert(strcmp(term_instance->term_text_at(i), "term") == 0);
+    assert(term_instance->term_id_at(i) == i);
+  }
+
+  delete term_instance;
+  delete tag_instance;
+  puts("instance_grow_test OK");
+}
+
+int main() {
+  long_token_test();
+  instance_grow_test();
+  return 0;
+}
@@ -0,0 +1,255 @@
+//
+// The MIT License (MIT)
+//
+// Copyright 2013-2014 The MilkCat Project Developers
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// user_dictionary_reload_test.cc --- Created at 2015-01-16
+//
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "include/milkcat.h"
+#include "utils/atomic.h"
+
+using milkcat::Model;
+using milkcat::Parser;
+
+#define THREAD_NUMBER 16
+
+const char *kText = "今天的天气不错。MilkCat 是一个中文分词和词性标注工具。";
+
+Parser::Options GetOptions(int options_type) {
+  Parser::Options options;
+  switch (options_type % 4) {
+    case 0:
+      options.UseMixedSegmenter();
+      options.UseMixedPOSTagger();
+      break;
+    case 1:
+      options.UseCrfSegmenter();
+      options.UseCrfPOSTagger();
+      break;
+    case 2:
+      options.UseBigramSegmenter();
+      options.UseHmmPOSTagger();
+      break;
+    case 3:
+      options.UseUnigramSegmenter();
+      options.NoPOSTagger();
+      break;
+  }
+  return options;
+}
+
+// Parses kText with a new Parser created from `model` and returns the result
+std::string Parse(Model *model, int options_type) {
+  Parser *parser = Parser::New(GetOptions(options_type), model);
+  assert(parser);
+
+  std::string result;
+  Parser::Iterator *it = new Parser::Iterator();
+  parser->Parse(kText, it);
+  while (!it->End()) {
+    result += it->word();
+    result += "/";
+    if (options_type % 4 != 3) result += it->part_of_speech_tag();
+    result += " ";
+    it->Next();
+  }
+
+  delete it;
+  delete parser;
+  return result;
+}
+
+const char *kUserDictionaries[] = {
+  "user_dictionary_reload_test.userdict.0",
+  "user_dictionary_reload_test.userdict.1"
+};
+
+struct ReloadThreadArgs {
+  Model *model;
+  std::vector<std::string> expected;
+  bool *stop;
+};
+
+void *ReloadParserThread(void *args) {
+  ReloadThreadArgs *thread_args = static_cast<ReloadThreadArgs *>(args);
+  Parser *parser = Parser::New(GetOptions(2), thread_args->model);
+  assert(parser);
+
+  // Each sentence should be segmented by one of the user dictionaries
+  Parser::Iterator *it = new Parser::Iterator();
+  while (!milkcat::AcquireLoad(thread_args->stop)) {
+    std::string result;
+    parser->Parse(kText, it);
+    while (!it->End()) {
+      result += it->word();
+      result += "/";
+      result += it->part_of_speech_tag();
+      result += " ";
+      it->Next();
+    }
+    assert(std::find(thread_args->expected.begin(),
+                     thread_args->expected.end(),
+                     result) != thread_args->expected.end());
+  }
+
+  delete it;
+  delete parser;
+  return NULL;
+}
+
+void user_dictionary_reload_test() {
+  FILE *fd = fopen(kUserDictionaries[0], "w");
+  fputs("天气不错 1.0\n", fd);
+  fclose(fd);
+  fd = fopen(kUserDictionaries[1], "w");
+  fputs("今天的 1.0\n", fd);
+  fclose(fd);
+
+  std::string expected[2];
+  for (int i = 0; i < 2; ++i) {
+    Model *model = Model::New(MODEL_DIR);
+    assert(model && model->SetUserDictionary(kUserDictionaries[i]));
+    expected[i] = Parse(model, 2);
+    delete model;
+  }
+  assert(expected[0] != expected[1]);
+
+  Model *model = Model::New(MODEL_DIR);
+  assert(model && model->SetUserDictionary(kUserDictionaries[0]));
+  bool stop = false;
+  pthread_t threads[THREAD_NUMBER];
+  ReloadThreadArgs args;
+  args.model = model;
+  args.expected.assign(expected, expected + 2);
+  args.stop = &stop;
+  for (int i = 0; i < THREAD_NUMBER; ++i) {
+    pthread_create(&threads[i], NULL, ReloadParserThread, &args);
+  }
+
+  // Reloads the user dictionary while the parsers are running
+  for (int i = 1; i <= 200; ++i) {
+    assert(model->SetUserDictionary(kUserDictionaries[i % 2]));
+  }
+  milkcat::ReleaseStore(&stop, true);
+  for (int i = 0; i < THREAD_NUMBER; ++i) pthread_join(threads[i], NULL);
+
+  // The last one is the first user dictionary
+  assert(Parse(model, 2) == expected[0]);
+  delete model;
+
+  puts("user_dictionary_reload_test OK");
+}
+
+void combined_user_dictionary_test() {
+  for (int i = 0; i < 2; ++i) {
+    Model *model = Model::New(MODEL_DIR);
+    assert(model && model->SetUserDictionary(kUserDictionaries[i]));
+    std::string expected = Parse(model, 2);
+    delete model;
+
+    model = Model::New(MODEL_DIR);
+    assert(model && model->SetUserDictionary(kUserDictionaries[i], true));
+    assert(Parse(model, 2) == expected);
+
+    // The words added on the combined index
+    const char *word = "不错。";
+    model->AddUserWords(&word, NULL, 1);
+    assert(Parse(model, 2) != expected);
+    model->RemoveUserWords(&word, 1);
+    assert(Parse(model, 2) == expected);
+    delete model;
+  }
+
+  puts("combined_user_dictionary_test OK");
+}
+
+void user_dictionary_incremental_test() {
+  const char *kWords[] = {"天气不错", "今天的"};
+  std::string expected[3];
+  Model *model = Model::New(MODEL_DIR);
+  assert(model);
+  expected[2] = Parse(model, 2);
+  for (int i = 0; i < 2; ++i) {
+    float cost = 1.0f;
+    model->AddUserWords(&kWords[i], &cost, 1);
+    expected[i] = Parse(model, 2);
+    model->RemoveUserWords(&kWords[i], 1);
+    assert(Parse(model, 2) == expected[2]);
+  }
+  assert(expected[0] != expected[1]);
+
+  float cost = 1.0f;
+  model->AddUserWords(&kWords[0], &cost, 1);
+  bool stop = false;
+  pthread_t threads[THREAD_NUMBER];
+  ReloadThreadArgs args;
+  args.model = model;
+  args.expected.assign(expected, expected + 3);
+  args.stop = &stop;
+  for (int i = 0; i < THREAD_NUMBER; ++i) {
+    pthread_create(&threads[i], NULL, ReloadParserThread, &args);
+  }
+
+  // Switches the user words while the parsers are running, and adds some
+  // other words to make enough layers for compaction
+  char word[64];
+  const char *other_word = word;
+  for (int i = 1; i <= 2000; ++i) {
+    model->RemoveUserWords(&kWords[(i + 1) % 2], 1);
+    model->AddUserWords(&kWords[i % 2], &cost, 1);
+    snprintf(word, sizeof(word), "word%d", i);
+    model->AddUserWords(&other_word, NULL, 1);
+  }
+  milkcat::ReleaseStore(&stop, true);
+  for (int i = 0; i < THREAD_NUMBER; ++i) pthread_join(threads[i], NULL);
+
+  assert(Parse(model, 2) == expected[0]);
+  delete model;
+
+  puts("user_dictionary_incremental_test OK");
+}
+
+// The model files are installed into MODEL_DIR separately, returns false if
+// they are not there
+bool has_model() {
+  FILE *fd = fopen(MODEL_DIR "unigram.idx", "rb");
+  if (fd == NULL) return false;
+  fclose(fd);
+  return true;
+}
+
+int main() {
+  if (!has_model()) {
+    puts("user_dictionary_reload_test SKIP: no model in " MODEL_DIR);
+    return 77;
+  }
+  user_dictionary_reload_test();
+  combined_user_dictionary_test();
+  user_dictionary_incremental_test();
+  return 0;
+}
@@ -0,0 +1,286 @@
+//
+// The MIT License (MIT)
+//
+// Copyright 2013-2014 The MilkCat Project Developers
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// user_dictionary_test.cc --- Created at 2015-01-14
+//
+
+#include "common/user_dictionary.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "common/milkcat_config.h"
+#include "common/trie_tree.h"
+
+using milkcat::TrieTree;
+using milkcat::UserDictionary;
+
+// Searches `word` in `dict` byte by byte like the segmenter, returns its
+// term-id and stores the cost into `cost`
+int search(const UserDictionary *dict, const std::string &word, float *cost) {
+  std::vector<size_t> nodes(dict->layer_number(), 0);
+  int term_id = TrieTree::kNone;
+  for (int i = 0; i < word.size(); ++i) {
+    term_id = dict->Traverse(word.data() + i, 1, nodes.data(), cost);
+    if (term_id == TrieTree::kNone) break;
+  }
+  return term_id;
+}
+
+bool has_word(const UserDictionary *dict, const std::string &word) {
+  float cost;
+  return search(dict, word, &cost) >= 0;
+}
+
+float cost_of(const UserDictionary *dict, const std::string &word) {
+  float cost = -1.0f;
+  assert(search(dict, word, &cost) >= 0);
+  return cost;
+}
+
+// Replaces `*dict` by `next` and releases the old one
+void step(UserDictionary **dict, UserDictionary *next) {
+  assert(next != NULL && next->version() > (*dict)->version());
+  (*dict)->Release();
+  *dict = next;
+}
+
+void add_remove_test() {
+  std::map<std::string, float> words;
+  words["abc"] = 1.0f;
+  words["abd"] = 2.0f;
+  UserDictionary *dict = UserDictionary::New(words, 1);
+  assert(dict->layer_number() == 1);
+  assert(cost_of(dict, "abc") == 1.0f);
+  assert(search(dict, "ab", NULL) == TrieTree::kExist);
+  assert(search(dict, "abx", NULL) == TrieTree::kNone);
+
+  // Newer cost hides the older one
+  words.clear();
+  words["abc"] = 3.0f;
+  words["xyz"] = 4.0f;
+  step(&dict, dict->Add(words, 0, 2));
+  assert(cost_of(dict, "abc") == 3.0f);
+  assert(cost_of(dict, "abd") == 2.0f);
+  assert(cost_of(dict, "xyz") == 4.0f);
+
+  // Removed words are not found, but their prefix still exists for others
+  std::vector<std::string> removed;
+  removed.push_back("abc");
+  removed.push_back("nothing");
+  step(&dict, dict->Remove(removed, 0, 3));
+  assert(!has_word(dict, "abc"));
+  assert(!has_word(dict, "nothing"));
+  assert(search(dict, "ab", NULL) == TrieTree::kExist);
+  assert(cost_of(dict, "abd") == 2.0f);
+
+  // Adds it back
+  words.clear();
+  words["abc"] = 5.0f;
+  step(&dict, dict->Add(words, 0, 4));
+  assert(cost_of(dict, "abc") == 5.0f);
+
+  // Term-ids are different for different words
+  float cost;
+  assert(search(dict, "abc", &cost) != search(dict, "abd", &cost));
+  assert(search(dict, "abc", &cost) >= milkcat::kUserTermIdStart);
+  dict->Release();
+
+  puts("add_remove_test OK");
+}
+
+void merge_and_compact_test() {
+  std::map<std::string, float> words;
+  words["seed"] = 1.0f;
+  UserDictionary *dict = UserDictionary::New(words, 1);
+  char word[64];
+
+  // Adds words one by one, the small layers are merged so that the number of
+  // layers stays small
+  int64_t version = 1;
+  for (int i = 0; i < 1000; ++i) {
+    words.clear();
+    snprintf(word, sizeof(word), "word%d", i);
+    words[word] = static_cast<float>(i);
+    step(&dict, dict->Add(words, 0, ++version));
+    assert(dict->layer_number() <= 12);
+  }
+  for (int i = 0; i < 1000; ++i) {
+    snprintf(word, sizeof(word), "word%d", i);
+    assert(cost_of(dict, word) == static_cast<float>(i));
+  }
+
+  // Layers under compaction are not merged by the updates
+  int compacting = dict->layer_number();
+  UserDictionary *snapshot = dict;
+  snapshot->AddRef();
+  std::vector<std::string> removed;
+  removed.push_back("word0");
+  removed.push_back("seed");
+  step(&dict, dict->Remove(removed, compacting, ++version));
+  words.clear();
+  words["word1"] = -1.0f;
+  step(&dict, dict->Add(words, compacting, ++version));
+  assert(dict->layer_number() == compacting + 1);
+
+  // Replaces the compacted layers, the newer updates are kept
+  UserDictionary::Layer *compacted = snapshot->Compact(compacting);
+  step(&dict, dict->Replace(snapshot, compacted, compacting, ++version));
+  assert(dict->layer_number() == 2);
+  assert(!has_word(dict, "word0"));
+  assert(!has_word(dict, "seed"));
+  assert(cost_of(dict, "word1") == -1.0f);
+  assert(cost_of(dict, "word999") == 999.0f);
+
+  // A compaction of layers no longer in the dictionary is discarded
+  compacted = snapshot->Compact(compacting);
+  assert(dict->Replace(snapshot, compacted, compacting, ++version) == NULL);
+  snapshot->Release();
+  dict->Release();
+
+  puts("merge_and_compact_test OK");
+}
+
+void combined_index_test() {
+  std::map<std::string, int> system_words;
+  system_words["abc"] = 0;
+  system_words["de"] = 1;
+  system_words["xyz"] = 2;
+  float system_costs[] = {10.0f, 11.0f, 12.0f};
+  milkcat::DoubleArrayTrieTree *system_index =
+      milkcat::DoubleArrayTrieTree::NewFromMap(system_words);
+  milkcat::StaticArray<float> *system_cost =
+      milkcat::StaticArray<float>::NewFromArray(system_costs, 3);
+
+  std::map<std::string, int> all_words;
+  system_index->GetAllWords(&all_words);
+  assert(all_words == system_words);
+
+  std::map<std::string, float> words;
+  words["abc"] = 1.0f;
+  words["de"] = milkcat::kDefaultCost;
+  words["dex"] = 2.0f;
+  UserDictionary *dict = UserDictionary::New(words, 1, system_index,
+                                             system_cost);
+  const TrieTree *index = dict->combined_index();
+  assert(index != NULL && !dict->has_layers());
+  assert(index->Search("abc") >= 0 && index->Search("dex") >= 0);
+
+  // The cost of user dictionary overrides the system one
+  const UserDictionary::CombinedEntry *entry =
+      &dict->combined_entry(index->Search("abc"));
+  assert(entry->term_id == 0 && entry->cost == 1.0f);
+  assert(entry->flags == (UserDictionary::kSystemWord |
+                          UserDictionary::kUserWord));
+  entry = &dict->combined_entry(index->Search("de"));
+  assert(entry->term_id == 1 && entry->cost == 11.0f);
+  entry = &dict->combined_entry(index->Search("xyz"));
+  assert(entry->flags == UserDictionary::kSystemWord);
+  entry = &dict->combined_entry(index->Search("dex"));
+  assert(entry->flags == UserDictionary::kUserWord);
+  assert(dict->combined_term_id(entry->term_id) >= milkcat::kUserTermIdStart);
+
+  // Updates are pushed onto the combined layer, which is not traversed by
+  // Traverse
+  std::vector<std::string> removed;
+  removed.push_back("dex");
+  step(&dict, dict->Remove(removed, 0, 2));
+  assert(dict->combined_index() == index && dict->layer_number() == 2);
+  float cost;
+  assert(search(dict, "dex", &cost) == UserDictionary::kRemoved);
+  assert(search(dict, "abc", &cost) == TrieTree::kNone);
+
+  // Compaction builds a new combined index
+  UserDictionary::Layer *compacted = dict->Compact(2, system_index,
+                                                   system_cost);
+  step(&dict, dict->Replace(dict, compacted, 2, 3));
+  index = dict->combined_index();
+  assert(index != NULL && dict->layer_number() == 1);
+  assert(index->Search("dex") < 0 && index->Search("abc") >= 0);
+
+  dict->Release();
+  delete system_index;
+  delete system_cost;
+
+  puts("combined_index_test OK");
+}
+
+// Term-ids of the snapshot should be unique, and in the range starting from
+// kUserTermIdStart as large as the words in the layers
+void check_term_ids(const UserDictionary *dict, int word_number) {
+  char word[64];
+  float cost;
+  std::set<int> term_ids;
+  for (int i = 0; i < word_number; ++i) {
+    snprintf(word, sizeof(word), "word%d", i);
+    int term_id = search(dict, word, &cost);
+    assert(term_id >= milkcat::kUserTermIdStart);
+    assert(term_id < milkcat::kUserTermIdStart + 2 * word_number);
+    term_ids.insert(term_id);
+  }
+  assert(term_ids.size() == word_number);
+}
+
+void term_id_range_test() {
+  std::map<std::string, float> words;
+  char word[64];
+  int word_number = 1000;
+  for (int i = 0; i < word_number; ++i) {
+    snprintf(word, sizeof(word), "word%d", i);
+    words[word] = 1.0f;
+  }
+  UserDictionary *dict = UserDictionary::New(words, 1);
+
+  // Each compaction builds a layer of the whole dictionary, they should not
+  // run out of term-ids
+  int64_t version = 1;
+  for (int i = 0; i < 200; ++i) {
+    words.clear();
+    snprintf(word, sizeof(word), "word%d", i % word_number);
+    words[word] = 2.0f;
+    step(&dict, dict->Add(words, 0, ++version));
+    check_term_ids(dict, word_number);
+
+    UserDictionary::Layer *compacted = dict->Compact(dict->layer_number());
+    step(&dict, dict->Replace(dict,
+                              compacted,
+                              dict->layer_number(),
+                              ++version));
+    assert(dict->layer_number() == 1);
+    check_term_ids(dict, word_number);
+  }
+  dict->Release();
+
+  puts("term_id_range_test OK");
+}
+
+int main() {
+  add_remove_test();
+  merge_and_compact_test();
+  combined_index_test();
+  term_id_range_test();
+  return 0;
+}